@@ -15,6 +15,7 @@
 #include "funcapi.h"
 #include "catalog/pg_type.h"
 #include "utils/builtins.h"
+#include "utils/array.h"
 #if PGSQL_VERSION > 92
 #include "access/htup_details.h"
 #endif
@@ -41,14 +42,32 @@
 PG_MODULE_MAGIC;
 #endif
 
+void _PG_init(void);
+
 PGDLLEXPORT Datum as_compile_lexicon(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum as_compile_lexicon_binary(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum as_compile_grammar(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum as_standardize(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum as_standardize_batch(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum as_parse(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum as_match(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum as_explain(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum as_cache_stats(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum as_cache_entries(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum as_stage_stats(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum as_stage_stats_reset(PG_FUNCTION_ARGS);
 
 
 void stdaddr_free(STDADDR *stdaddr);
 static char *text2char(text *in);
+static STDADDR *standardize_with(STANDARDIZER *std, char *address, char *locale, char *filter, char **err_msg);
+static void stdaddr_to_datums(STDADDR *stdaddr, Datum *values, bool *nulls);
+
+void _PG_init(void)
+{
+    InitStdCache();
+}
+
 
 static char *text2char(text *in)
 {
@@ -84,6 +103,48 @@ void stdaddr_free(STDADDR *stdaddr)
 }
 
 
+/* standardize with a cached standardizer, its grammar may be in a model */
+static STDADDR *standardize_with(STANDARDIZER *std, char *address, char *locale, char *filter, char **err_msg)
+{
+    if (std->gmr_obj)
+        return std_standardize_ptrs( address, std->gmr_obj, std->lex_obj, locale, filter, err_msg );
+    return std_standardize_model( address, std->model_obj, locale, filter, NULL, err_msg );
+}
+
+
+/* the 17 stdaddr fields as text datums, a missing field is NULL */
+static void stdaddr_to_datums(STDADDR *stdaddr, Datum *values, bool *nulls)
+{
+    char *fields[17];
+    int k;
+
+    memset(fields, 0, sizeof(fields));
+    if (stdaddr) {
+        fields[0]  = stdaddr->building;
+        fields[1]  = stdaddr->house_num;
+        fields[2]  = stdaddr->predir;
+        fields[3]  = stdaddr->qual;
+        fields[4]  = stdaddr->pretype;
+        fields[5]  = stdaddr->name;
+        fields[6]  = stdaddr->suftype;
+        fields[7]  = stdaddr->sufdir;
+        fields[8]  = stdaddr->ruralroute;
+        fields[9]  = stdaddr->extra;
+        fields[10] = stdaddr->city;
+        fields[11] = stdaddr->prov;
+        fields[12] = stdaddr->country;
+        fields[13] = stdaddr->postcode;
+        fields[14] = stdaddr->box;
+        fields[15] = stdaddr->unit;
+        fields[16] = stdaddr->pattern;
+    }
+    for (k=0; k<17; k++) {
+        nulls[k] = fields[k] == NULL;
+        values[k] = fields[k] ? CStringGetTextDatum(fields[k]) : (Datum) 0;
+    }
+}
+
+
 void tokens_free(TOKENS *tokens, int nrec)
 {
     int i;
@@ -136,6 +197,82 @@ Datum as_compile_lexicon(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ *  CREATE OR REPLACE FUNCTION as_compile_lexicon_binary(
+ *          lexicon text
+ *          )
+ *      RETURNS BYTEA
+ *      AS '$libdir/address_standardizer2-2.0', 'as_compile_lexicon_binary'
+ *      LANGUAGE 'c' STABLE STRICT;
+ *
+ * The result is a lexicon only model image that can be passed as the
+ * lexicon to as_standardize(), as_standardize_batch(), as_parse() and
+ * as_match(), it is loaded without any parsing.
+ *
+*/
+PG_FUNCTION_INFO_V1(as_compile_lexicon_binary);
+
+Datum as_compile_lexicon_binary(PG_FUNCTION_ARGS)
+{
+    char *lexicon;
+    char *image;
+    char *err_msg = NULL;
+    long unsigned int size = 0;
+    bytea *result;
+
+    lexicon = text2char(PG_GETARG_TEXT_P(0));
+
+    image = serialize_lexicon_binary( lexicon, &size, &err_msg );
+    if ( err_msg != NULL )
+        elog(ERROR, "as_compile_lexicon_binary threw an error: %s", err_msg);
+    if (!image)
+        elog(ERROR, "lexicon failed to compile!");
+
+    result = (bytea *) palloc(VARHDRSZ + size);
+    SET_VARSIZE(result, VARHDRSZ + size);
+    memcpy(VARDATA(result), image, size);
+    free(image);
+
+    PG_RETURN_BYTEA_P(result);
+}
+
+
+/*
+ *  CREATE OR REPLACE FUNCTION as_compile_grammar(
+ *          grammar text
+ *          )
+ *      RETURNS TEXT
+ *      AS '$libdir/address_standardizer2-2.0', 'as_compile_grammar'
+ *      LANGUAGE 'c' STABLE STRICT;
+ *
+ * The result can be passed as the grammar to as_standardize(),
+ * as_standardize_batch() and as_match(), it is loaded without parsing.
+ *
+*/
+PG_FUNCTION_INFO_V1(as_compile_grammar);
+
+Datum as_compile_grammar(PG_FUNCTION_ARGS)
+{
+    char *grammar;
+    char *cstr = NULL;
+    char *err_msg = NULL;
+    char *pstr;
+
+    grammar = text2char(PG_GETARG_TEXT_P(0));
+
+    cstr = serialize_grammar( grammar, &err_msg );
+    if ( err_msg != NULL )
+        elog(ERROR, "as_compile_grammar threw an error: %s", err_msg);
+    if (!cstr)
+        elog(ERROR, "grammar failed to compile!");
+
+    pstr = pstrdup(cstr);
+    free(cstr);
+
+    PG_RETURN_TEXT_P(cstring_to_text(pstr));
+}
+
+
 /*
  *  CREATE OR REPLACE FUNCTION as_standardize(
  *          address text,
@@ -178,22 +315,21 @@ Datum as_compile_lexicon(PG_FUNCTION_ARGS)
  *
 */
 
-PG_FUNCTION_INFO_V1(as_standardize);
-
-Datum as_standardize(PG_FUNCTION_ARGS)
+static Datum as_standardize_common(FunctionCallInfo fcinfo, bool lex_binary)
 {
     TupleDesc            tuple_desc;
-    AttInMetadata       *attinmeta;
     char                *address;
+#ifndef USE_QUERY_CACHE
     char                *grammar;
     char                *lexicon;
+#endif
     char                *locale;
     char                *filter;
     Datum                result;
     STDADDR             *stdaddr;
-    char               **values;
+    Datum                values[17];
+    bool                 nulls[17];
     HeapTuple            tuple;
-    int                  k;
     STANDARDIZER        *std;
     char                *err_msg; 
 
@@ -201,10 +337,6 @@ Datum as_standardize(PG_FUNCTION_ARGS)
 
     address = text2char(PG_GETARG_TEXT_P(0));
     DBG("address: '%s'", address);
-    grammar = text2char(PG_GETARG_TEXT_P(1));
-    DBG("grammar:\n '%s'", grammar);
-    lexicon = text2char(PG_GETARG_TEXT_P(2));
-    DBG("lexicon:\n '%s'", lexicon);
     locale  = text2char(PG_GETARG_TEXT_P(3));
     DBG("locale: '%s'", locale);
     filter  = text2char(PG_GETARG_TEXT_P(4));
@@ -215,7 +347,6 @@ Datum as_standardize(PG_FUNCTION_ARGS)
         elog(ERROR, "as_standardize() was called in a way that cannot accept record as a result");
     }
     BlessTupleDesc(tuple_desc);
-    attinmeta = TupleDescGetAttInMetadata(tuple_desc);
 
 /* 
    Code to implement a query level cache of the standardizer, so it does not
@@ -224,13 +355,19 @@ Datum as_standardize(PG_FUNCTION_ARGS)
 */
 
 #ifdef USE_QUERY_CACHE
-    std = GetStdUsingFCInfo( fcinfo, lexicon, grammar );
+    /* the grammar and lexicon are only copied out when not cached */
+    std = GetStdUsingFCInfo( fcinfo, 2, 1, lex_binary );
     if (!std)
         elog(ERROR, "as_standardize() failed to create the address standardizer object!");
 
     DBG("calling std_standardize('%s')", address);
-    stdaddr = std_standardize_ptrs( address, std->gmr_obj, std->lex_obj, locale, filter, &err_msg );
+    stdaddr = standardize_with( std, address, locale, filter, &err_msg );
 #else
+    grammar = text2char(PG_GETARG_TEXT_P(1));
+    DBG("grammar:\n '%s'", grammar);
+    lexicon = text2char(PG_GETARG_TEXT_P(2));
+    DBG("lexicon:\n '%s'", lexicon);
+
     DBG("calling std_standardize('%s')", address);
     stdaddr = std_standardize(address, grammar, lexicon, locale, filter, &err_msg);
 #endif
@@ -239,33 +376,11 @@ Datum as_standardize(PG_FUNCTION_ARGS)
     if ( err_msg != NULL )
         DBG("std_standardize threw an error: %s", err_msg);
 
-    values = (char **) palloc(17 * sizeof(char *));
-    for (k=0; k<17; k++) {
-        values[k] = NULL;
-    }
     DBG("setup values array for natts=%d", tuple_desc->natts);
-    if (stdaddr) {
-        values[0] = stdaddr->building   ? pstrdup(stdaddr->building) : NULL;
-        values[1] = stdaddr->house_num  ? pstrdup(stdaddr->house_num) : NULL;
-        values[2] = stdaddr->predir     ? pstrdup(stdaddr->predir) : NULL;
-        values[3] = stdaddr->qual       ? pstrdup(stdaddr->qual) : NULL;
-        values[4] = stdaddr->pretype    ? pstrdup(stdaddr->pretype) : NULL;
-        values[5] = stdaddr->name       ? pstrdup(stdaddr->name) : NULL;
-        values[6] = stdaddr->suftype    ? pstrdup(stdaddr->suftype) : NULL;
-        values[7] = stdaddr->sufdir     ? pstrdup(stdaddr->sufdir) : NULL;
-        values[8] = stdaddr->ruralroute ? pstrdup(stdaddr->ruralroute) : NULL;
-        values[9] = stdaddr->extra      ? pstrdup(stdaddr->extra) : NULL;
-        values[10] = stdaddr->city      ? pstrdup(stdaddr->city) : NULL;
-        values[11] = stdaddr->prov      ? pstrdup(stdaddr->prov) : NULL;
-        values[12] = stdaddr->country   ? pstrdup(stdaddr->country) : NULL;
-        values[13] = stdaddr->postcode  ? pstrdup(stdaddr->postcode) : NULL;
-        values[14] = stdaddr->box       ? pstrdup(stdaddr->box) : NULL;
-        values[15] = stdaddr->unit      ? pstrdup(stdaddr->unit) : NULL;
-        values[16] = stdaddr->pattern   ? pstrdup(stdaddr->pattern) : NULL;
-    }
+    stdaddr_to_datums(stdaddr, values, nulls);
 
     DBG("calling heap_form_tuple");
-    tuple = BuildTupleFromCStrings(attinmeta, values);
+    tuple = heap_form_tuple(tuple_desc, values, nulls);
 
     /* make the tuple into a datum */
     DBG("calling HeapTupleGetDatum");
@@ -280,6 +395,171 @@ Datum as_standardize(PG_FUNCTION_ARGS)
 }
 
 
+/* the lexicon argument is text or a compiled image, see GetStdUsingFCInfo() */
+PG_FUNCTION_INFO_V1(as_standardize);
+
+Datum as_standardize(PG_FUNCTION_ARGS)
+{
+    return as_standardize_common(fcinfo, false);
+}
+
+PG_FUNCTION_INFO_V1(as_standardize_bytea);
+
+Datum as_standardize_bytea(PG_FUNCTION_ARGS)
+{
+    return as_standardize_common(fcinfo, true);
+}
+
+
+
+/*
+ *  CREATE OR REPLACE FUNCTION as_standardize_batch(
+ *          addresses text[],
+ *          grammar text,
+ *          lexicon text,
+ *          locale text,
+ *          filter text,
+ *          OUT ordinal integer,
+ *          OUT building text,
+ *          ...                 -- the same columns as as_standardize()
+ *          OUT pattern text
+ *          )
+ *      RETURNS SETOF RECORD
+ *      AS '$libdir/address_standardizer2-2.0', 'as_standardize_batch'
+ *      LANGUAGE 'c' STABLE STRICT;
+ *
+ * Returns one row per element of addresses, ordinal is its position in
+ * the array starting at 1. A NULL element gives a row of NULLs. The
+ * standardizer is only looked up once for the whole array, so
+ * standardizing a table can be done in large chunks like:
+ *
+ *   select b.id[std.ordinal], std.*
+ *     from (select array_agg(id) as id, array_agg(address) as address
+ *             from rawdata.addresses
+ *            group by id / 10000) as b,
+ *          as_config as cfg,
+ *          LATERAL as_standardize_batch( b.address, grammar, clexicon,
+ *                 'en_AU', filter) as std
+ *    where countrycode='au' and dataset='gnaf'
+ *
+*/
+
+typedef struct
+{
+    Datum           *elems;
+    bool            *elem_nulls;
+    char            *locale;
+    char            *filter;
+    StdCallCache     call;
+}
+BatchState;
+
+static Datum as_standardize_batch_common(FunctionCallInfo fcinfo, bool lex_binary)
+{
+    FuncCallContext     *funcctx;
+    uint32_t             call_cntr;
+    uint32_t             max_calls;
+    TupleDesc            tuple_desc;
+    BatchState          *state;
+
+    DBG("Start as_standardize_batch");
+
+    if (SRF_IS_FIRSTCALL()) {
+        MemoryContext   oldcontext;
+        ArrayType      *addresses;
+        int             nelems;
+
+        // create a function context for cross-call persistence
+        funcctx = SRF_FIRSTCALL_INIT();
+
+        // switch to memory context appropriate for multiple function calls
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        state = (BatchState *) palloc0(sizeof(BatchState));
+        addresses = PG_GETARG_ARRAYTYPE_P(0);
+        if (ARR_NDIM(addresses) > 1)
+            elog(ERROR, "as_standardize_batch() expects a one dimensional array of addresses");
+        deconstruct_array(addresses, TEXTOID, -1, false, 'i',
+                          &state->elems, &state->elem_nulls, &nelems);
+        state->locale = text2char(PG_GETARG_TEXT_P(3));
+        state->filter = text2char(PG_GETARG_TEXT_P(4));
+        state->call.slot = -1;
+
+        if (get_call_result_type( fcinfo, NULL, &tuple_desc ) != TYPEFUNC_COMPOSITE ) {
+            elog(ERROR, "as_standardize_batch() was called in a way that cannot accept record as a result");
+        }
+        BlessTupleDesc(tuple_desc);
+
+        funcctx->max_calls = (uint32_t) nelems;
+        funcctx->user_fctx = state;
+        funcctx->tuple_desc = tuple_desc;
+
+        MemoryContextSwitchTo(oldcontext);
+    }
+
+    // stuff done on every call of the function
+    funcctx = SRF_PERCALL_SETUP();
+
+    call_cntr = funcctx->call_cntr;
+    max_calls = funcctx->max_calls;
+    tuple_desc = funcctx->tuple_desc;
+    state = (BatchState *) funcctx->user_fctx;
+
+    if (call_cntr < max_calls)    // do when there is more left to send
+    {
+        HeapTuple       tuple;
+        Datum           values[18];
+        bool            nulls[18];
+        STDADDR        *stdaddr = NULL;
+
+        if (!state->elem_nulls[call_cntr]) {
+            STANDARDIZER   *std;
+            char           *address;
+            char           *err_msg = NULL;
+
+            /* only a real lookup the first time, the arguments are fixed */
+            std = GetStdUsingCallCache( fcinfo, &state->call, 2, 1, lex_binary );
+            if (!std)
+                elog(ERROR, "as_standardize_batch() failed to create the address standardizer object!");
+
+            address = TextDatumGetCString(state->elems[call_cntr]);
+            stdaddr = standardize_with( std, address, state->locale, state->filter, &err_msg );
+            if ( err_msg != NULL )
+                DBG("std_standardize threw an error: %s", err_msg);
+            pfree(address);
+        }
+
+        values[0] = Int32GetDatum((int32) call_cntr + 1);
+        nulls[0] = false;
+        stdaddr_to_datums(stdaddr, values + 1, nulls + 1);
+        stdaddr_free(stdaddr);
+
+        tuple = heap_form_tuple(tuple_desc, values, nulls);
+
+        SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+    }
+    else    // do when there is no more left
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+}
+
+
+/* the lexicon argument is text or a compiled image, see GetStdUsingFCInfo() */
+PG_FUNCTION_INFO_V1(as_standardize_batch);
+
+Datum as_standardize_batch(PG_FUNCTION_ARGS)
+{
+    return as_standardize_batch_common(fcinfo, false);
+}
+
+PG_FUNCTION_INFO_V1(as_standardize_batch_bytea);
+
+Datum as_standardize_batch_bytea(PG_FUNCTION_ARGS)
+{
+    return as_standardize_batch_common(fcinfo, true);
+}
+
 
 /*
  *  CREATE OR REPLACE FUNCTION as_parse(
@@ -300,9 +580,7 @@ Datum as_standardize(PG_FUNCTION_ARGS)
  *
 */
 
-PG_FUNCTION_INFO_V1(as_parse);
-
-Datum as_parse(PG_FUNCTION_ARGS)
+static Datum as_parse_common(FunctionCallInfo fcinfo, bool lex_binary)
 {
     FuncCallContext     *funcctx;
     uint32_t             call_cntr;
@@ -310,11 +588,11 @@ Datum as_parse(PG_FUNCTION_ARGS)
 
     TupleDesc            tuple_desc;
     char                *address;
-    char                *lexicon;
     char                *locale;
     char                *filter;
     TOKENS              *tokens;
     STANDARDIZER        *std;
+    StdCallCache         call;
 
     DBG("Start as_parse");
 
@@ -334,24 +612,19 @@ Datum as_parse(PG_FUNCTION_ARGS)
 
         address = text2char(PG_GETARG_TEXT_P(0));
         DBG("address: '%s'", address);
-        lexicon = text2char(PG_GETARG_TEXT_P(1));
-        DBG("lexicon:\n '%s'", lexicon);
         locale  = text2char(PG_GETARG_TEXT_P(2));
         DBG("locale: '%s'", locale);
         filter  = text2char(PG_GETARG_TEXT_P(3));
         DBG("filter: '%s'", filter);
 
-#if 0
-        std = GetStdUsingFCInfo( fcinfo, lexicon, "" );
+        /* fn_extra belongs to the SRF so there is no memo between calls */
+        call.slot = -1;
+        std = GetStdUsingCallCache( fcinfo, &call, 1, -1, lex_binary );
         if (!std)
             elog(ERROR, "as_parse() failed to create the address standardizer object!");
 
-        DBG("calling std_parse_address('%s')", address);
+        DBG("calling std_parse_address_ptrs('%s')", address);
         tokens = std_parse_address_ptrs( address, std->lex_obj, locale, filter, &nrec, &err_msg );
-#else
-        DBG("calling std_parse_address('%s')", address);
-        tokens = std_parse_address(address, lexicon, locale, filter, &nrec, &err_msg);
-#endif
         DBG("back from std_parse_address, nrec=%d", nrec);
 
         if ( err_msg != NULL )
@@ -428,6 +701,22 @@ Datum as_parse(PG_FUNCTION_ARGS)
 }
 
 
+/* the lexicon argument is text or a compiled image, see GetStdUsingFCInfo() */
+PG_FUNCTION_INFO_V1(as_parse);
+
+Datum as_parse(PG_FUNCTION_ARGS)
+{
+    return as_parse_common(fcinfo, false);
+}
+
+PG_FUNCTION_INFO_V1(as_parse_bytea);
+
+Datum as_parse_bytea(PG_FUNCTION_ARGS)
+{
+    return as_parse_common(fcinfo, true);
+}
+
+
 /*
  *  CREATE OR REPLACE FUNCTION as_match(
  *          address text,
@@ -437,7 +726,7 @@ Datum as_parse(PG_FUNCTION_ARGS)
  *          filter text,
  *          OUT tokens text,
  *          OUT score float,
- *          OUT score nrules
+ *          OUT nrules float
  *          )
  *      RETURNS SETOF RECORD
  *      AS '$libdir/address_standardizer-2.0', 'match'
@@ -446,9 +735,7 @@ Datum as_parse(PG_FUNCTION_ARGS)
  *
 */
 
-PG_FUNCTION_INFO_V1(as_match);
-
-Datum as_match(PG_FUNCTION_ARGS)
+static Datum as_match_common(FunctionCallInfo fcinfo, bool lex_binary)
 {
     FuncCallContext     *funcctx;
     uint32_t             call_cntr;
@@ -456,11 +743,11 @@ Datum as_match(PG_FUNCTION_ARGS)
 
     TupleDesc            tuple_desc;
     char                *address;
-    char                *grammar;
-    char                *lexicon;
     char                *locale;
     char                *filter;
     MTOKEN              *tokens;
+    STANDARDIZER        *std;
+    StdCallCache         call;
     int                  i;
 
     DBG("Start as_match");
@@ -481,17 +768,22 @@ Datum as_match(PG_FUNCTION_ARGS)
 
         address = text2char(PG_GETARG_TEXT_P(0));
         DBG("address: '%s'", address);
-        grammar = text2char(PG_GETARG_TEXT_P(1));
-        //DBG("grammar:\n '%s'", grammar);
-        lexicon = text2char(PG_GETARG_TEXT_P(2));
-        //DBG("lexicon:\n '%s'", lexicon);
         locale  = text2char(PG_GETARG_TEXT_P(3));
         DBG("locale: '%s'", locale);
         filter  = text2char(PG_GETARG_TEXT_P(4));
         DBG("filter: '%s'", filter);
 
-        DBG("calling std_match_address('%s')", address);
-        tokens = std_match_address(address, grammar, lexicon, locale, filter, &nrec, &err_msg);
+        /* fn_extra belongs to the SRF so there is no memo between calls */
+        call.slot = -1;
+        std = GetStdUsingCallCache( fcinfo, &call, 2, 1, lex_binary );
+        if (!std)
+            elog(ERROR, "as_match() failed to create the address standardizer object!");
+
+        DBG("calling std_match_address_ptrs('%s')", address);
+        if (std->gmr_obj)
+            tokens = std_match_address_ptrs( address, std->gmr_obj, std->lex_obj, locale, filter, &nrec, &err_msg );
+        else
+            tokens = std_match_address_model( address, std->model_obj, locale, filter, &nrec, &err_msg );
         DBG("back from std_match_address");
 
         if ( err_msg != NULL )
@@ -559,3 +851,418 @@ Datum as_match(PG_FUNCTION_ARGS)
     }
 }
 
+
+/* the lexicon argument is text or a compiled image, see GetStdUsingFCInfo() */
+PG_FUNCTION_INFO_V1(as_match);
+
+Datum as_match(PG_FUNCTION_ARGS)
+{
+    return as_match_common(fcinfo, false);
+}
+
+PG_FUNCTION_INFO_V1(as_match_bytea);
+
+Datum as_match_bytea(PG_FUNCTION_ARGS)
+{
+    return as_match_common(fcinfo, true);
+}
+
+
+/*
+ *  CREATE OR REPLACE FUNCTION as_explain(
+ *          address text,
+ *          grammar text,
+ *          lexicon text,
+ *          locale text,
+ *          filter text,
+ *          OUT kind text,
+ *          OUT name text,
+ *          OUT value float8,
+ *          OUT detail text
+ *          )
+ *      RETURNS SETOF RECORD
+ *      AS '$libdir/address_standardizer2-2.0', 'as_explain'
+ *      LANGUAGE 'c' VOLATILE STRICT;
+ *
+ *  Standardizes one address and returns what was done and what it
+ *  cost, see STDEXPLAIN. The first row has kind cache and name hit or
+ *  miss for the lookup of the standardizer in the backend cache, its
+ *  value is the number of standardizers in the cache.
+ *
+ *    select * from as_explain('123 oak ln e n mycity ny usa',
+ *                             grammar, clexicon, 'en_US', filter)
+ *     where kind = 'section' order by value desc;
+ *
+*/
+
+static Datum as_explain_common(FunctionCallInfo fcinfo, bool lex_binary)
+{
+    FuncCallContext     *funcctx;
+    uint32_t             call_cntr;
+    uint32_t             max_calls;
+    TupleDesc            tuple_desc;
+    STDEXPLAIN          *rows;
+
+    if (SRF_IS_FIRSTCALL()) {
+        MemoryContext   oldcontext;
+        char           *address;
+        char           *locale;
+        char           *filter;
+        STANDARDIZER   *std;
+        StdCallCache    call;
+        StdCacheStats   before;
+        StdCacheStats   after;
+        STDEXPLAIN     *crows;
+        int nrec = 0;
+        int i;
+        char *err_msg;
+
+        // create a function context for cross-call persistence
+        funcctx = SRF_FIRSTCALL_INIT();
+
+        // switch to memory context appropriate for multiple function calls
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        address = text2char(PG_GETARG_TEXT_P(0));
+        locale  = text2char(PG_GETARG_TEXT_P(3));
+        filter  = text2char(PG_GETARG_TEXT_P(4));
+
+        GetStdCacheStats(&before);
+        call.slot = -1;
+        std = GetStdUsingCallCache( fcinfo, &call, 2, 1, lex_binary );
+        if (!std)
+            elog(ERROR, "as_explain() failed to create the address standardizer object!");
+        GetStdCacheStats(&after);
+
+        if (std->gmr_obj)
+            crows = std_explain_ptrs( address, std->gmr_obj, std->lex_obj, locale, filter, &nrec, &err_msg );
+        else
+            crows = std_explain_model( address, std->model_obj, locale, filter, &nrec, &err_msg );
+        if (err_msg != NULL)
+            elog(ERROR, "as_explain: %s", err_msg);
+
+        // copy them after the cache row so the malloc()ed ones can be freed now
+        rows = (STDEXPLAIN *) palloc(sizeof(STDEXPLAIN) * (nrec + 1));
+        rows[0].kind = pstrdup("cache");
+        rows[0].name = pstrdup(after.hits > before.hits ? "hit" : "miss");
+        rows[0].value = (double) after.entries;
+        rows[0].detail = pstrdup("");
+        for (i=0; i<nrec; i++) {
+            rows[i+1].kind = pstrdup(crows[i].kind);
+            rows[i+1].name = pstrdup(crows[i].name);
+            rows[i+1].value = crows[i].value;
+            rows[i+1].detail = pstrdup(crows[i].detail);
+        }
+        std_explain_free( crows, nrec );
+
+        if (get_call_result_type( fcinfo, NULL, &tuple_desc ) != TYPEFUNC_COMPOSITE ) {
+            elog(ERROR, "as_explain() was called in a way that cannot accept record as a result");
+        }
+        BlessTupleDesc(tuple_desc);
+
+        funcctx->max_calls = (uint32_t) (nrec + 1);
+        funcctx->user_fctx = rows;
+        funcctx->tuple_desc = tuple_desc;
+
+        MemoryContextSwitchTo(oldcontext);
+    }
+
+    // stuff done on every call of the function
+    funcctx = SRF_PERCALL_SETUP();
+
+    call_cntr = funcctx->call_cntr;
+    max_calls = funcctx->max_calls;
+    tuple_desc = funcctx->tuple_desc;
+    rows = (STDEXPLAIN *) funcctx->user_fctx;
+
+    if (call_cntr < max_calls)    // do when there is more left to send
+    {
+        HeapTuple    tuple;
+        Datum        values[4];
+        bool         nulls[4];
+
+        memset(nulls, 0, sizeof(nulls));
+        values[0] = CStringGetTextDatum(rows[call_cntr].kind);
+        values[1] = CStringGetTextDatum(rows[call_cntr].name);
+        values[2] = Float8GetDatum(rows[call_cntr].value);
+        values[3] = CStringGetTextDatum(rows[call_cntr].detail);
+
+        tuple = heap_form_tuple(tuple_desc, values, nulls);
+
+        SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+    }
+    else    // do when there is no more left
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+}
+
+
+/* the lexicon argument is text or a compiled image, see GetStdUsingFCInfo() */
+PG_FUNCTION_INFO_V1(as_explain);
+
+Datum as_explain(PG_FUNCTION_ARGS)
+{
+    return as_explain_common(fcinfo, false);
+}
+
+PG_FUNCTION_INFO_V1(as_explain_bytea);
+
+Datum as_explain_bytea(PG_FUNCTION_ARGS)
+{
+    return as_explain_common(fcinfo, true);
+}
+
+
+/*
+ *  CREATE OR REPLACE FUNCTION as_cache_stats(
+ *          OUT cache_size integer,
+ *          OUT entries integer,
+ *          OUT hits bigint,
+ *          OUT misses bigint,
+ *          OUT evictions bigint,
+ *          OUT memory bigint
+ *          )
+ *      RETURNS RECORD
+ *      AS '$libdir/address_standardizer2-2.0', 'as_cache_stats'
+ *      LANGUAGE 'c' VOLATILE STRICT;
+ *
+ *  The counters are for the standardizer cache of the current backend.
+ *
+*/
+
+PG_FUNCTION_INFO_V1(as_cache_stats);
+
+Datum as_cache_stats(PG_FUNCTION_ARGS)
+{
+    TupleDesc            tuple_desc;
+    StdCacheStats        stats;
+    HeapTuple            tuple;
+    Datum                values[6];
+    bool                 nulls[6];
+
+    if (get_call_result_type( fcinfo, NULL, &tuple_desc ) != TYPEFUNC_COMPOSITE ) {
+        elog(ERROR, "as_cache_stats() was called in a way that cannot accept record as a result");
+    }
+    BlessTupleDesc(tuple_desc);
+
+    GetStdCacheStats(&stats);
+
+    memset(nulls, 0, sizeof(nulls));
+    values[0] = Int32GetDatum(stats.size);
+    values[1] = Int32GetDatum(stats.entries);
+    values[2] = Int64GetDatum(stats.hits);
+    values[3] = Int64GetDatum(stats.misses);
+    values[4] = Int64GetDatum(stats.evictions);
+    values[5] = Int64GetDatum(stats.memory);
+
+    tuple = heap_form_tuple(tuple_desc, values, nulls);
+    PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
+
+
+/*
+ *  CREATE OR REPLACE FUNCTION as_cache_entries(
+ *          OUT slot integer,
+ *          OUT lex_md5 text,
+ *          OUT gmr_md5 text,
+ *          OUT hits bigint,
+ *          OUT build_ms float8,
+ *          OUT memory bigint,
+ *          OUT idle bigint,
+ *          OUT shared boolean
+ *          )
+ *      RETURNS SETOF RECORD
+ *      AS '$libdir/address_standardizer2-2.0', 'as_cache_entries'
+ *      LANGUAGE 'c' VOLATILE STRICT;
+ *
+ *  One row for each standardizer in the cache of the current backend.
+ *
+*/
+
+PG_FUNCTION_INFO_V1(as_cache_entries);
+
+Datum as_cache_entries(PG_FUNCTION_ARGS)
+{
+    FuncCallContext     *funcctx;
+    uint32_t             call_cntr;
+    uint32_t             max_calls;
+    TupleDesc            tuple_desc;
+    StdCacheEntryStats  *entries;
+
+    if (SRF_IS_FIRSTCALL()) {
+        MemoryContext   oldcontext;
+        int nrec;
+
+        // create a function context for cross-call persistence
+        funcctx = SRF_FIRSTCALL_INIT();
+
+        // switch to memory context appropriate for multiple function calls
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        nrec = GetStdCacheEntryStats(&entries);
+
+        if (get_call_result_type( fcinfo, NULL, &tuple_desc ) != TYPEFUNC_COMPOSITE ) {
+            elog(ERROR, "as_cache_entries() was called in a way that cannot accept record as a result");
+        }
+        BlessTupleDesc(tuple_desc);
+
+        funcctx->max_calls = (uint32_t) nrec;
+        funcctx->user_fctx = entries;
+        funcctx->tuple_desc = tuple_desc;
+
+        MemoryContextSwitchTo(oldcontext);
+    }
+
+    // stuff done on every call of the function
+    funcctx = SRF_PERCALL_SETUP();
+
+    call_cntr = funcctx->call_cntr;
+    max_calls = funcctx->max_calls;
+    tuple_desc = funcctx->tuple_desc;
+    entries = (StdCacheEntryStats *) funcctx->user_fctx;
+
+    if (call_cntr < max_calls)    // do when there is more left to send
+    {
+        HeapTuple    tuple;
+        Datum        values[8];
+        bool         nulls[8];
+
+        memset(nulls, 0, sizeof(nulls));
+        values[0] = Int32GetDatum(entries[call_cntr].slot + 1);
+        values[1] = CStringGetTextDatum(entries[call_cntr].lex_md5);
+        values[2] = CStringGetTextDatum(entries[call_cntr].gmr_md5);
+        values[3] = Int64GetDatum(entries[call_cntr].hits);
+        values[4] = Float8GetDatum(entries[call_cntr].build_ms);
+        values[5] = Int64GetDatum(entries[call_cntr].memory);
+        values[6] = Int64GetDatum(entries[call_cntr].idle);
+        values[7] = BoolGetDatum(entries[call_cntr].shared);
+
+        tuple = heap_form_tuple(tuple_desc, values, nulls);
+
+        SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+    }
+    else    // do when there is no more left
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+}
+
+
+/*
+ *  CREATE OR REPLACE FUNCTION as_stage_stats(
+ *          OUT stage text,
+ *          OUT counter boolean,
+ *          OUT samples bigint,
+ *          OUT mean float8,
+ *          OUT p50 float8,
+ *          OUT p90 float8,
+ *          OUT p99 float8,
+ *          OUT max float8
+ *          )
+ *      RETURNS SETOF RECORD
+ *      AS '$libdir/address_standardizer2-2.0', 'as_stage_stats'
+ *      LANGUAGE 'c' VOLATILE STRICT;
+ *
+ *  One row for each stage and counter recorded by the current backend
+ *  while address_standardizer2.instrument is on. Stages are in
+ *  microseconds, counters are per address.
+ *
+*/
+
+PG_FUNCTION_INFO_V1(as_stage_stats);
+
+Datum as_stage_stats(PG_FUNCTION_ARGS)
+{
+    FuncCallContext     *funcctx;
+    uint32_t             call_cntr;
+    uint32_t             max_calls;
+    TupleDesc            tuple_desc;
+    STDSTAT             *stats;
+
+    if (SRF_IS_FIRSTCALL()) {
+        MemoryContext   oldcontext;
+        STDSTAT        *cstats = NULL;
+        int nrec;
+        int i;
+
+        // create a function context for cross-call persistence
+        funcctx = SRF_FIRSTCALL_INIT();
+
+        // switch to memory context appropriate for multiple function calls
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        nrec = std_instrument_stats( &cstats );
+        if (nrec < 0)
+            elog(ERROR, "as_stage_stats: could not read the stage figures");
+
+        // copy them so the malloc()ed ones can be freed now
+        stats = (STDSTAT *) palloc(sizeof(STDSTAT) * (nrec > 0 ? nrec : 1));
+        for (i=0; i<nrec; i++) {
+            stats[i] = cstats[i];
+            stats[i].name = pstrdup(cstats[i].name);
+        }
+        std_instrument_stats_free( cstats, nrec );
+
+        if (get_call_result_type( fcinfo, NULL, &tuple_desc ) != TYPEFUNC_COMPOSITE ) {
+            elog(ERROR, "as_stage_stats() was called in a way that cannot accept record as a result");
+        }
+        BlessTupleDesc(tuple_desc);
+
+        funcctx->max_calls = (uint32_t) nrec;
+        funcctx->user_fctx = stats;
+        funcctx->tuple_desc = tuple_desc;
+
+        MemoryContextSwitchTo(oldcontext);
+    }
+
+    // stuff done on every call of the function
+    funcctx = SRF_PERCALL_SETUP();
+
+    call_cntr = funcctx->call_cntr;
+    max_calls = funcctx->max_calls;
+    tuple_desc = funcctx->tuple_desc;
+    stats = (STDSTAT *) funcctx->user_fctx;
+
+    if (call_cntr < max_calls)    // do when there is more left to send
+    {
+        HeapTuple    tuple;
+        Datum        values[8];
+        bool         nulls[8];
+
+        memset(nulls, 0, sizeof(nulls));
+        values[0] = CStringGetTextDatum(stats[call_cntr].name);
+        values[1] = BoolGetDatum(stats[call_cntr].counter != 0);
+        values[2] = Int64GetDatum((int64) stats[call_cntr].samples);
+        values[3] = Float8GetDatum(stats[call_cntr].mean);
+        values[4] = Float8GetDatum(stats[call_cntr].p50);
+        values[5] = Float8GetDatum(stats[call_cntr].p90);
+        values[6] = Float8GetDatum(stats[call_cntr].p99);
+        values[7] = Float8GetDatum(stats[call_cntr].max);
+
+        tuple = heap_form_tuple(tuple_desc, values, nulls);
+
+        SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+    }
+    else    // do when there is no more left
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+}
+
+
+/*
+ *  CREATE OR REPLACE FUNCTION as_stage_stats_reset()
+ *      RETURNS void
+ *      AS '$libdir/address_standardizer2-2.0', 'as_stage_stats_reset'
+ *      LANGUAGE 'c' VOLATILE STRICT;
+ *
+*/
+
+PG_FUNCTION_INFO_V1(as_stage_stats_reset);
+
+Datum as_stage_stats_reset(PG_FUNCTION_ARGS)
+{
+    std_instrument_reset();
+    PG_RETURN_VOID();
+}
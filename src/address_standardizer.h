@@ -36,14 +36,79 @@ typedef struct {
 } STDADDR;
 
 
+/*
+ * model_obj is set when the standardizer uses a model, lex_obj then
+ * points into it. When gmr_obj is NULL the model also holds the
+ * grammar, otherwise it only holds a compiled lexicon. shared is
+ * non-zero for a model file shared with other backends.
+ */
 typedef struct
 {
     void *lex_obj;
     void *gmr_obj;
+    void *model_obj;
+    int shared;
 }
 STANDARDIZER;
 
 
+/*
+ * limits on the work done to standardize one address, zero means
+ * unlimited. exceeded is set on return to zero or to the limit that
+ * was hit, in which case the result is the best one found so far.
+ *   1 - max_patterns, 2 - max_paths, 3 - max_expansions, 4 - deadline_ms
+ */
+typedef struct
+{
+    long max_patterns;
+    long max_paths;
+    long max_expansions;
+    long deadline_ms;
+    int exceeded;
+}
+STDBUDGET;
+
+
+/*
+ * one stage or counter of the instrumentation, see Instrument. For a
+ * stage the figures are microseconds, for a counter they are per
+ * address. samples is zero if nothing was recorded.
+ */
+typedef struct
+{
+    char *name;
+    int counter;
+    long unsigned int samples;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+}
+STDSTAT;
+
+
+/*
+ * one row of std_explain_ptrs(), what standardizing an address did and
+ * what it cost. kind is one of
+ *   token   - name is its position, detail the word and its classes,
+ *             value the number of classes
+ *   stage   - value is the microseconds spent in the stage
+ *   counter - value is the patterns, alternatives, paths or rules
+ *   section - value is the partial paths expanded at the grammar
+ *             section, detail is meta or rules
+ *   result  - the pattern matched with its score and the nrules
+ */
+typedef struct
+{
+    char *kind;
+    char *name;
+    double value;
+    char *detail;
+}
+STDEXPLAIN;
+
+
 typedef struct
 {
     int pat;
@@ -76,6 +141,59 @@ STDADDR *std_standardize_ptrs(
 );
 
 
+STDADDR *std_standardize_ptrs_budget(
+    char *address_in,
+    void *grammar_ptr,
+    void *lexicon_ptr,
+    char *locale_in,
+    char *filter_in,
+    STDBUDGET *budget,
+    char **err_msg
+);
+
+
+/*
+ * standardize using a model file opened with getModelPtr()
+ */
+STDADDR *std_standardize_model(
+    char *address_in,
+    void *model_ptr,
+    char *locale_in,
+    char *filter_in,
+    STDBUDGET *budget,
+    char **err_msg
+);
+
+
+/*
+ * standardize one address and return how it was done, the nrec rows
+ * are freed with std_explain_free(). The search runs on the calling
+ * thread even if std_parallel_search() is on.
+ */
+STDEXPLAIN *std_explain_ptrs(
+    char *address_in,
+    void *grammar_ptr,
+    void *lexicon_ptr,
+    char *locale_in,
+    char *filter_in,
+    int  *nrec,
+    char **err_msg
+);
+
+
+STDEXPLAIN *std_explain_model(
+    char *address_in,
+    void *model_ptr,
+    char *locale_in,
+    char *filter_in,
+    int  *nrec,
+    char **err_msg
+);
+
+
+void std_explain_free( STDEXPLAIN *rows, int nrec );
+
+
 STDADDR *std_standardize(
     char *address_in,
     char *grammar_in,
@@ -116,8 +234,67 @@ MTOKEN *std_match_address(
     char **err_msg
 );
 
+
+MTOKEN *std_match_address_ptrs(
+    char *address_in,
+    void *grammar_ptr,
+    void *lexicon_ptr,
+    char *locale_in,
+    char *filter_in,
+    int  *nrec,
+    char **err_msg
+);
+
+
+/*
+ * match using a model file opened with getModelPtr()
+ */
+MTOKEN *std_match_address_model(
+    char *address_in,
+    void *model_ptr,
+    char *locale_in,
+    char *filter_in,
+    int  *nrec,
+    char **err_msg
+);
+
 void tokens_free( TOKENS *tokens, int nrec );
 
+/*
+ * when on is non-zero the phrases of an address are searched
+ * concurrently on a process wide thread pool, off by default
+ */
+void std_parallel_search( int on );
+
+/*
+ * when on is non-zero serialize_lexicon() and serialize_lexicon_binary()
+ * parse the lexicon and build its regexes on the process wide thread
+ * pool, off by default
+ */
+void std_parallel_compile( int on );
+
+/*
+ * when on is non-zero getLexiconPtr() compacts the lexicon it loads
+ * into an FstLexiconStore, which takes far less memory for large
+ * gazetteers and standardizes the same, off by default
+ */
+void std_compact_lexicons( int on );
+
+/*
+ * when on is non-zero the time spent in each stage and the work done
+ * for each address is recorded, off by default. std_instrument_stats()
+ * returns the number of STDSTAT in stats, or -1 if it fails, they are
+ * freed with std_instrument_stats_free(). std_instrument_reset()
+ * starts the figures over.
+ */
+void std_instrument( int on );
+
+void std_instrument_reset( void );
+
+int std_instrument_stats( STDSTAT **stats );
+
+void std_instrument_stats_free( STDSTAT *stats, int n );
+
 void *getGrammarPtr( char *grammar_in, char **err_msg );
 
 void freeGrammarPtr( void *ptr );
@@ -126,17 +303,61 @@ void *getLexiconPtr( char *lexicon_in, char **err_msg );
 
 void freeLexiconPtr( void *ptr );
 
+/*
+ * a model file is a compiled lexicon and grammar that is mmap()ed
+ * read-only, see ModelFile, the lexicon pointer returned for it can be
+ * passed to std_parse_address_ptrs() and is freed with the model
+ */
+void *getModelPtr( char *model_file, char **err_msg );
+
+void freeModelPtr( void *ptr );
+
+void *getModelLexiconPtr( void *ptr );
+
+/*
+ * load a model image held in memory, such as the output of
+ * serialize_lexicon_binary(), the image is copied so data may be freed
+ */
+void *getModelPtrFromImage( const char *data, long unsigned int size, char **err_msg );
+
+/*
+ * write the model file for a lexicon and grammar, returns zero and
+ * sets err_msg if it fails
+ */
+int writeModelFile( char *model_file, void *lexicon_ptr, void *grammar_ptr, char **err_msg );
+
 char *getGrammarMd5( void *ptr );
 
 char *getLexiconMd5( void *ptr );
 
 char *getMd5( char *text );
 
+char *getMd5Bytes( const char *data, long unsigned int size );
+
 char * serialize_lexicon(
     char *lexicon_in,
     char **err_msg
 );
 
+/*
+ * compile a grammar into a text archive, it can be passed in place of
+ * the grammar text and is loaded without parsing the rules again
+ */
+char * serialize_grammar(
+    char *grammar_in,
+    char **err_msg
+);
+
+/*
+ * compile a lexicon into a lexicon only model image, see ModelFile,
+ * the malloc()ed image is returned and its length set in size
+ */
+char * serialize_lexicon_binary(
+    char *lexicon_in,
+    long unsigned int *size,
+    char **err_msg
+);
+
 #ifdef __cplusplus
 }
 #endif
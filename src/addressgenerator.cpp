@@ -0,0 +1,245 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#include <stdexcept>
+
+#include "addressgenerator.h"
+
+
+namespace {
+
+// the classes are all below this, BADTOKEN is never generated
+const int CLASSES = 64;
+
+// a walk deeper than this is taken to be in a recursive section
+const unsigned int MAX_DEPTH = 32;
+
+// walks tried for one address before giving up
+const int MAX_TRIES = 1000;
+
+// addresses kept for repeating
+const long unsigned int MAX_SEEN = 10000;
+
+}
+
+
+AddressGenerator::AddressGenerator( const Grammar &G, const Lexicon &lex, unsigned int seed ) :
+    program_( G.program() ),
+    plain_( CLASSES ), ambiguous_( CLASSES ),
+    minTokens_( 1 ), maxTokens_( 0 ), ambiguity_( 0.0 ), duplicates_( 0.0 ),
+    rng_( seed )
+{
+    root_ = program_->find( "ADDRESS" );
+    if ( root_ == CompiledGrammar::NONE )
+        throw std::runtime_error( "AddressGenerator-No-ADDRESS-Section" );
+
+    lex.forEach( [this]( const std::string &key, const std::vector<LexEntry> &entries ) {
+        std::set<InClass::Type> types;
+        for ( const auto &e : entries ) {
+            // attached forms are only found glued to another word
+            bool detached = e.attached().empty();
+            for ( const auto &a : e.attached() )
+                if ( a == InClass::DET_PRE or a == InClass::DET_SUF )
+                    detached = true;
+            if ( not detached )
+                continue;
+            for ( const auto &t : e.type() )
+                if ( t >= 0 and t < CLASSES )
+                    types.insert( t );
+        }
+        for ( const auto &t : types ) {
+            if ( types.size() > 1 )
+                ambiguous_[t].push_back( key );
+            else
+                plain_[t].push_back( key );
+        }
+    } );
+}
+
+
+std::string AddressGenerator::next( std::vector<InClass::Type> *classes ) {
+    if ( not seen_.empty() and duplicates_ > 0.0
+         and std::uniform_real_distribution<double>( 0.0, 1.0 )( rng_ ) < duplicates_ ) {
+        const Address &a = seen_[pick( seen_.size() )];
+        if ( classes )
+            *classes = a.classes;
+        return a.text;
+    }
+
+    for ( int tries = 0; tries < MAX_TRIES; ++tries ) {
+        Address a;
+        if ( not expand( root_, 0, a.classes ) )
+            continue;
+        if ( a.classes.size() < minTokens_ or ( maxTokens_ and a.classes.size() > maxTokens_ ) )
+            continue;
+
+        bool ok = true;
+        for ( const auto &c : a.classes ) {
+            std::string w;
+            if ( not word( c, w ) ) {
+                ok = false;
+                break;
+            }
+            if ( not a.text.empty() )
+                a.text += " ";
+            a.text += w;
+        }
+        if ( not ok )
+            continue;
+
+        if ( seen_.size() < MAX_SEEN )
+            seen_.push_back( a );
+        else
+            seen_[pick( MAX_SEEN )] = a;
+        if ( classes )
+            *classes = a.classes;
+        return a.text;
+    }
+
+    throw std::runtime_error( "AddressGenerator-No-Address" );
+}
+
+
+bool AddressGenerator::expand( Index id, unsigned int depth, std::vector<InClass::Type> &classes ) {
+    if ( id == CompiledGrammar::NONE or depth > MAX_DEPTH )
+        return false;
+    if ( maxTokens_ and classes.size() > maxTokens_ )
+        return false;
+
+    const CompiledGrammar &cg = *program_;
+    const auto &section = cg.section( id );
+    if ( section.count == 0 )
+        return false;
+
+    if ( section.kind == CompiledGrammar::META ) {
+        const auto &alt = cg.alt( section.first + static_cast<Index>( pick( section.count ) ) );
+        const Index *refs = cg.refs( alt );
+        for ( Index k = 0; k < alt.count; ++k )
+            if ( not expand( refs[k], depth + 1, classes ) )
+                return false;
+    }
+    else {
+        const auto &rd = cg.ruleDef( section.first + static_cast<Index>( pick( section.count ) ) );
+        const auto *in = cg.in( rd );
+        for ( Index k = 0; k < rd.count; ++k )
+            classes.push_back( static_cast<InClass::Type>( in[k] ) );
+    }
+    return true;
+}
+
+
+bool AddressGenerator::word( InClass::Type type, std::string &text ) {
+    static const std::vector<std::string> none;
+    const auto &plain = ( type >= 0 and type < CLASSES ) ? plain_[type] : none;
+    const auto &ambiguous = ( type >= 0 and type < CLASSES ) ? ambiguous_[type] : none;
+
+    if ( not ambiguous.empty()
+         and std::uniform_real_distribution<double>( 0.0, 1.0 )( rng_ ) < ambiguity_ ) {
+        text = ambiguous[pick( ambiguous.size() )];
+        return true;
+    }
+    if ( madeUp( type, text ) )
+        return true;
+    if ( not plain.empty() ) {
+        text = plain[pick( plain.size() )];
+        return true;
+    }
+    if ( not ambiguous.empty() ) {
+        text = ambiguous[pick( ambiguous.size() )];
+        return true;
+    }
+    return false;
+}
+
+
+bool AddressGenerator::madeUp( InClass::Type type, std::string &text ) {
+    // what the tokenizer puts in these classes without the lexicon
+    switch ( type ) {
+        case InClass::NUMBER:
+            text = digits( 1 + pick( 3 ), false );
+            return true;
+        case InClass::QUAD:
+            text = digits( 4, false );
+            return true;
+        case InClass::QUINT:
+            text = digits( 5, true );
+            return true;
+        case InClass::WORD:
+            text = name( 4 + pick( 6 ) );
+            return true;
+        case InClass::SINGLE:
+            text = std::string( 1, static_cast<char>( 'A' + pick( 26 ) ) );
+            return true;
+        case InClass::DOUBLE:
+            text = std::string( 1, static_cast<char>( 'A' + pick( 26 ) ) )
+                 + static_cast<char>( 'A' + pick( 26 ) );
+            return true;
+        case InClass::MIXED:
+            text = digits( 1 + pick( 3 ), false ) + static_cast<char>( 'A' + pick( 26 ) );
+            return true;
+        case InClass::FRACT:
+            text = "1/" + std::string( 1, static_cast<char>( '2' + pick( 3 ) ) );
+            return true;
+        case InClass::PCH:
+            text = std::string( 1, static_cast<char>( 'A' + pick( 26 ) ) )
+                 + static_cast<char>( '0' + pick( 10 ) )
+                 + static_cast<char>( 'A' + pick( 26 ) );
+            return true;
+        case InClass::PCT:
+            text = std::string( 1, static_cast<char>( '0' + pick( 10 ) ) )
+                 + static_cast<char>( 'A' + pick( 26 ) )
+                 + static_cast<char>( '0' + pick( 10 ) );
+            return true;
+        case InClass::DASH:
+            text = "-";
+            return true;
+        case InClass::AMPERS:
+            text = "&";
+            return true;
+        case InClass::SLASH:
+            text = "/";
+            return true;
+        case InClass::ATSIGN:
+            text = "@";
+            return true;
+        case InClass::COMMA:
+            text = ",";
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+// consonants and vowels in turn so it reads like a name
+std::string AddressGenerator::name( long unsigned int letters ) {
+    static const char consonants[] = "BCDFGHKLMNPRSTVWZ";
+    static const char vowels[] = "AEIOU";
+    std::string w;
+    for ( long unsigned int i = 0; i < letters; ++i )
+        w += ( i % 2 ) ? vowels[pick( sizeof(vowels) - 1 )] : consonants[pick( sizeof(consonants) - 1 )];
+    return w;
+}
+
+
+std::string AddressGenerator::digits( long unsigned int n, bool leadingZero ) {
+    std::string d;
+    for ( long unsigned int i = 0; i < n; ++i )
+        d += static_cast<char>( ( i == 0 and not leadingZero ) ? '1' + pick( 9 ) : '0' + pick( 10 ) );
+    return d;
+}
+
+
+long unsigned int AddressGenerator::pick( long unsigned int n ) {
+    return std::uniform_int_distribution<long unsigned int>( 0, n - 1 )( rng_ );
+}
@@ -0,0 +1,105 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#ifndef ADDRESSGENERATOR_H
+#define ADDRESSGENERATOR_H
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "compiledgrammar.h"
+#include "grammar.h"
+#include "inclass.h"
+#include "lexicon.h"
+
+/*
+ * AddressGenerator makes up addresses that a Grammar and Lexicon will
+ * parse, for load testing a model without real address data.
+ *
+ * Starting at the ADDRESS section it picks a random alternative of each
+ * meta section and a random rule of each rule section, which gives a
+ * sequence of input classes the grammar accepts. Each class is then
+ * filled with text the tokenizer puts in that class on its own, like
+ * digits for NUMBER or QUINT and a made up name for WORD, or else with
+ * a word of that class from the lexicon.
+ *
+ * The same seed always gives the same addresses. The controls are:
+ *
+ *   minTokens, maxTokens - bounds on the tokens per address, the walk
+ *                          is retried until it falls inside them, zero
+ *                          for maxTokens means no limit
+ *   ambiguity            - 0 to 1, how often a word is picked from the
+ *                          words that have more than one class, which
+ *                          gives the search more patterns to try
+ *   duplicates           - 0 to 1, the fraction of addresses that repeat
+ *                          one that was generated before
+ */
+class AddressGenerator
+{
+public:
+
+    AddressGenerator( const Grammar &G, const Lexicon &lex, unsigned int seed = 1 );
+
+    void minTokens( long unsigned int n ) { minTokens_ = n; };
+    void maxTokens( long unsigned int n ) { maxTokens_ = n; };
+    void ambiguity( double p ) { ambiguity_ = p; };
+    void duplicates( double p ) { duplicates_ = p; };
+
+    long unsigned int minTokens() const { return minTokens_; };
+    long unsigned int maxTokens() const { return maxTokens_; };
+    double ambiguity() const { return ambiguity_; };
+    double duplicates() const { return duplicates_; };
+
+    // the next address, classes gets the class of each of its tokens
+    // throws if no address can be made within the bounds
+    std::string next( std::vector<InClass::Type> *classes = NULL );
+
+private:
+
+    typedef CompiledGrammar::Index Index;
+
+    struct Address {
+        std::string text;
+        std::vector<InClass::Type> classes;
+    };
+
+    // append the classes of a random expansion of section id
+    bool expand( Index id, unsigned int depth, std::vector<InClass::Type> &classes );
+    // text for one token of class type, false if there is none
+    bool word( InClass::Type type, std::string &text );
+    // text the tokenizer puts in class type without the lexicon
+    bool madeUp( InClass::Type type, std::string &text );
+    std::string name( long unsigned int letters );
+    std::string digits( long unsigned int n, bool leadingZero );
+    long unsigned int pick( long unsigned int n );
+
+    std::shared_ptr<const CompiledGrammar> program_;
+    Index root_;
+
+    // lexicon words by class, split by whether the word has other classes
+    std::vector<std::vector<std::string> > plain_;
+    std::vector<std::vector<std::string> > ambiguous_;
+
+    long unsigned int minTokens_;
+    long unsigned int maxTokens_;
+    double ambiguity_;
+    double duplicates_;
+
+    std::mt19937 rng_;
+    std::vector<Address> seen_;
+
+};
+
+#endif
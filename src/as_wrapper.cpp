@@ -30,21 +30,180 @@
 #include "tokenizer.h"
 #include "grammar.h"
 #include "search.h"
+#include "searchbudget.h"
+#include "threadpool.h"
 #include "md5.h"
+#include "modelfile.h"
+#include "instrument.h"
 
 #include "address_standardizer.h"
 
 
-STDADDR *standardize_addr( char *address_in, Grammar & grammar, Lexicon & lexicon, char *locale_in, char *filter_in, char **err_msg);
+// what standardize_addr() did for one address, see std_explain_ptrs()
+struct Explain {
+    Explain() : score( -1.0 ), nrules( -1.0 ) {};
+    std::vector<Token> phrase;      // before the search
+    std::string matched;
+    float score;
+    float nrules;
+    SearchProfile profile;
+    uint64_t nanos[Instrument::STAGES];
+    uint64_t counts[Instrument::COUNTERS];
+};
 
+STDADDR *standardize_addr( char *address_in, std::shared_ptr<const CompiledGrammar> program, Lexicon & lexicon, char *locale_in, char *filter_in, STDBUDGET *budget, Explain *explain, char **err_msg);
+
+
+static bool parallel_search = false;
+
+void std_parallel_search( int on )
+{
+    parallel_search = ( on != 0 );
+}
+
+
+static bool parallel_compile = false;
+
+void std_parallel_compile( int on )
+{
+    parallel_compile = ( on != 0 );
+}
+
+
+static bool compact_lexicons = false;
+
+void std_compact_lexicons( int on )
+{
+    compact_lexicons = ( on != 0 );
+}
+
+
+
+void std_instrument( int on )
+{
+    Instrument::enable( on != 0 );
+}
+
+void std_instrument_reset( void )
+{
+    Instrument::reset();
+}
+
+int std_instrument_stats( STDSTAT **stats )
+{
+    try {
+        const int n = Instrument::STAGES + Instrument::COUNTERS;
+        STDSTAT *out = (STDSTAT *) calloc( sizeof(STDSTAT), n );
+        if ( ! out )
+            return -1;
+
+        for ( int i = 0; i < n; ++i ) {
+            Instrument::Histogram h;
+            double scale = 1.0;
+            if ( i < Instrument::STAGES ) {
+                auto s = static_cast<Instrument::Stage>( i );
+                h = Instrument::stage( s );
+                out[i].name = strdup( Instrument::asString( s ).c_str() );
+                scale = 1000.0;
+            }
+            else {
+                auto c = static_cast<Instrument::Counter>( i - Instrument::STAGES );
+                h = Instrument::counter( c );
+                out[i].name = strdup( Instrument::asString( c ).c_str() );
+                out[i].counter = 1;
+            }
+            out[i].samples = h.count();
+            out[i].mean = h.mean() / scale;
+            out[i].p50 = h.percentile( 50.0 ) / scale;
+            out[i].p90 = h.percentile( 90.0 ) / scale;
+            out[i].p99 = h.percentile( 99.0 ) / scale;
+            out[i].max = h.max() / scale;
+        }
+
+        *stats = out;
+        return n;
+    }
+    catch ( ... ) {
+        return -1;
+    }
+}
+
+void std_instrument_stats_free( STDSTAT *stats, int n )
+{
+    if ( ! stats ) return;
+    for ( int i = 0; i < n; ++i )
+        free( stats[i].name );
+    free( stats );
+}
+
+
+// a grammar is either the text form or a text archive of a compiled
+// Grammar from serialize_grammar(), the archive is not re-parsed
+static Grammar *newGrammar( const std::string &s )
+{
+    std::istringstream iss( s );
+    std::unique_ptr<Grammar> grammar( new Grammar );
+    try {
+        boost::archive::text_iarchive ia(iss);
+        ia >> *grammar;
+        return grammar.release();
+    }
+    catch ( boost::archive::archive_exception & ) {
+        // not an archive
+    }
+    iss.clear();
+    iss.str( s );
+    return new Grammar( iss );
+}
 
 
 STDADDR *std_standardize_ptrs( char *address_in, void *grammar_ptr, void *lexicon_ptr, char *locale_in, char *filter_in, char **err_msg)
 {
     return standardize_addr( address_in,
-                             *(static_cast<Grammar*>( grammar_ptr )),
+                             static_cast<Grammar*>( grammar_ptr )->program(),
                              *(static_cast<Lexicon*>( lexicon_ptr )),
-                             locale_in, filter_in, err_msg );
+                             locale_in, filter_in, NULL, NULL, err_msg );
+}
+
+
+
+STDADDR *std_standardize_ptrs_budget( char *address_in, void *grammar_ptr, void *lexicon_ptr, char *locale_in, char *filter_in, STDBUDGET *budget, char **err_msg)
+{
+    return standardize_addr( address_in,
+                             static_cast<Grammar*>( grammar_ptr )->program(),
+                             *(static_cast<Lexicon*>( lexicon_ptr )),
+                             locale_in, filter_in, budget, NULL, err_msg );
+}
+
+
+
+STDADDR *std_standardize_model( char *address_in, void *model_ptr, char *locale_in, char *filter_in, STDBUDGET *budget, char **err_msg)
+{
+    ModelFile *model = static_cast<ModelFile*>( model_ptr );
+    return standardize_addr( address_in, model->program(), model->lexicon(),
+                             locale_in, filter_in, budget, NULL, err_msg );
+}
+
+
+
+STDEXPLAIN *explain_addr( char *address_in, std::shared_ptr<const CompiledGrammar> program, Lexicon & lexicon, char *locale_in, char *filter_in, int *nrec, char **err_msg );
+
+
+STDEXPLAIN *std_explain_ptrs( char *address_in, void *grammar_ptr, void *lexicon_ptr, char *locale_in, char *filter_in, int *nrec, char **err_msg)
+{
+    return explain_addr( address_in,
+                         static_cast<Grammar*>( grammar_ptr )->program(),
+                         *(static_cast<Lexicon*>( lexicon_ptr )),
+                         locale_in, filter_in, nrec, err_msg );
+}
+
+
+
+STDEXPLAIN *std_explain_model( char *address_in, void *model_ptr, char *locale_in, char *filter_in, int *nrec, char **err_msg)
+{
+    ModelFile *model = static_cast<ModelFile*>( model_ptr );
+    return explain_addr( address_in, model->program(), model->lexicon(),
+                         locale_in, filter_in, nrec, err_msg );
 }
 
 
@@ -53,13 +212,10 @@ STDADDR *std_standardize( char *address_in, char *grammar_in, char *lexicon_in,
 {
     try {
 
-        std::string s( grammar_in );
-        std::istringstream iss( s );
-        Grammar grammar( iss );
+        std::unique_ptr<Grammar> grammar( newGrammar( grammar_in ) );
 
-        s = lexicon_in;
-        iss.clear();
-        iss.str( s );
+        std::string s( lexicon_in );
+        std::istringstream iss( s );
         Lexicon lexicon;
         try {
             boost::archive::text_iarchive ia(iss);
@@ -80,7 +236,7 @@ STDADDR *std_standardize( char *address_in, char *grammar_in, char *lexicon_in,
             lexicon.initialize( iss );
         }
 
-        return standardize_addr( address_in, grammar, lexicon, locale_in, filter_in, err_msg );
+        return standardize_addr( address_in, grammar->program(), lexicon, locale_in, filter_in, NULL, NULL, err_msg );
 
     }
     catch ( std::runtime_error &e ) {
@@ -98,36 +254,75 @@ STDADDR *std_standardize( char *address_in, char *grammar_in, char *lexicon_in,
 }
 
 
-STDADDR *standardize_addr( char *address_in, Grammar & grammar, Lexicon & lexicon, char *locale_in, char *filter_in, char **err_msg)
+STDADDR *standardize_addr( char *address_in, std::shared_ptr<const CompiledGrammar> program, Lexicon & lexicon, char *locale_in, char *filter_in, STDBUDGET *budget, Explain *explain, char **err_msg)
 {
     try {
+        Instrument::Address address( explain != NULL );
+
+        // copy what the address cost into explain
+        auto explained = [&]() {
+            if ( ! explain )
+                return;
+            for ( int i = 0; i < Instrument::STAGES; ++i )
+                explain->nanos[i] = address.nanos( static_cast<Instrument::Stage>( i ) );
+            for ( int i = 0; i < Instrument::COUNTERS; ++i )
+                explain->counts[i] = address.counter( static_cast<Instrument::Counter>( i ) );
+        };
+
+        // the clock starts before we do any work on the address
+        SearchBudget searchBudget;
+        if ( budget ) {
+            searchBudget.maxPatterns( static_cast<long unsigned int>( std::max( budget->max_patterns, 0L ) ) );
+            searchBudget.maxPaths( static_cast<long unsigned int>( std::max( budget->max_paths, 0L ) ) );
+            searchBudget.maxExpansions( static_cast<long unsigned int>( std::max( budget->max_expansions, 0L ) ) );
+            searchBudget.deadline( static_cast<long unsigned int>( std::max( budget->deadline_ms, 0L ) ) );
+            searchBudget.start();
+            budget->exceeded = 0;
+        }
+
         // Normalize and UPPERCASE the input string
+        Instrument::Timer normalize( Instrument::NORMALIZE );
         UErrorCode errorCode;
         std::string nstr = Utils::normalizeUTF8( std::string(address_in), errorCode );
         std::string Ustr = Utils::upperCaseUTF8( nstr, locale_in );
+        normalize.stop();
 
         Tokenizer tokenizer( lexicon );
         tokenizer.filter( InClass::asType( filter_in ) );
 
-        std::vector<std::vector<Token> > phrases;
-        phrases.push_back( tokenizer.getTokens( Ustr ) );
-
-        auto alts = tokenizer.getAltTokens( phrases.back() );
-        for (const auto &a : alts)
-            phrases.push_back( a );
-
-        Search search( grammar );
+        // the alternate phrases are only generated as the search needs them
+        std::vector<Token> phrase = tokenizer.getTokens( Ustr );
+        AltTokens alts = tokenizer.altTokens( phrase, true, budget ? &searchBudget : NULL );
+
+        Search search( program );
+        if ( budget )
+            search.budget( &searchBudget );
+        if ( parallel_search )
+            search.pool( &ThreadPool::instance() );
+        if ( explain ) {
+            explain->phrase = phrase;
+            search.profile( &explain->profile );
+        }
 
         float bestCost = -1.0;
         float bestNrules = -1.0;
         std::string matched;
-        auto best = search.searchAndReclassBest( phrases, bestCost, matched, bestNrules );
+        auto best = search.searchAndReclassBest( phrase, alts, bestCost, matched, bestNrules );
+
+        if ( budget )
+            budget->exceeded = static_cast<int>( searchBudget.limit() );
+        if ( explain ) {
+            explain->matched = matched;
+            explain->score = bestCost;
+            explain->nrules = bestNrules;
+        }
 
         if ( bestCost >= 0.0 ) {
 
             // get the appropriate standard terms and
             // collect then by their outclass
             // return them in STDADDR
+            Instrument::Timer standardize( Instrument::STANDARDIZE );
             std::vector<std::string> v_stdaddr(16, "");
             for (auto &token : best) {
                 lexicon.standardize( token );
@@ -190,9 +385,12 @@ STDADDR *standardize_addr( char *address_in, Grammar & grammar, Lexicon & lexico
                 }
             }
 
+            standardize.stop();
+
             // allocate memory and fill up the STDADDR structure
             // using C-style allocation because it will get
             // freed on the C side of things.
+            Instrument::Timer output( Instrument::OUTPUT );
             STDADDR *stdaddr    = (STDADDR*) calloc( sizeof(STDADDR), 1 );
             if ( ! stdaddr ) {
                 *err_msg = strdup( "Out of memory!" );
@@ -264,10 +462,13 @@ STDADDR *standardize_addr( char *address_in, Grammar & grammar, Lexicon & lexico
                 stdaddr->unit       = strdup( v_stdaddr[15].c_str() );
             }
             stdaddr->pattern        = strdup( matched.c_str() );
+            output.stop();
+            explained();
             *err_msg = (char *)0;
             return stdaddr;
         }
         // we failed to match
+        explained();
         *err_msg = (char *)0;
         return NULL;
     }
@@ -287,6 +488,128 @@ STDADDR *standardize_addr( char *address_in, Grammar & grammar, Lexicon & lexico
 }
 
 
+static void freeStdaddr( STDADDR *stdaddr )
+{
+    if ( ! stdaddr ) return;
+    free( stdaddr->building );
+    free( stdaddr->house_num );
+    free( stdaddr->predir );
+    free( stdaddr->qual );
+    free( stdaddr->pretype );
+    free( stdaddr->name );
+    free( stdaddr->suftype );
+    free( stdaddr->sufdir );
+    free( stdaddr->ruralroute );
+    free( stdaddr->extra );
+    free( stdaddr->city );
+    free( stdaddr->prov );
+    free( stdaddr->country );
+    free( stdaddr->postcode );
+    free( stdaddr->box );
+    free( stdaddr->unit );
+    free( stdaddr->pattern );
+    free( stdaddr );
+}
+
+
+STDEXPLAIN *explain_addr( char *address_in, std::shared_ptr<const CompiledGrammar> program, Lexicon & lexicon, char *locale_in, char *filter_in, int *nrec, char **err_msg )
+{
+    try {
+        Explain explain;
+        STDADDR *stdaddr = standardize_addr( address_in, program, lexicon, locale_in, filter_in, NULL, &explain, err_msg );
+        if ( *err_msg )
+            return NULL;
+        freeStdaddr( stdaddr );
+
+        struct Row {
+            std::string kind;
+            std::string name;
+            double value;
+            std::string detail;
+        };
+        std::vector<Row> rows;
+
+        // the tokens and the classes the search can pick from
+        int i = 0;
+        for ( const auto &t : explain.phrase ) {
+            std::string detail = t.text() + ": " + t.inclassAsString();
+            if ( not t.attached().empty() )
+                detail += " attached " + t.attachedAsString();
+            rows.push_back( Row{ "token", std::to_string( i++ ), static_cast<double>( t.inSize() ), detail } );
+        }
+
+        // microseconds in each stage that ran
+        for ( int s = 0; s < Instrument::STAGES; ++s ) {
+            if ( explain.nanos[s] == 0 )
+                continue;
+            rows.push_back( Row{ "stage", Instrument::asString( static_cast<Instrument::Stage>( s ) ),
+                                 static_cast<double>( explain.nanos[s] ) / 1000.0, "" } );
+        }
+
+        for ( int c = 0; c < Instrument::COUNTERS; ++c )
+            rows.push_back( Row{ "counter", Instrument::asString( static_cast<Instrument::Counter>( c ) ),
+                                 static_cast<double>( explain.counts[c] ), "" } );
+
+        // the grammar sections the search spent its paths on, most first
+        const auto &paths = explain.profile.paths;
+        std::vector<CompiledGrammar::Index> sections;
+        for ( CompiledGrammar::Index id = 0; id < paths.size(); ++id )
+            if ( paths[id] )
+                sections.push_back( id );
+        std::stable_sort( sections.begin(), sections.end(),
+            [&paths]( CompiledGrammar::Index a, CompiledGrammar::Index b ) { return paths[a] > paths[b]; } );
+        for ( const auto id : sections )
+            rows.push_back( Row{ "section", program->name( id ), static_cast<double>( paths[id] ),
+                                 program->section( id ).kind == CompiledGrammar::META ? "meta" : "rules" } );
+
+        rows.push_back( Row{ "result", "pattern", explain.score, explain.matched } );
+        rows.push_back( Row{ "result", "nrules", explain.nrules, "" } );
+
+        STDEXPLAIN *out = (STDEXPLAIN *) calloc( sizeof(STDEXPLAIN), rows.size() );
+        if ( ! out ) {
+            *err_msg = strdup( "Out of memory!" );
+            return NULL;
+        }
+        int k = 0;
+        for ( const auto &r : rows ) {
+            out[k].kind = strdup( r.kind.c_str() );
+            out[k].name = strdup( r.name.c_str() );
+            out[k].value = r.value;
+            out[k].detail = strdup( r.detail.c_str() );
+            ++k;
+        }
+
+        *nrec = k;
+        *err_msg = (char *)0;
+        return out;
+    }
+    catch ( std::runtime_error &e ) {
+        *err_msg = strdup( e.what() );
+        return NULL;
+    }
+    catch ( std::exception &e ) {
+        *err_msg = strdup( e.what() );
+        return NULL;
+    }
+    catch ( ... ) {
+        *err_msg = strdup( "Caught unknown expection!" );
+        return NULL;
+    }
+}
+
+
+void std_explain_free( STDEXPLAIN *rows, int nrec )
+{
+    if ( ! rows ) return;
+    for ( int i = 0; i < nrec; ++i ) {
+        free( rows[i].kind );
+        free( rows[i].name );
+        free( rows[i].detail );
+    }
+    free( rows );
+}
+
+
 TOKENS *parse_addr( char *address_in, Lexicon & lexicon, char *locale_in, char *filter_in, int *nrec, char **err_msg);
 
 
@@ -347,10 +670,14 @@ TOKENS *std_parse_address( char *address_in, char *lexicon_in, char *locale_in,
 TOKENS *parse_addr( char *address_in, Lexicon & lexicon, char *locale_in, char *filter_in, int *nrec, char **err_msg)
 {
     try {
+        Instrument::Address address;
+
         // Normalize and UPPERCASE the input string
+        Instrument::Timer normalize( Instrument::NORMALIZE );
         UErrorCode errorCode;
         std::string nstr = Utils::normalizeUTF8( std::string(address_in), errorCode );
         std::string Ustr = Utils::upperCaseUTF8( nstr, locale_in );
+        normalize.stop();
 
         Tokenizer tokenizer( lexicon );
         tokenizer.filter( InClass::asType( filter_in ) );
@@ -362,6 +689,7 @@ TOKENS *parse_addr( char *address_in, Lexicon & lexicon, char *locale_in, char *
         for (const auto &a : alts)
             phrases.push_back( a );
 
+        Instrument::Timer output( Instrument::OUTPUT );
         long unsigned int cnt = 0;
         for ( const auto &phrase : phrases )
             cnt += phrase.size();
@@ -408,20 +736,17 @@ TOKENS *parse_addr( char *address_in, Lexicon & lexicon, char *locale_in, char *
 }
 
 
-MTOKEN *match_addr( char *address_in, Grammar & grammar, Lexicon & lexicon, char *locale_in, char *filter_in, int *nrec, char **err_msg);
+MTOKEN *match_addr( char *address_in, std::shared_ptr<const CompiledGrammar> program, Lexicon & lexicon, char *locale_in, char *filter_in, int *nrec, char **err_msg);
 
 
 MTOKEN *std_match_address( char *address_in, char *grammar_in, char *lexicon_in, char *locale_in, char * filter_in, int *nrec, char **err_msg)
 {
     try {
 
-        std::string s( grammar_in );
-        std::istringstream iss( s );
-        Grammar grammar( iss );
+        std::unique_ptr<Grammar> grammar( newGrammar( grammar_in ) );
 
-        s = lexicon_in;
-        iss.clear();
-        iss.str( s );
+        std::string s( lexicon_in );
+        std::istringstream iss( s );
         Lexicon lexicon;
         try {
             boost::archive::text_iarchive ia(iss);
@@ -442,7 +767,7 @@ MTOKEN *std_match_address( char *address_in, char *grammar_in, char *lexicon_in,
             lexicon.initialize( iss );
         }
 
-        return match_addr( address_in, grammar, lexicon, locale_in, filter_in, nrec, err_msg );
+        return match_addr( address_in, grammar->program(), lexicon, locale_in, filter_in, nrec, err_msg );
 
     }
     catch ( std::runtime_error &e ) {
@@ -460,18 +785,39 @@ MTOKEN *std_match_address( char *address_in, char *grammar_in, char *lexicon_in,
 }
 
 
+MTOKEN *std_match_address_ptrs( char *address_in, void *grammar_ptr, void *lexicon_ptr, char *locale_in, char *filter_in, int *nrec, char **err_msg)
+{
+    return match_addr( address_in,
+                       static_cast<Grammar*>( grammar_ptr )->program(),
+                       *(static_cast<Lexicon*>( lexicon_ptr )),
+                       locale_in, filter_in, nrec, err_msg );
+}
+
+
+MTOKEN *std_match_address_model( char *address_in, void *model_ptr, char *locale_in, char *filter_in, int *nrec, char **err_msg)
+{
+    ModelFile *model = static_cast<ModelFile*>( model_ptr );
+    return match_addr( address_in, model->program(), model->lexicon(),
+                       locale_in, filter_in, nrec, err_msg );
+}
+
+
 bool sortByScoresDesc( const MatchResult &lhs, const MatchResult &rhs) {
     return lhs.score > rhs.score;
 }
 
 
-MTOKEN *match_addr( char *address_in, Grammar & grammar, Lexicon & lexicon, char *locale_in, char *filter_in, int *nrec, char **err_msg)
+MTOKEN *match_addr( char *address_in, std::shared_ptr<const CompiledGrammar> program, Lexicon & lexicon, char *locale_in, char *filter_in, int *nrec, char **err_msg)
 {
     try {
+        Instrument::Address address;
+
         // Normalize and UPPERCASE the input string
+        Instrument::Timer normalize( Instrument::NORMALIZE );
         UErrorCode errorCode;
         std::string nstr = Utils::normalizeUTF8( std::string(address_in), errorCode );
         std::string Ustr = Utils::upperCaseUTF8( nstr, locale_in );
+        normalize.stop();
 
         Tokenizer tokenizer( lexicon );
         tokenizer.filter( InClass::asType( filter_in ) );
@@ -483,7 +829,7 @@ MTOKEN *match_addr( char *address_in, Grammar & grammar, Lexicon & lexicon, char
         for (const auto &a : alts)
             phrases.push_back( a );
 
-        Search search( grammar );
+        Search search( program );
 
         std::vector<double> scores;
         std::vector<double> nrules;
@@ -491,6 +837,7 @@ MTOKEN *match_addr( char *address_in, Grammar & grammar, Lexicon & lexicon, char
 
         std::sort( toks.begin(), toks.end(), sortByScoresDesc );
 
+        Instrument::Timer output( Instrument::OUTPUT );
         MTOKEN * tokens = (MTOKEN *) calloc( sizeof(MTOKEN), toks.size() );
         if ( ! tokens ) {
             *err_msg = strdup( "Out of memory!" );
@@ -528,9 +875,7 @@ MTOKEN *match_addr( char *address_in, Grammar & grammar, Lexicon & lexicon, char
 void *getGrammarPtr( char *grammar_in, char **err_msg )
 {
     try {
-        std::string s( grammar_in );
-        std::istringstream iss( s );
-        Grammar* grammar = new Grammar( iss );
+        Grammar* grammar = newGrammar( grammar_in );
         return static_cast<void*>(grammar);
     }
     catch ( std::runtime_error &e ) {
@@ -581,6 +926,8 @@ void *getLexiconPtr( char *lexicon_in, char **err_msg )
             lexicon->name( "query-lex" );
             lexicon->initialize( iss );
         }
+        if ( compact_lexicons )
+            lexicon->compact();
         return static_cast<void*>(lexicon);
     }
     catch ( std::runtime_error &e ) {
@@ -607,6 +954,63 @@ void freeLexiconPtr( void *ptr )
     }
 }
 
+void *getModelPtr( char *model_file, char **err_msg )
+{
+    try {
+        ModelFile* model = new ModelFile( std::string( model_file ) );
+        return static_cast<void*>(model);
+    }
+    catch ( std::runtime_error &e ) {
+        *err_msg = strdup( e.what() );
+        return NULL;
+    }
+    catch ( std::exception &e ) {
+        *err_msg = strdup( e.what() );
+        return NULL;
+    }
+    catch ( ... ) {
+        *err_msg = strdup( "Caught unknown expection trying to load the Model!" );
+        return NULL;
+    }
+}
+
+void freeModelPtr( void *ptr )
+{
+    try {
+        delete static_cast<ModelFile*>(ptr);
+    }
+    catch ( ... ) {
+        // NOP
+    }
+}
+
+void *getModelLexiconPtr( void *ptr )
+{
+    return static_cast<void*>( &static_cast<ModelFile*>(ptr)->lexicon() );
+}
+
+int writeModelFile( char *model_file, void *lexicon_ptr, void *grammar_ptr, char **err_msg )
+{
+    try {
+        ModelFile::write( std::string( model_file ),
+                          *(static_cast<Lexicon*>( lexicon_ptr )),
+                          *(static_cast<Grammar*>( grammar_ptr )) );
+        return 1;
+    }
+    catch ( std::runtime_error &e ) {
+        *err_msg = strdup( e.what() );
+        return 0;
+    }
+    catch ( std::exception &e ) {
+        *err_msg = strdup( e.what() );
+        return 0;
+    }
+    catch ( ... ) {
+        *err_msg = strdup( "Caught unknown expection trying to write the Model!" );
+        return 0;
+    }
+}
+
 char *getGrammarMd5( void *ptr )
 {
     try {
@@ -646,13 +1050,13 @@ char * serialize_lexicon( char *lexicon_in, char **err_msg )
         std::string s( lexicon_in );
         std::istringstream iss( s );
 
+        ThreadPool *pool = parallel_compile ? &ThreadPool::instance() : NULL;
+
         // create the lexicon object
-        Lexicon lex( "query-lex", iss );
+        Lexicon lex( "query-lex", iss, pool );
 
         // populate the regex strings in the Lexicon
-        lex.regex();
-        lex.regexPrefixAtt();
-        lex.regexSuffixAtt();
+        lex.compile( pool );
 
         // serialize the lexicon object into a string stream
         std::ostringstream ofs;
@@ -684,3 +1088,112 @@ char * serialize_lexicon( char *lexicon_in, char **err_msg )
     }
     
 }
+
+char * serialize_grammar( char *grammar_in, char **err_msg )
+{
+    try {
+
+        // parse and check the grammar
+        std::string s( grammar_in );
+        std::istringstream iss( s );
+        Grammar grammar( iss );
+
+        // serialize the grammar object into a string stream
+        std::ostringstream ofs;
+        boost::archive::text_oarchive oa(ofs);
+        oa << grammar;
+
+        *err_msg = (char *)0;
+        return strdup( ofs.str().c_str() );
+
+    }
+    catch ( std::runtime_error &e ) {
+        *err_msg = strdup( e.what() );
+        return NULL;
+    }
+    catch ( std::exception &e ) {
+        *err_msg = strdup( e.what() );
+        return NULL;
+    }
+    catch ( ... ) {
+        *err_msg = strdup( "Caught unknown expection!" );
+        return NULL;
+    }
+}
+
+char * serialize_lexicon_binary( char *lexicon_in, long unsigned int *size, char **err_msg )
+{
+    try {
+
+        // put the lexicon into a string stream
+        std::string s( lexicon_in );
+        std::istringstream iss( s );
+
+        ThreadPool *pool = parallel_compile ? &ThreadPool::instance() : NULL;
+
+        // create the lexicon object
+        Lexicon lex( "query-lex", iss, pool );
+        lex.compile( pool );
+
+        // write it as a lexicon only model image
+        std::ostringstream ofs;
+        ModelFile::write( ofs, lex );
+        std::string image = ofs.str();
+
+        char *out = static_cast<char *>( malloc( image.size() ) );
+        if ( ! out ) {
+            *err_msg = strdup( "Out of memory!" );
+            return NULL;
+        }
+        memcpy( out, image.data(), image.size() );
+        *size = image.size();
+
+        *err_msg = (char *)0;
+        return out;
+
+    }
+    catch ( std::runtime_error &e ) {
+        *err_msg = strdup( e.what() );
+        return NULL;
+    }
+    catch ( std::exception &e ) {
+        *err_msg = strdup( e.what() );
+        return NULL;
+    }
+    catch ( ... ) {
+        *err_msg = strdup( "Caught unknown expection!" );
+        return NULL;
+    }
+}
+
+void *getModelPtrFromImage( const char *data, long unsigned int size, char **err_msg )
+{
+    try {
+        // always copied so the caller can free data
+        ModelFile* model = new ModelFile( static_cast<const void *>( data ), size, true );
+        return static_cast<void*>(model);
+    }
+    catch ( std::runtime_error &e ) {
+        *err_msg = strdup( e.what() );
+        return NULL;
+    }
+    catch ( std::exception &e ) {
+        *err_msg = strdup( e.what() );
+        return NULL;
+    }
+    catch ( ... ) {
+        *err_msg = strdup( "Caught unknown expection trying to load the Model!" );
+        return NULL;
+    }
+}
+
+char *getMd5Bytes( const char *data, long unsigned int size )
+{
+    try {
+        std::string md5str = md5( std::string( data, size ) );
+        return strdup( md5str.c_str() );
+    }
+    catch ( ... ) {
+        return NULL;
+    }
+}
@@ -0,0 +1,479 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+/*
+ * bench - repeatable timings of the stages of standardizing an address
+ *
+ * Usage: bench [-n iterations] [-w warmup] [-p] [-c] [-m model] [-o out.json] suite.txt
+ *
+ * Each line of the suite names a model and the addresses to time it on:
+ *
+ *     name  locale  filter  lexicon  grammar  corpus
+ *
+ * Paths are relative to the suite file. A corpus is a file with one
+ * address per line, or a perl test script like data/test-usa-patterns,
+ * recognized by its #! line, whose addresses are the single quoted
+ * keys of its %expect hash.
+ *
+ * Every stage is run on every address of the corpus warmup times and
+ * then iterations times, each call is timed on its own. The results
+ * are written as JSON in the order of the suite with a fixed layout so
+ * two runs can be compared with compare.pl.
+ *
+ * -p also reads the hardware perf counters around every call and adds
+ * their mean per address to each stage, an event the host does not
+ * provide is written as null.
+ *
+ * -c compacts the lexicons as they are loaded, see std_compact_lexicons().
+ *
+ * The optimization flags bench was built with are written in the build
+ * object of the JSON, the Makefile builds it with OPT, -O2 by default.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "address_standardizer.h"
+#include "grammar.h"
+#include "inclass.h"
+#include "lexicon.h"
+#include "perfcounters.h"
+#include "search.h"
+#include "token.h"
+#include "tokenizer.h"
+#include "utils.h"
+
+// set by the Makefile to the optimization flags of the build
+#ifndef BENCH_OPT
+#define BENCH_OPT "unknown"
+#endif
+
+
+struct Model {
+    std::string name;
+    std::string locale;
+    std::string filter;
+    std::string lexicon;
+    std::string grammar;
+    std::string corpus;
+};
+
+
+struct Stage {
+    std::string name;
+    long unsigned int calls;
+    double seconds;
+    std::vector<uint64_t> samples;      // nanoseconds per call
+    bool perf;
+    uint64_t counts[PerfCounters::EVENTS];  // summed over the calls
+    uint64_t valid[PerfCounters::EVENTS];   // calls the event was read for
+};
+
+
+// keeps the compiler from dropping the work being timed
+static volatile long unsigned int sink = 0;
+
+
+static std::string readFile( const std::string &file ) {
+    std::ifstream in( file );
+    if ( in.fail() )
+        throw std::runtime_error( "Bench-Can-Not-Read: " + file );
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+
+static std::string trim( const std::string &s ) {
+    long unsigned int b = s.find_first_not_of( " \t\r\n" );
+    if ( b == std::string::npos )
+        return "";
+    long unsigned int e = s.find_last_not_of( " \t\r\n" );
+    return s.substr( b, e - b + 1 );
+}
+
+
+static std::string relativeTo( const std::string &base, const std::string &path ) {
+    if ( path.empty() or path[0] == '/' )
+        return path;
+    long unsigned int slash = base.rfind( '/' );
+    if ( slash == std::string::npos )
+        return path;
+    return base.substr( 0, slash + 1 ) + path;
+}
+
+
+static std::vector<Model> readSuite( const std::string &file ) {
+    std::vector<Model> models;
+    std::istringstream in( readFile( file ) );
+    std::string line;
+    while ( std::getline( in, line ) ) {
+        line = trim( line );
+        if ( line.empty() or line[0] == '#' )
+            continue;
+        std::istringstream fields( line );
+        Model m;
+        if ( not ( fields >> m.name >> m.locale >> m.filter >> m.lexicon >> m.grammar >> m.corpus ) )
+            throw std::runtime_error( "Bench-Bad-Suite-Line: " + line );
+        m.lexicon = relativeTo( file, m.lexicon );
+        m.grammar = relativeTo( file, m.grammar );
+        m.corpus  = relativeTo( file, m.corpus );
+        models.push_back( m );
+    }
+    return models;
+}
+
+
+static std::vector<std::string> readCorpus( const std::string &file ) {
+    std::vector<std::string> addresses;
+    std::istringstream in( readFile( file ) );
+    std::string line;
+    bool perl = false;
+    bool first = true;
+    while ( std::getline( in, line ) ) {
+        if ( first and line.compare( 0, 2, "#!" ) == 0 )
+            perl = true;
+        first = false;
+        line = trim( line );
+        if ( perl ) {
+            // only the keys, a line that is nothing but a quoted string
+            if ( line.size() > 2 and line[0] == '\'' and line[line.size() - 1] == '\''
+                 and line.find( '\'', 1 ) == line.size() - 1 )
+                addresses.push_back( line.substr( 1, line.size() - 2 ) );
+        }
+        else if ( not line.empty() and line[0] != '#' )
+            addresses.push_back( line );
+    }
+    if ( addresses.empty() )
+        throw std::runtime_error( "Bench-Empty-Corpus: " + file );
+    return addresses;
+}
+
+
+static void stdaddrFree( STDADDR *sa ) {
+    if ( not sa )
+        return;
+    free( sa->building );
+    free( sa->house_num );
+    free( sa->predir );
+    free( sa->qual );
+    free( sa->pretype );
+    free( sa->name );
+    free( sa->suftype );
+    free( sa->sufdir );
+    free( sa->ruralroute );
+    free( sa->extra );
+    free( sa->city );
+    free( sa->prov );
+    free( sa->country );
+    free( sa->postcode );
+    free( sa->box );
+    free( sa->unit );
+    free( sa->pattern );
+    free( sa );
+}
+
+
+static double elapsedMs( std::chrono::steady_clock::time_point t0 ) {
+    return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - t0 ).count();
+}
+
+
+// run fn on every address, first warmup times without keeping the
+// timings and then iterations times
+// the perf counters are read outside of the timed part of a call
+static Stage run( const std::string &name, long unsigned int n, int warmup, int iterations, bool perf,
+                  const std::function<long unsigned int(long unsigned int)> &fn ) {
+    Stage stage;
+    stage.name = name;
+    stage.calls = 0;
+    stage.seconds = 0.0;
+    stage.samples.reserve( n * static_cast<long unsigned int>( iterations ) );
+    stage.perf = perf;
+    for ( int e = 0; e < PerfCounters::EVENTS; ++e ) {
+        stage.counts[e] = 0;
+        stage.valid[e] = 0;
+    }
+
+    const PerfCounters &pc = PerfCounters::thread();
+    PerfCounters::Sample before, after;
+    for ( int it = 0; it < warmup + iterations; ++it ) {
+        for ( long unsigned int i = 0; i < n; ++i ) {
+            if ( perf )
+                pc.read( before );
+            auto t0 = std::chrono::steady_clock::now();
+            sink = sink + fn( i );
+            auto t1 = std::chrono::steady_clock::now();
+            if ( perf )
+                pc.read( after );
+            if ( it < warmup )
+                continue;
+            if ( perf ) {
+                for ( int e = 0; e < PerfCounters::EVENTS; ++e ) {
+                    uint64_t d;
+                    if ( PerfCounters::delta( before, after, static_cast<PerfCounters::Event>( e ), d ) ) {
+                        stage.counts[e] += d;
+                        ++stage.valid[e];
+                    }
+                }
+            }
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count();
+            stage.samples.push_back( static_cast<uint64_t>( ns ) );
+            stage.seconds += static_cast<double>( ns ) / 1e9;
+            ++stage.calls;
+        }
+    }
+    std::sort( stage.samples.begin(), stage.samples.end() );
+    return stage;
+}
+
+
+// nearest rank percentile in microseconds
+static double percentile( const std::vector<uint64_t> &sorted, double p ) {
+    if ( sorted.empty() )
+        return 0.0;
+    long unsigned int rank = static_cast<long unsigned int>( p / 100.0 * static_cast<double>( sorted.size() ) + 0.999999 );
+    rank = std::max( rank, 1UL );
+    rank = std::min( rank, sorted.size() );
+    return static_cast<double>( sorted[rank - 1] ) / 1000.0;
+}
+
+
+static std::string quote( const std::string &s ) {
+    std::string q = "\"";
+    for ( const auto c : s ) {
+        if ( c == '"' or c == '\\' )
+            q += '\\';
+        q += c;
+    }
+    return q + "\"";
+}
+
+
+static std::string fixed( double v ) {
+    char buf[64];
+    snprintf( buf, sizeof(buf), "%.3f", v );
+    return buf;
+}
+
+
+static void writeStage( std::ostream &os, const Stage &s, bool last ) {
+    double mean = s.calls ? s.seconds * 1e6 / static_cast<double>( s.calls ) : 0.0;
+    double rate = s.seconds > 0.0 ? static_cast<double>( s.calls ) / s.seconds : 0.0;
+    os << "        { \"stage\": " << quote( s.name )
+       << ", \"calls\": " << s.calls
+       << ", \"seconds\": " << fixed( s.seconds )
+       << ", \"per_second\": " << fixed( rate )
+       << ", \"mean_us\": " << fixed( mean )
+       << ", \"p50_us\": " << fixed( percentile( s.samples, 50.0 ) )
+       << ", \"p90_us\": " << fixed( percentile( s.samples, 90.0 ) )
+       << ", \"p99_us\": " << fixed( percentile( s.samples, 99.0 ) )
+       << ", \"max_us\": " << fixed( percentile( s.samples, 100.0 ) );
+    if ( s.perf ) {
+        // means per address, null for the events that are not available
+        const PerfCounters &pc = PerfCounters::thread();
+        auto mean = [&s]( PerfCounters::Event e ) {
+            return s.valid[e] ? static_cast<double>( s.counts[e] ) / static_cast<double>( s.valid[e] ) : 0.0;
+        };
+        os << ", \"perf\": {";
+        for ( int e = 0; e < PerfCounters::EVENTS; ++e ) {
+            PerfCounters::Event ev = static_cast<PerfCounters::Event>( e );
+            os << ( e ? ", " : " " ) << quote( PerfCounters::asString( ev ) ) << ": "
+               << ( pc.available( ev ) ? fixed( mean( ev ) ) : "null" );
+        }
+        double cycles = mean( PerfCounters::CYCLES );
+        os << ", \"ipc\": "
+           << ( pc.available( PerfCounters::CYCLES ) and pc.available( PerfCounters::INSTRUCTIONS ) and cycles > 0.0
+                ? fixed( mean( PerfCounters::INSTRUCTIONS ) / cycles ) : "null" )
+           << " }";
+    }
+    os << " }" << ( last ? "" : "," ) << "\n";
+}
+
+
+static void usage() {
+    std::cerr << "Usage: bench [-n iterations] [-w warmup] [-p] [-c] [-m model] [-o out.json] suite.txt\n";
+    exit( EXIT_FAILURE );
+}
+
+
+int main( int ac, char *av[] ) {
+
+    int iterations = 10;
+    int warmup = 2;
+    bool perf = false;
+    std::string only;
+    std::string outfile;
+    std::string suite;
+
+    for ( int i = 1; i < ac; ++i ) {
+        std::string a = av[i];
+        if ( a == "-n" and i + 1 < ac )
+            iterations = atoi( av[++i] );
+        else if ( a == "-w" and i + 1 < ac )
+            warmup = atoi( av[++i] );
+        else if ( a == "-p" )
+            perf = true;
+        else if ( a == "-c" )
+            std_compact_lexicons( 1 );
+        else if ( a == "-m" and i + 1 < ac )
+            only = av[++i];
+        else if ( a == "-o" and i + 1 < ac )
+            outfile = av[++i];
+        else if ( a[0] == '-' or not suite.empty() )
+            usage();
+        else
+            suite = a;
+    }
+    if ( suite.empty() or iterations < 1 or warmup < 0 )
+        usage();
+    if ( perf and not PerfCounters::thread().any() )
+        std::cerr << "WARNING: no hardware perf counters are available, they will be null\n";
+
+    try {
+        std::vector<Model> models = readSuite( suite );
+
+        std::ostringstream json;
+        json << "{\n"
+             << "  \"bench\": 1,\n"
+             << "  \"build\": { \"opt\": \"" << BENCH_OPT << "\", \"compiler\": \"" << __VERSION__ << "\" },\n"
+             << "  \"iterations\": " << iterations << ",\n"
+             << "  \"warmup\": " << warmup << ",\n"
+             << "  \"models\": [\n";
+
+        bool firstModel = true;
+        for ( const auto &m : models ) {
+            if ( not only.empty() and m.name != only )
+                continue;
+
+            std::vector<std::string> addresses = readCorpus( m.corpus );
+            const long unsigned int n = addresses.size();
+            std::cerr << m.name << ": " << n << " addresses\n";
+
+            // load the model the way the database does, from the text
+            char *err = NULL;
+            auto t0 = std::chrono::steady_clock::now();
+            std::string ltext = readFile( m.lexicon );
+            void *lexPtr = getLexiconPtr( &ltext[0], &err );
+            if ( not lexPtr )
+                throw std::runtime_error( m.name + ": " + err );
+            double lexMs = elapsedMs( t0 );
+
+            t0 = std::chrono::steady_clock::now();
+            std::string gtext = readFile( m.grammar );
+            void *gmrPtr = getGrammarPtr( &gtext[0], &err );
+            if ( not gmrPtr )
+                throw std::runtime_error( m.name + ": " + err );
+            double gmrMs = elapsedMs( t0 );
+
+            Lexicon &lex = *static_cast<Lexicon*>( lexPtr );
+            Grammar &gmr = *static_cast<Grammar*>( gmrPtr );
+
+            Tokenizer tokenizer( lex );
+            tokenizer.filter( InClass::asType( m.filter ) );
+            Search search( gmr );
+
+            // the input of each stage is the output of the one before
+            std::vector<std::string> upper( n );
+            std::vector<std::vector<Token> > tokens( n );
+            for ( long unsigned int i = 0; i < n; ++i ) {
+                UErrorCode errorCode = U_ZERO_ERROR;
+                upper[i] = Utils::upperCaseUTF8( Utils::normalizeUTF8( addresses[i], errorCode ), m.locale );
+                tokens[i] = tokenizer.getTokens( upper[i] );
+            }
+
+            std::vector<Stage> stages;
+
+            stages.push_back( run( "normalize", n, warmup, iterations, perf, [&]( long unsigned int i ) {
+                UErrorCode errorCode = U_ZERO_ERROR;
+                return Utils::normalizeUTF8( addresses[i], errorCode ).size();
+            } ) );
+
+            stages.push_back( run( "tokenize", n, warmup, iterations, perf, [&]( long unsigned int i ) {
+                return tokenizer.getTokens( upper[i] ).size();
+            } ) );
+
+            stages.push_back( run( "classify", n, warmup, iterations, perf, [&]( long unsigned int i ) {
+                long unsigned int found = 0;
+                for ( const auto &t : tokens[i] ) {
+                    Token token( t.text() );
+                    lex.classify( token, InClass::WORD );
+                    found += token.inSize();
+                }
+                return found;
+            } ) );
+
+            stages.push_back( run( "enumerate", n, warmup, iterations, perf, [&]( long unsigned int i ) {
+                return Token::enumerate( tokens[i], 0 ).size();
+            } ) );
+
+            stages.push_back( run( "search", n, warmup, iterations, perf, [&]( long unsigned int i ) {
+                return search.search( tokens[i] ).size();
+            } ) );
+
+            stages.push_back( run( "standardize", n, warmup, iterations, perf, [&]( long unsigned int i ) {
+                char *err = NULL;
+                STDADDR *sa = std_standardize_ptrs( const_cast<char*>( addresses[i].c_str() ), gmrPtr, lexPtr,
+                                                    const_cast<char*>( m.locale.c_str() ),
+                                                    const_cast<char*>( m.filter.c_str() ), &err );
+                long unsigned int found = sa ? 1 : 0;
+                stdaddrFree( sa );
+                free( err );
+                return found;
+            } ) );
+
+            freeGrammarPtr( gmrPtr );
+            freeLexiconPtr( lexPtr );
+
+            json << ( firstModel ? "" : ",\n" )
+                 << "    {\n"
+                 << "      \"model\": " << quote( m.name ) << ",\n"
+                 << "      \"addresses\": " << n << ",\n"
+                 << "      \"load_lexicon_ms\": " << fixed( lexMs ) << ",\n"
+                 << "      \"load_grammar_ms\": " << fixed( gmrMs ) << ",\n"
+                 << "      \"stages\": [\n";
+            for ( long unsigned int s = 0; s < stages.size(); ++s )
+                writeStage( json, stages[s], s + 1 == stages.size() );
+            json << "      ]\n"
+                 << "    }";
+            firstModel = false;
+        }
+        json << "\n  ]\n}\n";
+
+        if ( outfile.empty() )
+            std::cout << json.str();
+        else {
+            std::ofstream out( outfile );
+            out << json.str();
+            if ( out.fail() )
+                throw std::runtime_error( "Bench-Can-Not-Write: " + outfile );
+        }
+    }
+    catch ( std::exception &e ) {
+        std::cerr << "ERROR: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
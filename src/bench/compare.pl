@@ -0,0 +1,76 @@
+#!/usr/bin/perl -w
+use strict;
+use JSON::PP;
+
+# compare two bench runs stage by stage, exits 1 when the p50 of any
+# stage got slower by more than the threshold percent
+
+sub Usage {
+    die "Usage: compare.pl [-t threshold] baseline.json current.json\n";
+}
+
+my $threshold = 5.0;
+if (@ARGV && $ARGV[0] eq '-t') {
+    shift @ARGV;
+    $threshold = shift @ARGV;
+    Usage() unless defined $threshold;
+}
+Usage() unless @ARGV == 2;
+
+my $base = readRun($ARGV[0]);
+my $cur  = readRun($ARGV[1]);
+
+# timings of different builds can not be compared
+my $bbuild = buildOf($base);
+my $cbuild = buildOf($cur);
+warn "WARNING: the runs were built differently: $bbuild vs $cbuild\n"
+    if $bbuild ne $cbuild;
+
+my $slower = 0;
+printf "%-14s %-12s %12s %12s %8s %12s %8s\n",
+    'model', 'stage', 'base p50', 'p50', 'change', 'per_second', 'change';
+
+for my $m (@{$cur->{models}}) {
+    my ($bm) = grep { $_->{model} eq $m->{model} } @{$base->{models}};
+    next unless $bm;
+    for my $s (@{$m->{stages}}) {
+        my ($bs) = grep { $_->{stage} eq $s->{stage} } @{$bm->{stages}};
+        next unless $bs;
+        my $dp50  = change($bs->{p50_us}, $s->{p50_us});
+        my $drate = change($bs->{per_second}, $s->{per_second});
+        my $flag = '';
+        if ($dp50 > $threshold) {
+            $flag = '  SLOWER';
+            $slower++;
+        }
+        elsif ($dp50 < -$threshold) {
+            $flag = '  faster';
+        }
+        printf "%-14s %-12s %12.3f %12.3f %+7.1f%% %12.1f %+7.1f%%%s\n",
+            $m->{model}, $s->{stage}, $bs->{p50_us}, $s->{p50_us}, $dp50,
+            $s->{per_second}, $drate, $flag;
+    }
+}
+
+exit($slower ? 1 : 0);
+
+sub change {
+    my ($old, $new) = @_;
+    return 0.0 if $old == 0;
+    return ($new - $old) / $old * 100.0;
+}
+
+sub buildOf {
+    my $run = shift;
+    return 'unknown' unless $run->{build};
+    return "$run->{build}{opt} ($run->{build}{compiler})";
+}
+
+sub readRun {
+    my $file = shift;
+    open(my $fh, '<', $file) || die "ERROR: can not read '$file': $!\n";
+    local $/;
+    my $json = <$fh>;
+    close($fh);
+    return decode_json($json);
+}
@@ -0,0 +1,176 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+/*
+ * gen-corpus - write made up addresses for a model, one per line
+ *
+ * Usage: gen-corpus [-n count] [-s seed] [-l min[-max]] [-a ambiguity]
+ *                   [-d duplicates] [-p filter] [-c] lexicon grammar
+ *
+ * The addresses follow the rules of the grammar with words from the
+ * lexicon, see AddressGenerator. Most of them standardize, but the
+ * tokenizer can split or join the words differently than they were
+ * picked, -p only keeps the addresses that standardize with filter.
+ * -c appends the classes the address was made from after a tab. The
+ * output can be used as a bench corpus:
+ *
+ *     ./gen-corpus -n 1000000 ../../data/sample/usa.lex ../../data/sample/usa.gmr > usa-1m.txt
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "address_standardizer.h"
+#include "addressgenerator.h"
+#include "grammar.h"
+#include "lexicon.h"
+
+
+static std::string readFile( const std::string &file ) {
+    std::ifstream in( file );
+    if ( in.fail() )
+        throw std::runtime_error( "Gen-Corpus-Can-Not-Read: " + file );
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+
+static void stdaddrFree( STDADDR *sa ) {
+    free( sa->building );
+    free( sa->house_num );
+    free( sa->predir );
+    free( sa->qual );
+    free( sa->pretype );
+    free( sa->name );
+    free( sa->suftype );
+    free( sa->sufdir );
+    free( sa->ruralroute );
+    free( sa->extra );
+    free( sa->city );
+    free( sa->prov );
+    free( sa->country );
+    free( sa->postcode );
+    free( sa->box );
+    free( sa->unit );
+    free( sa->pattern );
+    free( sa );
+}
+
+
+static void usage() {
+    std::cerr << "Usage: gen-corpus [-n count] [-s seed] [-l min[-max]] [-a ambiguity]\n"
+              << "                  [-d duplicates] [-p filter] [-c] lexicon grammar\n";
+    exit( EXIT_FAILURE );
+}
+
+
+int main( int ac, char *av[] ) {
+
+    long unsigned int count = 1000;
+    unsigned int seed = 1;
+    long unsigned int minTokens = 1;
+    long unsigned int maxTokens = 0;
+    double ambiguity = 0.0;
+    double duplicates = 0.0;
+    bool showClasses = false;
+    std::string filter;
+    std::vector<std::string> files;
+
+    for ( int i = 1; i < ac; ++i ) {
+        std::string a = av[i];
+        if ( a == "-n" and i + 1 < ac )
+            count = strtoul( av[++i], NULL, 10 );
+        else if ( a == "-s" and i + 1 < ac )
+            seed = static_cast<unsigned int>( strtoul( av[++i], NULL, 10 ) );
+        else if ( a == "-l" and i + 1 < ac ) {
+            char *end = NULL;
+            minTokens = strtoul( av[++i], &end, 10 );
+            if ( *end == '-' )
+                maxTokens = strtoul( end + 1, NULL, 10 );
+        }
+        else if ( a == "-a" and i + 1 < ac )
+            ambiguity = atof( av[++i] );
+        else if ( a == "-d" and i + 1 < ac )
+            duplicates = atof( av[++i] );
+        else if ( a == "-p" and i + 1 < ac )
+            filter = av[++i];
+        else if ( a == "-c" )
+            showClasses = true;
+        else if ( a[0] == '-' )
+            usage();
+        else
+            files.push_back( a );
+    }
+    if ( files.size() != 2 )
+        usage();
+
+    try {
+        // load the files the way the database does, either may be compiled
+        char *err = NULL;
+        std::string ltext = readFile( files[0] );
+        void *lexPtr = getLexiconPtr( &ltext[0], &err );
+        if ( not lexPtr )
+            throw std::runtime_error( err );
+        std::string gtext = readFile( files[1] );
+        void *gmrPtr = getGrammarPtr( &gtext[0], &err );
+        if ( not gmrPtr )
+            throw std::runtime_error( err );
+
+        AddressGenerator gen( *static_cast<Grammar*>( gmrPtr ), *static_cast<Lexicon*>( lexPtr ), seed );
+        gen.minTokens( minTokens );
+        gen.maxTokens( maxTokens );
+        gen.ambiguity( ambiguity );
+        gen.duplicates( duplicates );
+
+        std::string locale = static_cast<Lexicon*>( lexPtr )->locale();
+        std::vector<InClass::Type> classes;
+        long unsigned int tries = 0;
+        for ( long unsigned int n = 0; n < count; ++n ) {
+            std::string address = gen.next( &classes );
+            if ( not filter.empty() ) {
+                if ( ++tries > 100 * count )
+                    throw std::runtime_error( "Gen-Corpus-Too-Few-Standardize" );
+                STDADDR *sa = std_standardize_ptrs( &address[0], gmrPtr, lexPtr, &locale[0], &filter[0], &err );
+                free( err );
+                err = NULL;
+                if ( not sa ) {
+                    --n;
+                    continue;
+                }
+                stdaddrFree( sa );
+            }
+            std::cout << address;
+            if ( showClasses ) {
+                std::cout << "\t";
+                for ( long unsigned int c = 0; c < classes.size(); ++c )
+                    std::cout << ( c ? " " : "" ) << InClass::asString( classes[c] );
+            }
+            std::cout << "\n";
+        }
+
+        freeGrammarPtr( gmrPtr );
+        freeLexiconPtr( lexPtr );
+    }
+    catch ( std::exception &e ) {
+        std::cerr << "ERROR: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
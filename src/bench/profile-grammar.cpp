@@ -0,0 +1,281 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+/*
+ * profile-grammar - count how a corpus uses the rules of a grammar
+ *
+ * Usage: profile-grammar [-l locale] [-f filter] [-t top] [-o report]
+ *                        lexicon grammar corpus
+ *
+ * Every address of the corpus is searched the way the database does it,
+ * with a SearchProfile collecting for each section the partial paths
+ * expanded there and the time spent on them, and for each meta
+ * alternative and rule how often it was
+ *
+ *     tried    branched into or compared with a class pattern
+ *     matched  on a path that matched a whole pattern
+ *     wins     on the best match of an address
+ *
+ * The report, grammar.profile unless -o is given, starts with the top
+ * sections by time and the number of dead items, those that never
+ * matched, followed by the grammar itself with the counts on a comment
+ * line above every section, alternative and rule, so it still loads as
+ * a grammar and dead rules can be deleted in place. The corpus is read
+ * like a bench corpus, see bench.cpp. The locale defaults to the one of
+ * the lexicon and the filter to PUNCT,SPACE,EMDASH.
+ *
+ *     ./profile-grammar ../../data/sample/usa.lex ../../data/sample/usa.gmr ../../data/test-usa-patterns
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "address_standardizer.h"
+#include "compiledgrammar.h"
+#include "grammar.h"
+#include "inclass.h"
+#include "lexicon.h"
+#include "search.h"
+#include "token.h"
+#include "tokenizer.h"
+#include "utils.h"
+
+
+static std::string readFile( const std::string &file ) {
+    std::ifstream in( file );
+    if ( in.fail() )
+        throw std::runtime_error( "Profile-Grammar-Can-Not-Read: " + file );
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+
+static std::string trim( const std::string &s ) {
+    long unsigned int b = s.find_first_not_of( " \t\r\n" );
+    if ( b == std::string::npos )
+        return "";
+    long unsigned int e = s.find_last_not_of( " \t\r\n" );
+    return s.substr( b, e - b + 1 );
+}
+
+
+static std::vector<std::string> readCorpus( const std::string &file ) {
+    std::vector<std::string> addresses;
+    std::istringstream in( readFile( file ) );
+    std::string line;
+    bool perl = false;
+    bool first = true;
+    while ( std::getline( in, line ) ) {
+        if ( first and line.compare( 0, 2, "#!" ) == 0 )
+            perl = true;
+        first = false;
+        line = trim( line );
+        if ( perl ) {
+            // only the keys, a line that is nothing but a quoted string
+            if ( line.size() > 2 and line[0] == '\'' and line[line.size() - 1] == '\''
+                 and line.find( '\'', 1 ) == line.size() - 1 )
+                addresses.push_back( line.substr( 1, line.size() - 2 ) );
+        }
+        else if ( not line.empty() and line[0] != '#' )
+            addresses.push_back( line );
+    }
+    if ( addresses.empty() )
+        throw std::runtime_error( "Profile-Grammar-Empty-Corpus: " + file );
+    return addresses;
+}
+
+
+static std::string counts( const SearchProfile::Counts &c, long unsigned int i ) {
+    std::ostringstream os;
+    os << "# tried " << c.tried[i] << ", matched " << c.matched[i] << ", wins " << c.wins[i];
+    if ( c.matched[i] == 0 )
+        os << ", dead";
+    return os.str();
+}
+
+
+static void report( std::ostream &os, const CompiledGrammar &cg, const SearchProfile &profile,
+                    const std::string &grammar, const std::string &corpus,
+                    long unsigned int addresses, long unsigned int matched, double seconds,
+                    long unsigned int top ) {
+    typedef CompiledGrammar::Index Index;
+
+    long unsigned int deadAlts = 0;
+    long unsigned int deadRules = 0;
+    for ( Index id = 0; id < cg.sectionCount(); ++id ) {
+        const auto &s = cg.section( id );
+        for ( Index i = s.first; i < s.first + s.count; ++i ) {
+            if ( s.kind == CompiledGrammar::META and profile.alts.matched[i] == 0 )
+                ++deadAlts;
+            else if ( s.kind != CompiledGrammar::META and profile.rules.matched[i] == 0 )
+                ++deadRules;
+        }
+    }
+
+    std::vector<Index> hot;
+    for ( Index id = 0; id < cg.sectionCount(); ++id )
+        if ( profile.paths[id] > 0 )
+            hot.push_back( id );
+    std::stable_sort( hot.begin(), hot.end(), [&]( Index a, Index b ) {
+        return profile.nanos[a] > profile.nanos[b];
+    } );
+    if ( hot.size() > top )
+        hot.resize( top );
+
+    os << std::fixed << std::setprecision( 3 )
+       << "# profile of " << grammar << " over " << corpus << "\n"
+       << "# addresses " << addresses << ", matched " << matched
+       << ", " << seconds << " seconds\n"
+       << "# dead, never matched: " << deadAlts << " of " << cg.image().nalts << " alternatives, "
+       << deadRules << " of " << cg.ruleCount() << " rules\n"
+       << "#\n"
+       << "# hottest sections          ms       paths\n";
+    for ( const auto id : hot )
+        os << "#   " << std::left << std::setw( 20 ) << cg.name( id ) << std::right
+           << std::setw( 10 ) << static_cast<double>( profile.nanos[id] ) / 1e6
+           << std::setw( 12 ) << profile.paths[id] << "\n";
+    os << "\n";
+
+    // the grammar the way CompiledGrammar prints it, with the counts
+    for ( Index id = 0; id < cg.sectionCount(); ++id ) {
+        const auto &s = cg.section( id );
+        os << "# paths " << profile.paths[id] << ", "
+           << static_cast<double>( profile.nanos[id] ) / 1e6 << " ms"
+           << ( profile.paths[id] == 0 ? ", unreached" : "" ) << "\n"
+           << "[" << cg.name( id ) << "]\n";
+        for ( Index i = s.first; i < s.first + s.count; ++i ) {
+            if ( s.kind == CompiledGrammar::META ) {
+                os << counts( profile.alts, i ) << "\n";
+                const auto &alt = cg.alt( i );
+                const auto *refs = cg.refs( alt );
+                for ( Index k = 0; k < alt.count; ++k ) {
+                    if ( k > 0 )
+                        os << " ";
+                    if ( refs[k] == CompiledGrammar::NONE )
+                        os << "@?";
+                    else
+                        os << "@" << cg.name( refs[k] );
+                }
+            }
+            else
+                os << counts( profile.rules, i ) << "\n" << cg.rule( i );
+            os << "\n";
+        }
+        os << "\n";
+    }
+}
+
+
+static void usage() {
+    std::cerr << "Usage: profile-grammar [-l locale] [-f filter] [-t top] [-o report]\n"
+              << "                       lexicon grammar corpus\n";
+    exit( EXIT_FAILURE );
+}
+
+
+int main( int ac, char *av[] ) {
+
+    std::string locale;
+    std::string filter = "PUNCT,SPACE,EMDASH";
+    std::string out;
+    long unsigned int top = 10;
+    std::vector<std::string> files;
+
+    for ( int i = 1; i < ac; ++i ) {
+        std::string a = av[i];
+        if ( a == "-l" and i + 1 < ac )
+            locale = av[++i];
+        else if ( a == "-f" and i + 1 < ac )
+            filter = av[++i];
+        else if ( a == "-t" and i + 1 < ac )
+            top = strtoul( av[++i], NULL, 10 );
+        else if ( a == "-o" and i + 1 < ac )
+            out = av[++i];
+        else if ( a[0] == '-' )
+            usage();
+        else
+            files.push_back( a );
+    }
+    if ( files.size() != 3 )
+        usage();
+    if ( out.empty() )
+        out = files[1] + ".profile";
+
+    try {
+        std::vector<std::string> addresses = readCorpus( files[2] );
+
+        // load the files the way the database does, either may be compiled
+        char *err = NULL;
+        std::string ltext = readFile( files[0] );
+        void *lexPtr = getLexiconPtr( &ltext[0], &err );
+        if ( not lexPtr )
+            throw std::runtime_error( err );
+        std::string gtext = readFile( files[1] );
+        void *gmrPtr = getGrammarPtr( &gtext[0], &err );
+        if ( not gmrPtr )
+            throw std::runtime_error( err );
+
+        Lexicon &lex = *static_cast<Lexicon*>( lexPtr );
+        Grammar &gmr = *static_cast<Grammar*>( gmrPtr );
+        if ( locale.empty() )
+            locale = lex.locale();
+
+        Tokenizer tokenizer( lex );
+        tokenizer.filter( InClass::asType( filter ) );
+
+        SearchProfile profile;
+        Search search( gmr );
+        search.profile( &profile );
+
+        long unsigned int matched = 0;
+        auto start = std::chrono::steady_clock::now();
+        for ( const auto &address : addresses ) {
+            UErrorCode errorCode = U_ZERO_ERROR;
+            std::string upper = Utils::upperCaseUTF8( Utils::normalizeUTF8( address, errorCode ), locale );
+            std::vector<Token> phrase = tokenizer.getTokens( upper );
+            AltTokens alts = tokenizer.altTokens( phrase, true, NULL );
+
+            float score = -1.0;
+            float nrules = -1.0;
+            std::string pattern;
+            search.searchAndReclassBest( phrase, alts, score, pattern, nrules );
+            if ( score >= 0.0 )
+                ++matched;
+        }
+        double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+        auto program = gmr.program();
+        profile.resize( *program );
+
+        std::ofstream os( out );
+        if ( os.fail() )
+            throw std::runtime_error( "Profile-Grammar-Can-Not-Write: " + out );
+        report( os, *program, profile, files[1], files[2], addresses.size(), matched, seconds, top );
+        std::cerr << addresses.size() << " addresses, " << matched << " matched, report in " << out << "\n";
+    }
+    catch ( const std::exception &e ) {
+        std::cerr << "ERROR: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "compiledgrammar.h"
+#include "grammar.h"
+
+
+CompiledGrammar::CompiledGrammar( const Grammar &G ) {
+    float maxScore = 0.0;
+    const auto &metas = G.metas_;
+    const auto &rules = G.rules_;
+    const Index nmetas = static_cast<Index>( metas.size() );
+
+    // the section id of each section name id, metas come first
+    std::vector<Index> ids( G.names_.size(), Index( NONE ) );
+    for ( long unsigned int i = 0; i < ids.size() and i < G.sectionDefs_.size(); ++i ) {
+        const auto &def = G.sectionDefs_[i];
+        if ( def.kind == Grammar::ISMETA )
+            ids[i] = static_cast<Index>( def.index );
+        else if ( def.kind == Grammar::ISRULE )
+            ids[i] = nmetas + static_cast<Index>( def.index );
+    }
+
+    sections_.reserve( metas.size() + rules.size() );
+
+    for ( const auto &meta : metas ) {
+        Section s;
+        s.kind  = META;
+        s.first = static_cast<Index>( alts_.size() );
+        s.name  = addName( meta.name() );
+        for ( auto mr = meta.begin(); mr != meta.end(); ++mr ) {
+            Span alt;
+            alt.first = static_cast<Index>( refs_.size() );
+            for ( auto ref = mr->begin(); ref != mr->end(); ++ref )
+                refs_.push_back( ids[ref->id()] );
+            alt.count = static_cast<Index>( refs_.size() ) - alt.first;
+            alts_.push_back( alt );
+        }
+        s.count = static_cast<Index>( alts_.size() ) - s.first;
+        sections_.push_back( s );
+    }
+
+    for ( const auto &section : rules ) {
+        Section s;
+        s.kind  = RULES;
+        s.first = static_cast<Index>( rules_.size() );
+        s.name  = addName( section.name() );
+        for ( auto r = section.begin(); r != section.end(); ++r ) {
+            RuleDef rd;
+            rd.first = static_cast<Index>( in_.size() );
+            rd.count = static_cast<Index>( r->inSize() );
+            rd.score = r->score();
+            if ( rd.score > maxScore )
+                maxScore = rd.score;
+            for ( long unsigned int i = 0; i < r->inSize(); ++i ) {
+                in_.push_back( static_cast<Class>( r->in( i ) ) );
+                // keep in_ and out_ the same length, isValid() has
+                // already flagged rules where the counts differ
+                out_.push_back( i < r->outSize()
+                        ? static_cast<Class>( r->out( i ) )
+                        : static_cast<Class>( OutClass::STOP ) );
+            }
+            rules_.push_back( rd );
+        }
+        s.count = static_cast<Index>( rules_.size() ) - s.first;
+        sections_.push_back( s );
+    }
+
+    image_.sections  = sections_.data();
+    image_.nsections = static_cast<Index>( sections_.size() );
+    image_.alts      = alts_.data();
+    image_.nalts     = static_cast<Index>( alts_.size() );
+    image_.refs      = refs_.data();
+    image_.nrefs     = static_cast<Index>( refs_.size() );
+    image_.rules     = rules_.data();
+    image_.nrules    = static_cast<Index>( rules_.size() );
+    image_.in        = in_.data();
+    image_.out       = out_.data();
+    image_.nclasses  = static_cast<Index>( in_.size() );
+    image_.names     = names_.data();
+    image_.nnames    = static_cast<Index>( names_.size() );
+    image_.maxScore  = maxScore;
+
+    byName_.resize( sections_.size() );
+    for ( Index i = 0; i < byName_.size(); ++i )
+        byName_[i] = i;
+    std::sort( byName_.begin(), byName_.end(),
+        [this]( Index a, Index b ) {
+            return std::strcmp( name( a ), name( b ) ) < 0;
+        } );
+    image_.byName    = byName_.data();
+}
+
+
+CompiledGrammar::CompiledGrammar( const Image &image, std::shared_ptr<const void> owner )
+    : image_( image ), owner_( owner )
+{
+    validate();
+}
+
+
+void CompiledGrammar::validate() const {
+    // everything is checked once here so the search never has to
+    const Image &im = image_;
+    auto fail = []() {
+        throw std::runtime_error( "CompiledGrammar-Invalid-Image" );
+    };
+
+    if ( im.nnames > 0 and im.names[im.nnames - 1] != '\0' )
+        fail();
+    for ( Index id = 0; id < im.nsections; ++id ) {
+        const Section &s = im.sections[id];
+        const Index limit = s.kind == META ? im.nalts : im.nrules;
+        if ( s.kind > RULES or s.name >= im.nnames
+                or s.first > limit or s.count > limit - s.first )
+            fail();
+        if ( im.byName[id] >= im.nsections )
+            fail();
+    }
+    for ( Index i = 0; i < im.nalts; ++i )
+        if ( im.alts[i].first > im.nrefs or im.alts[i].count > im.nrefs - im.alts[i].first )
+            fail();
+    for ( Index i = 0; i < im.nrefs; ++i )
+        if ( im.refs[i] != NONE and im.refs[i] >= im.nsections )
+            fail();
+    for ( Index i = 0; i < im.nrules; ++i )
+        if ( im.rules[i].first > im.nclasses or im.rules[i].count > im.nclasses - im.rules[i].first )
+            fail();
+    for ( Index i = 1; i < im.nsections; ++i )
+        if ( std::strcmp( name( im.byName[i - 1] ), name( im.byName[i] ) ) >= 0 )
+            fail();
+}
+
+
+CompiledGrammar::Index CompiledGrammar::find( const std::string &str ) const {
+    const Index *first = image_.byName;
+    const Index *last  = image_.byName + image_.nsections;
+    auto it = std::lower_bound( first, last, str,
+        [this]( Index a, const std::string &s ) {
+            return std::strcmp( name( a ), s.c_str() ) < 0;
+        } );
+    if ( it != last and str == name( *it ) )
+        return *it;
+    return NONE;
+}
+
+
+Rule CompiledGrammar::rule( Index i ) const {
+    const RuleDef &rd = image_.rules[i];
+    std::vector<InClass::Type> in;
+    std::vector<OutClass::Type> out;
+    in.reserve( rd.count );
+    out.reserve( rd.count );
+    for ( Index k = rd.first; k < rd.first + rd.count; ++k ) {
+        in.push_back( static_cast<InClass::Type>( image_.in[k] ) );
+        out.push_back( static_cast<OutClass::Type>( image_.out[k] ) );
+    }
+    return Rule( in, out, rd.score );
+}
+
+
+CompiledGrammar::Index CompiledGrammar::addName( const std::string &name ) {
+    Index offset = static_cast<Index>( names_.size() );
+    names_.insert( names_.end(), name.begin(), name.end() );
+    names_.push_back( '\0' );
+    return offset;
+}
+
+
+std::ostream &operator<<( std::ostream &ss, const CompiledGrammar &cg ) {
+    for ( CompiledGrammar::Index id = 0; id < cg.sectionCount(); ++id ) {
+        const auto &s = cg.section( id );
+        ss << "[" << cg.name( id ) << "]\n";
+        for ( auto i = s.first; i < s.first + s.count; ++i ) {
+            if ( s.kind == CompiledGrammar::META ) {
+                const auto &alt = cg.alt( i );
+                const auto *refs = cg.refs( alt );
+                for ( CompiledGrammar::Index k = 0; k < alt.count; ++k ) {
+                    if ( k > 0 )
+                        ss << " ";
+                    if ( refs[k] == CompiledGrammar::NONE )
+                        ss << "@?";
+                    else
+                        ss << "@" << cg.name( refs[k] );
+                }
+            }
+            else
+                ss << cg.rule( i );
+            ss << "\n";
+        }
+        ss << "\n";
+    }
+
+    return ss;
+}
@@ -0,0 +1,153 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#ifndef COMPILEDGRAMMAR_H
+#define COMPILEDGRAMMAR_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+
+#include "inclass.h"
+#include "outclass.h"
+#include "rule.h"
+
+class Grammar;
+
+/*
+ * CompiledGrammar is a flattened, read-only form of a Grammar that the
+ * search engine walks instead of the MetaSection/RuleSection objects.
+ *
+ * Every section is given an integer id (meta sections first, then rule
+ * sections, in the order they were defined) and all references between
+ * sections are resolved to those ids once at compile time. The
+ * alternatives, references and rules are stored in a handful of flat
+ * arrays so matching never touches a std::string or follows a pointer.
+ *
+ *   sections_[id]    -> kind, [first, first+count) into alts_ or rules_
+ *   alts_[i]         -> [first, first+count) into refs_
+ *   refs_[i]         -> section id or NONE if the reference is unresolved
+ *   rules_[i]        -> [first, first+count) into in_ and out_, score
+ *
+ * The arrays are either owned by the object, when it is compiled from a
+ * Grammar, or they point into a model image (see ModelFile) that is
+ * used in place and kept alive by the object.
+ */
+class CompiledGrammar
+{
+public:
+
+    typedef unsigned int Index;
+    typedef signed char Class;
+
+    static const Index NONE = static_cast<Index>(-1);
+
+    typedef enum {
+        META  = 0,
+        RULES = 1
+    } Kind;
+
+    struct Section {
+        Index kind;
+        Index first;
+        Index count;
+        Index name;     // offset into names_
+    };
+
+    struct Span {
+        Index first;
+        Index count;
+    };
+
+    struct RuleDef {
+        Index first;
+        Index count;
+        float score;
+    };
+
+    // the flat arrays and their lengths, all of it position independent
+    struct Image {
+        const Section *sections;
+        Index nsections;
+        const Span *alts;
+        Index nalts;
+        const Index *refs;
+        Index nrefs;
+        const RuleDef *rules;
+        Index nrules;
+        const Class *in;
+        const Class *out;
+        Index nclasses;
+        const char *names;
+        Index nnames;
+        const Index *byName;
+        float maxScore;
+    };
+
+    explicit CompiledGrammar( const Grammar &G );
+
+    // use an image in place, owner keeps the memory behind it alive
+    // throws if the image is not internally consistent
+    CompiledGrammar( const Image &image, std::shared_ptr<const void> owner );
+
+    CompiledGrammar( const CompiledGrammar& ) = delete;
+    CompiledGrammar &operator=( const CompiledGrammar& ) = delete;
+
+    const Image &image() const { return image_; };
+
+    // lookup a section id by name, returns NONE if not found
+    Index find( const std::string &name ) const;
+
+    // accessors
+    Index sectionCount() const { return image_.nsections; };
+    Index ruleCount() const { return image_.nrules; };
+    // no match can average better than the highest scoring rule
+    float maxScore() const { return image_.maxScore; };
+    const Section &section( Index id ) const { return image_.sections[id]; };
+    const Span &alt( Index i ) const { return image_.alts[i]; };
+    const Index *refs( const Span &alt ) const { return image_.refs + alt.first; };
+    const RuleDef &ruleDef( Index i ) const { return image_.rules[i]; };
+    const Class *in( const RuleDef &r ) const { return image_.in + r.first; };
+    const Class *out( const RuleDef &r ) const { return image_.out + r.first; };
+    const char *name( Index id ) const { return image_.names + image_.sections[id].name; };
+
+    // rebuild a Rule object from the compiled form
+    Rule rule( Index i ) const;
+
+    friend std::ostream &operator<<( std::ostream &ss, const CompiledGrammar &cg );
+
+private:
+
+    Index addName( const std::string &name );
+    void validate() const;
+
+    // what the accessors read, points at the vectors below or at owner_
+    Image image_;
+    std::shared_ptr<const void> owner_;
+
+    // storage when compiled from a Grammar
+    std::vector<Section> sections_;
+    std::vector<Span> alts_;
+    std::vector<Index> refs_;
+    std::vector<RuleDef> rules_;
+    std::vector<Class> in_;
+    std::vector<Class> out_;
+    std::vector<char> names_;
+
+    // section ids ordered by name for find()
+    std::vector<Index> byName_;
+
+};
+
+#endif
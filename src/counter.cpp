@@ -0,0 +1,102 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#include <algorithm>
+#include <mutex>
+
+#include "counter.h"
+
+
+namespace {
+
+std::mutex &registryMutex() {
+    static std::mutex m;
+    return m;
+}
+
+// a function static so counters declared at file scope in other
+// translation units can register before main()
+std::vector<Counter*> &registry() {
+    static std::vector<Counter*> counters;
+    return counters;
+}
+
+Counter *find( const std::string &name ) {
+    for ( auto c : registry() )
+        if ( c->name() == name )
+            return c;
+    return NULL;
+}
+
+}
+
+
+Counter::Counter( const std::string &name ) : name_( name ) {
+    for ( int i = 0; i < SHARDS; ++i )
+        slots_[i].value.store( 0, std::memory_order_relaxed );
+    std::lock_guard<std::mutex> lock( registryMutex() );
+    registry().push_back( this );
+}
+
+
+Counter::~Counter() {
+    std::lock_guard<std::mutex> lock( registryMutex() );
+    auto &r = registry();
+    r.erase( std::remove( r.begin(), r.end(), this ), r.end() );
+}
+
+
+// threads are given the shards round robin as they first count
+int Counter::shard() {
+    static std::atomic<unsigned int> next( 0 );
+    thread_local int mine = static_cast<int>( next.fetch_add( 1, std::memory_order_relaxed ) % SHARDS );
+    return mine;
+}
+
+
+uint64_t Counter::value() const {
+    uint64_t sum = 0;
+    for ( int i = 0; i < SHARDS; ++i )
+        sum += slots_[i].value.load( std::memory_order_relaxed );
+    return sum;
+}
+
+
+void Counter::clear() {
+    for ( int i = 0; i < SHARDS; ++i )
+        slots_[i].value.store( 0, std::memory_order_relaxed );
+}
+
+
+uint64_t Counter::get( const std::string &name ) {
+    std::lock_guard<std::mutex> lock( registryMutex() );
+    Counter *c = find( name );
+    return c ? c->value() : 0;
+}
+
+
+void Counter::clear( const std::string &name ) {
+    std::lock_guard<std::mutex> lock( registryMutex() );
+    Counter *c = find( name );
+    if ( c )
+        c->clear();
+}
+
+
+std::vector<std::string> Counter::names() {
+    std::lock_guard<std::mutex> lock( registryMutex() );
+    std::vector<std::string> n;
+    for ( auto c : registry() )
+        n.push_back( c->name() );
+    return n;
+}
@@ -0,0 +1,76 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Counter is a named event counter that is cheap enough to leave on.
+ *
+ * Counters are declared once, usually as statics at file scope, and
+ * register themselves by name so they can be read from anywhere:
+ *
+ *     static Counter findRules( "findRules" );
+ *     findRules.add();
+ *     ...
+ *     Counter::get( "findRules" );
+ *
+ * The count is spread over SHARDS atomic slots, each on its own cache
+ * line, and a thread always adds to the same slot, so threads counting
+ * the same event rarely touch the same line. Reading adds up the slots.
+ */
+class Counter
+{
+public:
+    static const int SHARDS = 16;
+
+    explicit Counter( const std::string &name );
+    ~Counter();
+
+    Counter( const Counter& ) = delete;
+    Counter &operator=( const Counter& ) = delete;
+
+    void add( uint64_t n = 1 ) {
+        slots_[shard()].value.fetch_add( n, std::memory_order_relaxed );
+    };
+
+    uint64_t value() const;
+    void clear();
+    const std::string &name() const { return name_; };
+
+    // by name, an unknown counter reads as 0
+    static uint64_t get( const std::string &name );
+    static void clear( const std::string &name );
+
+    // the names of all the counters in the order they were declared
+    static std::vector<std::string> names();
+
+private:
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> value;
+    };
+
+    static int shard();
+
+    std::string name_;
+    Slot slots_[SHARDS];
+
+};
+
+#endif
@@ -0,0 +1,272 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "fstlexiconstore.h"
+
+
+static uint32_t checked32( long unsigned int n ) {
+    if ( n > 0xffffffffUL )
+        throw std::runtime_error( "FstLexiconStore-Too-Large" );
+    return static_cast<uint32_t>( n );
+}
+
+
+FstLexiconStore::FstLexiconStore() :
+    root_( 0 ), nkeys_( 0 ), finished_( false ),
+    register_( 0, StateHash{ this }, StateEqual{ this } )
+{
+    keyEntries_.push_back( 0 );
+    path_.push_back( Pending() );
+}
+
+
+long unsigned int FstLexiconStore::StateHash::operator()( uint32_t s ) const {
+    long unsigned int end = s + 1 < fst->first_.size() ? fst->first_[s + 1] : fst->labels_.size();
+    long unsigned int h = fst->final_[s] ? 1 : 0;
+    for ( long unsigned int a = fst->first_[s]; a < end; ++a )
+        h = h * 1000003UL ^ ( static_cast<long unsigned int>( fst->targets_[a] ) << 8 | fst->labels_[a] );
+    return h;
+}
+
+
+bool FstLexiconStore::StateEqual::operator()( uint32_t a, uint32_t b ) const {
+    long unsigned int aEnd = a + 1 < fst->first_.size() ? fst->first_[a + 1] : fst->labels_.size();
+    long unsigned int bEnd = b + 1 < fst->first_.size() ? fst->first_[b + 1] : fst->labels_.size();
+    if ( fst->final_[a] != fst->final_[b] or aEnd - fst->first_[a] != bEnd - fst->first_[b] )
+        return false;
+    for ( long unsigned int i = fst->first_[a], j = fst->first_[b]; i < aEnd; ++i, ++j )
+        if ( fst->labels_[i] != fst->labels_[j] or fst->targets_[i] != fst->targets_[j] )
+            return false;
+    return true;
+}
+
+
+void FstLexiconStore::add( const std::string &key, const std::vector<LexEntry> &entries ) {
+    if ( finished_ )
+        throw std::runtime_error( "FstLexiconStore-Finished" );
+    if ( nkeys_ > 0 and key <= last_ )
+        throw std::runtime_error( "FstLexiconStore-Keys-Not-Sorted: " + key );
+
+    // the states past the prefix shared with the last key are complete
+    long unsigned int prefix = 0;
+    while ( prefix < key.size() and prefix < last_.size() and key[prefix] == last_[prefix] )
+        ++prefix;
+    minimize( prefix );
+
+    for ( long unsigned int i = prefix; i < key.size(); ++i )
+        path_.push_back( Pending() );
+    path_.back().final = true;
+    last_ = key;
+
+    for ( const auto &le : entries ) {
+        if ( le.word() != key )
+            throw std::runtime_error( "FstLexiconStore-Word-Not-Key: " + key );
+
+        Entry e;
+        std::string stdword = le.stdword();
+        auto sw = stdwordIds_.find( stdword );
+        if ( sw == stdwordIds_.end() ) {
+            e.stdword = checked32( stdwords_.size() );
+            stdwords_.append( stdword );
+            stdwords_.push_back( '\0' );
+            stdwordIds_[stdword] = e.stdword;
+        }
+        else
+            e.stdword = sw->second;
+
+        Classes c;
+        c.types = 0;
+        c.attached = 0;
+        for ( const auto &t : le.type() ) {
+            if ( t < 0 or t >= 64 )
+                throw std::runtime_error( "FstLexiconStore-Unsupported-InClass: " + InClass::asString( t ) );
+            c.types |= 1ULL << t;
+        }
+        for ( const auto &a : le.attached() )
+            c.attached |= 1U << a;
+        std::string sig( reinterpret_cast<const char *>( &c.types ), sizeof(c.types) );
+        sig.append( reinterpret_cast<const char *>( &c.attached ), sizeof(c.attached) );
+        auto cl = classIds_.find( sig );
+        if ( cl == classIds_.end() ) {
+            e.classes = checked32( classes_.size() );
+            classes_.push_back( c );
+            classIds_[sig] = e.classes;
+        }
+        else
+            e.classes = cl->second;
+
+        entries_.push_back( e );
+    }
+    keyEntries_.push_back( checked32( entries_.size() ) );
+    nkeys_ = checked32( nkeys_ + 1UL );
+}
+
+
+void FstLexiconStore::finish() {
+    if ( finished_ )
+        return;
+
+    minimize( 0 );
+    root_ = freeze( path_.back() );
+    first_.push_back( checked32( labels_.size() ) );
+    finished_ = true;
+
+    // drop the build tables and any spare capacity
+    std::string().swap( last_ );
+    std::vector<Pending>().swap( path_ );
+    std::vector<uint32_t>().swap( counts_ );
+    std::unordered_set<uint32_t, StateHash, StateEqual>( 0, StateHash{ this }, StateEqual{ this } ).swap( register_ );
+    std::unordered_map<std::string, uint32_t>().swap( stdwordIds_ );
+    std::unordered_map<std::string, uint32_t>().swap( classIds_ );
+    first_.shrink_to_fit();
+    final_.shrink_to_fit();
+    labels_.shrink_to_fit();
+    targets_.shrink_to_fit();
+    outputs_.shrink_to_fit();
+    keyEntries_.shrink_to_fit();
+    entries_.shrink_to_fit();
+    stdwords_.shrink_to_fit();
+    classes_.shrink_to_fit();
+}
+
+
+void FstLexiconStore::minimize( long unsigned int depth ) {
+    // path_[i] is the state after the first i bytes of last_
+    while ( path_.size() > depth + 1 ) {
+        uint32_t id = freeze( path_.back() );
+        path_.pop_back();
+        path_.back().arcs.push_back( std::make_pair( static_cast<unsigned char>( last_[path_.size() - 1] ), id ) );
+    }
+}
+
+
+uint32_t FstLexiconStore::freeze( const Pending &p ) {
+    // add p as a new state then drop it again if the register has it
+    uint32_t id = checked32( final_.size() );
+    first_.push_back( checked32( labels_.size() ) );
+    final_.push_back( p.final );
+    uint32_t count = p.final ? 1 : 0;
+    for ( const auto &arc : p.arcs ) {
+        labels_.push_back( arc.first );
+        targets_.push_back( arc.second );
+        outputs_.push_back( count );
+        count = checked32( count + static_cast<long unsigned int>( counts_[arc.second] ) );
+    }
+
+    auto it = register_.find( id );
+    if ( it != register_.end() ) {
+        labels_.resize( first_.back() );
+        targets_.resize( first_.back() );
+        outputs_.resize( first_.back() );
+        first_.pop_back();
+        final_.pop_back();
+        return *it;
+    }
+
+    counts_.push_back( count );
+    register_.insert( id );
+    return id;
+}
+
+
+bool FstLexiconStore::find( const std::string &key, std::vector<LexEntry> &entries ) const {
+    if ( not finished_ )
+        throw std::runtime_error( "FstLexiconStore-Not-Finished" );
+
+    uint32_t state = root_;
+    uint32_t index = 0;
+    for ( const auto ch : key ) {
+        const unsigned char label = static_cast<unsigned char>( ch );
+        auto first = labels_.begin() + first_[state];
+        auto last  = labels_.begin() + first_[state + 1];
+        auto it = std::lower_bound( first, last, label );
+        if ( it == last or *it != label )
+            return false;
+        long unsigned int arc = static_cast<long unsigned int>( it - labels_.begin() );
+        index += outputs_[arc];
+        state = targets_[arc];
+    }
+    if ( not final_[state] )
+        return false;
+
+    append( key, index, entries );
+    return true;
+}
+
+
+void FstLexiconStore::forEach( const std::function<void(const std::string&, const std::vector<LexEntry>&)> &fn ) const {
+    if ( not finished_ )
+        throw std::runtime_error( "FstLexiconStore-Not-Finished" );
+
+    std::string key;
+    uint32_t index = 0;
+    std::vector<LexEntry> entries;
+    walk( root_, key, index, entries, fn );
+}
+
+
+long unsigned int FstLexiconStore::bytes() const {
+    return sizeof(*this)
+        + first_.capacity() * sizeof(uint32_t)
+        + final_.capacity() / 8
+        + labels_.capacity()
+        + targets_.capacity() * sizeof(uint32_t)
+        + outputs_.capacity() * sizeof(uint32_t)
+        + keyEntries_.capacity() * sizeof(uint32_t)
+        + entries_.capacity() * sizeof(Entry)
+        + stdwords_.capacity()
+        + classes_.capacity() * sizeof(Classes);
+}
+
+
+// keys are reached in ascending order so index counts them
+void FstLexiconStore::walk( uint32_t state, std::string &key, uint32_t &index,
+                            std::vector<LexEntry> &entries,
+                            const std::function<void(const std::string&, const std::vector<LexEntry>&)> &fn ) const {
+    if ( final_[state] ) {
+        entries.clear();
+        append( key, index, entries );
+        fn( key, entries );
+        ++index;
+    }
+    for ( uint32_t arc = first_[state]; arc < first_[state + 1]; ++arc ) {
+        key.push_back( static_cast<char>( labels_[arc] ) );
+        walk( targets_[arc], key, index, entries, fn );
+        key.pop_back();
+    }
+}
+
+
+void FstLexiconStore::append( const std::string &key, uint32_t index, std::vector<LexEntry> &entries ) const {
+    for ( uint32_t i = keyEntries_[index]; i < keyEntries_[index + 1]; ++i ) {
+        const Entry &e = entries_[i];
+        const Classes &c = classes_[e.classes];
+        LexEntry le;
+        le.word( key );
+        le.stdword( stdwords_.c_str() + e.stdword );
+        std::set<InClass::Type> types;
+        for ( int t = 0; t < 64; ++t )
+            if ( c.types & ( 1ULL << t ) )
+                types.insert( static_cast<InClass::Type>( t ) );
+        le.type( types );
+        std::set<InClass::AttachType> attached;
+        for ( int a = 0; a < 32; ++a )
+            if ( c.attached & ( 1U << a ) )
+                attached.insert( static_cast<InClass::AttachType>( a ) );
+        le.attached( attached );
+        entries.push_back( le );
+    }
+}
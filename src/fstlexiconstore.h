@@ -0,0 +1,132 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#ifndef FSTLEXICONSTORE_H
+#define FSTLEXICONSTORE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "lexiconstore.h"
+
+/*
+ * FstLexiconStore is a compact LexiconStore for gazetteer sized lexicons.
+ *
+ * The keys are held in a minimal acyclic finite state transducer, so a
+ * prefix or suffix shared by many keys is stored once. The outputs on
+ * the arcs add up to the index of a key in ascending key order and the
+ * index selects the entries of the key. An entry is only two ids, one
+ * into a table of the distinct standard words and one into a table of
+ * the distinct class and attachment sets, the word is the key itself.
+ *
+ * The store is built by calling add() for every key in ascending byte
+ * order followed by finish(), after that it is read-only. The transducer
+ * is minimized as it is built (Daciuk et al, "Incremental Construction
+ * of Minimal Acyclic Finite-State Automata") so only the states of the
+ * last key are ever unminimized.
+ */
+class FstLexiconStore : public LexiconStore
+{
+public:
+    FstLexiconStore();
+
+    FstLexiconStore( const FstLexiconStore& ) = delete;
+    FstLexiconStore &operator=( const FstLexiconStore& ) = delete;
+
+    // add the entries of key, keys must be added in ascending order and
+    // the word of every entry must be the key
+    void add( const std::string &key, const std::vector<LexEntry> &entries );
+
+    // minimize what is left and release the build tables
+    void finish();
+
+    bool find( const std::string &key, std::vector<LexEntry> &entries ) const;
+    long unsigned int size() const { return nkeys_; };
+    void forEach( const std::function<void(const std::string&, const std::vector<LexEntry>&)> &fn ) const;
+
+    // the sizes of the parts of the store
+    long unsigned int states() const { return final_.size(); };
+    long unsigned int arcs() const { return labels_.size(); };
+    long unsigned int bytes() const;
+
+private:
+
+    // a state of the last key added, its arcs go to frozen states
+    struct Pending {
+        Pending() : final( false ) {};
+        bool final;
+        std::vector<std::pair<unsigned char, uint32_t> > arcs;
+    };
+
+    struct Entry {
+        uint32_t stdword;
+        uint32_t classes;
+    };
+
+    struct Classes {
+        uint64_t types;         // bit n set for InClass::Type n
+        uint32_t attached;      // bit n set for InClass::AttachType n
+    };
+
+    // the register of frozen states, hashed and compared by content
+    struct StateHash {
+        const FstLexiconStore *fst;
+        long unsigned int operator()( uint32_t s ) const;
+    };
+    struct StateEqual {
+        const FstLexiconStore *fst;
+        bool operator()( uint32_t a, uint32_t b ) const;
+    };
+
+    // freeze the states of the last key below depth
+    void minimize( long unsigned int depth );
+    // return the id of a frozen state equal to p, adding it if it is new
+    uint32_t freeze( const Pending &p );
+
+    void walk( uint32_t state, std::string &key, uint32_t &index,
+               std::vector<LexEntry> &entries,
+               const std::function<void(const std::string&, const std::vector<LexEntry>&)> &fn ) const;
+    void append( const std::string &key, uint32_t index, std::vector<LexEntry> &entries ) const;
+
+    // the transducer, the arcs of state s are [first_[s], first_[s+1])
+    // in ascending label order, the output of an arc is the number of
+    // keys that end at its state or pass through the arcs before it
+    std::vector<uint32_t> first_;
+    std::vector<bool> final_;
+    std::vector<unsigned char> labels_;
+    std::vector<uint32_t> targets_;
+    std::vector<uint32_t> outputs_;
+    uint32_t root_;
+
+    // the entries of key n are [keyEntries_[n], keyEntries_[n+1])
+    std::vector<uint32_t> keyEntries_;
+    std::vector<Entry> entries_;
+    std::string stdwords_;
+    std::vector<Classes> classes_;
+    uint32_t nkeys_;
+
+    // only used while building
+    bool finished_;
+    std::string last_;
+    std::vector<Pending> path_;
+    std::vector<uint32_t> counts_;
+    std::unordered_set<uint32_t, StateHash, StateEqual> register_;
+    std::unordered_map<std::string, uint32_t> stdwordIds_;
+    std::unordered_map<std::string, uint32_t> classIds_;
+
+};
+
+#endif
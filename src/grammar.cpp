@@ -11,14 +11,21 @@
  *
  ***************************************************ADDRESS_STANDARDIZER**/
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
-#include <boost/regex.hpp>
-#include <boost/regex/icu.hpp>
 #include <boost/lexical_cast.hpp>
+#include <unicode/uchar.h>
 
 #include "grammar.h"
+#include "compiledgrammar.h"
+
+Grammar::Grammar()
+    : md5_(""), issues_(""), status_(CHECK_OK)
+{
+}
+
 
 Grammar::Grammar( const char *grammar_in ) 
     : md5_(""), issues_(""), status_(CHECK_OK)
@@ -45,65 +52,157 @@ Grammar::Grammar( std::istream &is )
 }
 
 
+// the code point at line[i] and i is moved past it, an invalid byte
+// is returned as -1, which is in none of the classes
+static UChar32 nextChar( const std::string &line, int32_t &i ) {
+    const int32_t len = static_cast<int32_t>( line.size() );
+    const unsigned char lead = static_cast<unsigned char>( line[i++] );
+    int32_t trail;
+    UChar32 c;
+    if ( lead < 0x80 )
+        return lead;
+    else if ( lead >= 0xC2 and lead <= 0xDF ) {
+        trail = 1;
+        c = lead & 0x1F;
+    }
+    else if ( lead >= 0xE0 and lead <= 0xEF ) {
+        trail = 2;
+        c = lead & 0x0F;
+    }
+    else if ( lead >= 0xF0 and lead <= 0xF4 ) {
+        trail = 3;
+        c = lead & 0x07;
+    }
+    else
+        return -1;
+
+    int32_t j = i;
+    for ( ; trail > 0; --trail, ++j ) {
+        if ( j >= len or ( static_cast<unsigned char>( line[j] ) & 0xC0 ) != 0x80 )
+            return -1;
+        c = ( c << 6 ) | ( static_cast<unsigned char>( line[j] ) & 0x3F );
+    }
+    // reject overlong forms, surrogates and values past U+10FFFF
+    if ( ( j - i == 2 and c < 0x800 ) or ( j - i == 3 and c < 0x10000 )
+            or ( c >= 0xD800 and c <= 0xDFFF ) or c > 0x10FFFF )
+        return -1;
+    i = j;
+    return c;
+}
+
+
+// the same characters as \s in an ICU regex
+static bool isSpace( UChar32 c ) {
+    return c >= 0 and u_isspace( c );
+}
+
+
+// the same characters as [\w_] in an ICU regex
+static bool isWord( UChar32 c ) {
+    return c >= 0 and ( u_isalnum( c ) or c == '_' or u_charType( c ) == U_NON_SPACING_MARK );
+}
+
+
+// the index of the first character at or after i that is not a space
+static int32_t skipSpace( const std::string &line, int32_t i ) {
+    const int32_t len = static_cast<int32_t>( line.size() );
+    while ( i < len ) {
+        int32_t j = i;
+        if ( not isSpace( nextChar( line, j ) ) )
+            break;
+        i = j;
+    }
+    return i;
+}
+
+
+// if line is a section header "[name]" set name and return true
+static bool isSection( const std::string &line, std::string &name ) {
+    int32_t start = skipSpace( line, 0 );
+    if ( start >= static_cast<int32_t>( line.size() ) or line[start] != '[' )
+        return false;
+
+    // the name ends at the last ']' that is only followed by spaces
+    const int32_t len = static_cast<int32_t>( line.size() );
+    int32_t end = start + 1;
+    for ( int32_t i = start + 1; i < len; ) {
+        if ( not isSpace( nextChar( line, i ) ) )
+            end = i;
+    }
+    if ( end - start < 3 or line[end - 1] != ']' )
+        return false;
+
+    name = line.substr( start + 1, end - start - 2 );
+    return true;
+}
+
+
+// if line is only meta references "@name @name ..." append the names
+// to refs and return true
+static bool isMeta( const std::string &line, std::vector<std::string> &refs ) {
+    const int32_t len = static_cast<int32_t>( line.size() );
+    int32_t i = 0;
+    bool found = false;
+    while ( true ) {
+        int32_t at = skipSpace( line, i );
+        if ( at >= len or line[at] != '@' )
+            break;
+        int32_t first = at + 1;
+        int32_t last = first;
+        while ( last < len ) {
+            int32_t j = last;
+            if ( not isWord( nextChar( line, j ) ) )
+                break;
+            last = j;
+        }
+        if ( last == first )
+            break;
+        refs.push_back( line.substr( first, last - first ) );
+        found = true;
+        i = last;
+    }
+    return found and skipSpace( line, i ) == len;
+}
+
+
 void Grammar::initialize( std::istream &is )
 {
-    std::string grammar_in;
-
-    auto re_comment = boost::make_u32regex( "^\\s*#.*|^\\s*$" );
-    auto re_section = boost::make_u32regex( "^\\s*\\[(.+)\\]\\s*$" );
-    auto re_ismeta  = boost::make_u32regex( "^(?:\\s*@(?:[\\w_])+)+\\s*$" );
+    MD5 digest;
 
+    // the section being read, it is added to metas_ or rules_ when
+    // its first rule is read and the rules are added to it in place
     std::string gotSection;
     RuleType ruleType = UNKNWN;
-    std::vector<MetaRule> mrules;
-    std::vector<Rule> rules;
     std::string line;
+    std::string name;
+    std::vector<std::string> refs;
 
-    boost::smatch what;
     int line_cnt = 0;
-    while ( is ) {
+    while ( std::getline( is, line ) ) {
         ++line_cnt;
-        std::getline( is, line );
-        grammar_in += line;
+        digest.update( line.data(), static_cast<MD5::size_type>( line.size() ) );
         //std::cout << "\t" << line_cnt << ": " << line << "\n";
 
         // remove UTF8 BOM if one exists
-        if ( line_cnt == 1 and line[0] == '\xEF' and line[1] == '\xBB' and line[2] == '\xBF' )
-            line = line.substr(4);
+        if ( line_cnt == 1 and line.compare( 0, 3, "\xEF\xBB\xBF" ) == 0 )
+            line.erase( 0, 3 );
 
         // skip over comments and blank lines
-        if ( boost::u32regex_match( line, re_comment ) ) 
+        int32_t first = skipSpace( line, 0 );
+        if ( first == static_cast<int32_t>( line.size() ) or line[first] == '#' )
             continue;
         // handle a section header
-        else if ( boost::u32regex_match( line, what, re_section, boost::regex_constants::match_extra ) ) {
-            // the current data if any
+        else if ( isSection( line, name ) ) {
             if ( ruleType != UNKNWN and gotSection == "") {
                     throw std::runtime_error("Grammar-Empty-Section-Defined");
             }
-            else if ( ruleType == ISMETA ) {
-                MetaSection ms(gotSection);
-                ms.rules(mrules);
-                sectionIndex_[gotSection] = metas_.size();
-                metas_.push_back( ms );
-                ruleType = UNKNWN;
-                mrules.clear();
-                rules.clear();
-            }
-            else if ( ruleType == ISRULE ) {
-                RuleSection rs(gotSection);
-                rs.rules(rules);
-                sectionIndex_[gotSection] = rules_.size();
-                rules_.push_back( rs );
-                ruleType = UNKNWN;
-                mrules.clear();
-                rules.clear();
-            }
+            ruleType = UNKNWN;
 
             // start a new section
-            gotSection = what[1];
-    
+            gotSection = name;
+
             // check if the section already exists
-            if ( sectionIndex_.find(gotSection) != sectionIndex_.end() )
+            if ( sectionDef( names_.intern( gotSection ) ).kind != UNKNWN )
                 throw std::runtime_error("Grammar-Duplicate-Section_Name");
         }
         // load data into section
@@ -116,12 +215,21 @@ void Grammar::initialize( std::istream &is )
                 if ( ruleType == ISRULE )
                     throw std::runtime_error("Grammar-Mixing-Rules-and-Metas");
 
-                ruleType = ISMETA;
+                if ( ruleType == UNKNWN ) {
+                    SectionDef &def = sectionDef( names_.intern( gotSection ) );
+                    def.kind = ISMETA;
+                    def.index = metas_.size();
+                    metas_.push_back( MetaSection( gotSection ) );
+                    ruleType = ISMETA;
+                }
 
                 // make sure all tokens are meta
-                if (boost::u32regex_match( line, re_ismeta ) ) {
-                    MetaRule rule( line );
-                    mrules.push_back( rule );
+                refs.clear();
+                if ( isMeta( line, refs ) ) {
+                    MetaRule rule;
+                    for ( const auto &ref : refs )
+                        rule.push_back( names_.intern( ref ) );
+                    metas_.back().push_back( rule );
                 }
             }
             // otherwise it is a standard rule line
@@ -129,95 +237,172 @@ void Grammar::initialize( std::istream &is )
                 if ( ruleType == ISMETA )
                     throw std::runtime_error("Grammar-Mixing-Rules-and-Metas");
 
-                ruleType = ISRULE;
+                if ( ruleType == UNKNWN ) {
+                    SectionDef &def = sectionDef( names_.intern( gotSection ) );
+                    def.kind = ISRULE;
+                    def.index = rules_.size();
+                    rules_.push_back( RuleSection( gotSection ) );
+                    ruleType = ISRULE;
+                }
 
                 Rule rule( line );
-                rules.push_back( rule );
+                rules_.back().push_back( rule );
             }
         }
     }
-    // save the last section we read in
-    if (gotSection.length() > 0) {
-        if ( ruleType == ISMETA ) {
-            MetaSection ms(gotSection);
-            ms.rules(mrules);
-            sectionIndex_[gotSection] = metas_.size();
-            metas_.push_back( ms );
+
+    updatePointers();
+
+//    if ( status_ != 0 )
+//        std::cerr << "Grammar::Grammar(): " << issues_ << "\n";
+
+    if ( status_ == CHECK_FATAL )
+        throw std::runtime_error( issues_ );
+
+    md5_ = digest.finalize().hexdigest();
+
+    program_ = std::make_shared<const CompiledGrammar>( *this );
+}
+
+
+Grammar::SectionDef &Grammar::sectionDef( const SectionPtr &ptr ) {
+    if ( sectionDefs_.size() < names_.size() )
+        sectionDefs_.resize( names_.size() );
+    return sectionDefs_[ptr.id()];
+}
+
+
+void Grammar::flatten( Image &image ) const {
+    SectionPtr ptr;
+    for ( const auto &meta : metas_ ) {
+        names_.find( meta.name(), ptr );
+        image.metaNames.push_back( ptr.id() );
+        image.counts.push_back( static_cast<uint32_t>( meta.size() ) );
+    }
+    for ( const auto &section : rules_ ) {
+        names_.find( section.name(), ptr );
+        image.ruleNames.push_back( ptr.id() );
+        image.counts.push_back( static_cast<uint32_t>( section.size() ) );
+    }
+
+    for ( const auto &meta : metas_ ) {
+        for ( const auto &rule : meta ) {
+            image.sizes.push_back( static_cast<uint32_t>( rule.size() ) );
+            for ( const auto &ref : rule )
+                image.refs.push_back( ref.id() );
         }
-        else if ( ruleType == ISRULE ) {
-            RuleSection rs(gotSection);
-            rs.rules(rules);
-            sectionIndex_[gotSection] = rules_.size();
-            rules_.push_back( rs );
+    }
+    for ( const auto &section : rules_ ) {
+        for ( const auto &rule : section ) {
+            image.sizes.push_back( static_cast<uint32_t>( rule.inSize() ) );
+            image.sizes.push_back( static_cast<uint32_t>( rule.outSize() ) );
+            for ( const auto &t : rule )
+                image.in.push_back( t );
+            for ( long unsigned int i = 0; i < rule.outSize(); ++i )
+                image.out.push_back( rule.out( i ) );
+            image.scores.push_back( rule.score() );
         }
+    }
+}
+
 
-        ruleType = UNKNWN;
-        mrules.clear();
-        rules.clear();
+// the arrays are consumed front to back, anything that does not add
+// up means the archive is damaged
+void Grammar::relink( const Image &image ) {
+    metas_.clear();
+    rules_.clear();
+    sectionDefs_.assign( names_.size(), SectionDef() );
+    program_.reset();
+
+    auto need = [&]( bool ok ) {
+        if ( not ok )
+            throw std::runtime_error( "Grammar-Archive-Corrupt" );
+    };
+    auto left = []( std::vector<uint32_t>::const_iterator it, const std::vector<uint32_t> &v ) {
+        return static_cast<long unsigned int>( v.end() - it );
+    };
+    auto define = [&]( uint32_t id, RuleType kind, long unsigned int index ) {
+        need( id < names_.size() and sectionDefs_[id].kind == UNKNWN );
+        sectionDefs_[id].kind = kind;
+        sectionDefs_[id].index = index;
+        return names_.name( SectionPtr( id ) );
+    };
+
+    need( image.counts.size() == image.metaNames.size() + image.ruleNames.size() );
+    auto count = image.counts.begin();
+    auto size = image.sizes.begin();
+    auto ref = image.refs.begin();
+    auto in = image.in.begin();
+    auto out = image.out.begin();
+    auto score = image.scores.begin();
+
+    metas_.reserve( image.metaNames.size() );
+    for ( const auto id : image.metaNames ) {
+        metas_.push_back( MetaSection( define( id, ISMETA, metas_.size() ) ) );
+        for ( uint32_t r = *count++; r > 0; --r ) {
+            need( size != image.sizes.end() );
+            need( *size <= left( ref, image.refs ) );
+            MetaRule rule;
+            for ( uint32_t n = *size++; n > 0; --n ) {
+                need( *ref < names_.size() );
+                rule.push_back( SectionPtr( *ref++ ) );
+            }
+            metas_.back().push_back( rule );
+        }
     }
 
-    updatePointers();
+    rules_.reserve( image.ruleNames.size() );
+    for ( const auto id : image.ruleNames ) {
+        rules_.push_back( RuleSection( define( id, ISRULE, rules_.size() ) ) );
+        for ( uint32_t r = *count++; r > 0; --r ) {
+            need( left( size, image.sizes ) >= 2 and score != image.scores.end() );
+            need( size[0] <= static_cast<long unsigned int>( image.in.end() - in ) and
+                  size[1] <= static_cast<long unsigned int>( image.out.end() - out ) );
+            std::vector<InClass::Type> ins;
+            for ( uint32_t n = *size++; n > 0; --n )
+                ins.push_back( static_cast<InClass::Type>( *in++ ) );
+            std::vector<OutClass::Type> outs;
+            for ( uint32_t n = *size++; n > 0; --n )
+                outs.push_back( static_cast<OutClass::Type>( *out++ ) );
+            Rule rule( ins, outs, *score++ );
+            rules_.back().push_back( rule );
+        }
+    }
 
-//    if ( status_ != 0 )
-//        std::cerr << "Grammar::Grammar(): " << issues_ << "\n";
+    need( size == image.sizes.end() and ref == image.refs.end() and in == image.in.end()
+          and out == image.out.end() and score == image.scores.end() );
 
+    updatePointers();
     if ( status_ == CHECK_FATAL )
         throw std::runtime_error( issues_ );
 
-    md5_ = md5( grammar_in );
+    program_ = std::make_shared<const CompiledGrammar>( *this );
 }
 
 
 void Grammar::updatePointers() {
     issues_.clear();
-    references_.clear();
     status_ = CHECK_OK;
 
-    // for each MetaSection
-    for ( auto meta = metas_.begin(); meta != metas_.end(); ++meta ) {
-        const std::string& metaName = meta->name();
+    // every name has a definition, UNKNWN if it is only referenced
+    sectionDefs_.resize( names_.size() );
+    references_.assign( names_.size(), 0 );
 
-        // for each metaRules
-        for ( auto refs = meta->begin(); refs != meta->end(); ++refs ) {
+    // for each MetaSection
+    for ( const auto &meta : metas_ ) {
 
-            // for each SectionPtr in refs
-            for ( auto ref = refs->begin(); ref != refs->end(); ++ref ) {
-                // get the name of this SectionPtr
-                const std::string word = ref->name();
+        // for each SectionPtr in each of its rules
+        for ( const auto &rule : meta ) {
+            for ( const auto &ref : rule ) {
 
                 // update the reference stats
-                if ( references_.find( word ) == references_.end() )
-                    references_[word] = 1;
-                else
-                    references_[word] = references_[word] + 1;
-
-                if ( word == metaName )
-                    // if this is self referential then point to self
-                    ref->mptr( &( *meta ) );
-                else {
-                    // otherwise find the SectionPtr this refers to
-                    auto m = sectionIndex_.find( word );
-                    if ( m != sectionIndex_.end() ) {
-                        // see if it refers to a metaSection
-                        if ( m->second < metas_.size()
-                             and metas_[m->second].name() == word ) {
-                            ref->mptr( &( metas_[m->second] ) );
-                        }
-                        // see if it refers to a ruleSection
-                        else if ( m->second < rules_.size()
-                                  and rules_[m->second].name() == word ) {
-                            ref->rptr( &( rules_[m->second] ) );
-                        }
-                        // otherwise something really bad is happening
-                        else
-                            throw std::runtime_error( "Grammar-updatePointers-consistency-check-failed" );
-                    }
-                    // or flag it as an issue if it is missing
-                    else {
-                        issues_ += "Missing rule: " + word +
-                            " : referenced at [" + metaName + "]\n";
-                        status_ = CHECK_FATAL;
-                    }
+                ++references_[ref.id()];
+
+                // flag it as an issue if it is missing
+                if ( sectionDefs_[ref.id()].kind == UNKNWN ) {
+                    issues_ += "Missing rule: " + names_.name( ref ) +
+                        " : referenced at [" + meta.name() + "]\n";
+                    status_ = CHECK_FATAL;
                 }
             }
         }
@@ -225,42 +410,30 @@ void Grammar::updatePointers() {
 
     // check the status of all references and make sure we have 'ADDRESS'
 
-    const auto addr = sectionIndex_.find( "ADDRESS" );
-    if ( addr == sectionIndex_.end() ) {
+    SectionPtr addr;
+    if ( not names_.find( "ADDRESS", addr ) or sectionDefs_[addr.id()].kind == UNKNWN ) {
         issues_ += "Rule 'ADDRESS' is not defined!\n";
         status_ = CHECK_FATAL;
     }
 
+    // every defined section has a name id
+    auto referenced = [this]( const std::string &name ) {
+        SectionPtr ptr;
+        return name == "ADDRESS" or ( names_.find( name, ptr ) and references_[ptr.id()] > 0 );
+    };
+
     for ( const auto &e : metas_ ) {
-        auto ref = references_.find( e.name() );
-        if ( ref == references_.end() and e.name() != "ADDRESS" ) {
+        if ( not referenced( e.name() ) ) {
             issues_ += "Rule '" + e.name() + "' defined by not referenced!\n";
             if ( status_ == CHECK_OK )
                 status_ = CHECK_WARN;
         }
-
-//#define DEBUG
-#ifdef DEBUG
-
-        // check all the pointers are set correctly
-        for ( auto rules = e.begin(); rules != e.end(); ++rules ) {
-            for ( auto r = rules->begin(); r != rules->end(); ++r ) {
-                if ( r->mptr() == NULL and r->rptr() == NULL )
-                    std::cout << "POINTERS: " << e.name() << "."
-                        << r->name() << " both pointers are NULL!\n";
-                if ( r->rptr() != NULL and r->mptr() != NULL )
-                    std::cout << "POINTERS: " << e.name() << "."
-                        << r->name() << " both are not NULL!\n";
-            }
-        }
-#endif
     }
 
     // check all the rules and make sure they are valid
 
-    for ( const auto e : rules_ ) {
-        auto ref = references_.find( e.name() );
-        if ( ref == references_.end() and e.name() != "ADDRESS" ) {
+    for ( const auto &e : rules_ ) {
+        if ( not referenced( e.name() ) ) {
             issues_ += "Rule '" + e.name() + "' defined by not referenced!\n";
             if ( status_ == CHECK_OK )
                 status_ = CHECK_WARN;
@@ -288,7 +461,8 @@ void Grammar::updatePointers() {
 
 std::ostream &operator<<(std::ostream &ss, const Grammar &g) {
     for ( const auto &e : g.metas_ ) {
-        ss << e << "\n";
+        e.print( ss, g.names_ );
+        ss << "\n";
     }
     for ( const auto &e : g.rules_ ) {
         ss << e << "\n";
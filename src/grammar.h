@@ -14,7 +14,9 @@
 #ifndef GRAMMAR_H
 #define GRAMMAR_H
 
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
 #include <iostream>
@@ -29,28 +31,33 @@
 #include "metasection.h"
 #include "rulesection.h"
 
+class CompiledGrammar;
+
 class Grammar
 {
     friend std::ostream &operator<<(std::ostream &ss, const Grammar &g);
+    friend class CompiledGrammar;
 
 private:
     friend class boost::serialization::access;
 
     template<class Archive>
     void load(Archive & ar, const unsigned int version) {
-        if ( version < 1 )
+        if ( version < 3 )
             throw std::runtime_error("Re-compile-your-grammar");
-        ar >> metas_;
-        ar >> rules_;
-        ar >> sectionIndex_;
+        Image image;
+        ar >> names_;
+        ar >> image;
         ar >> md5_;
+        relink( image );
     }
 
     template<class Archive>
     void save(Archive & ar, const unsigned int /* version */) const {
-        ar << metas_;
-        ar << rules_;
-        ar << sectionIndex_;
+        Image image;
+        flatten( image );
+        ar << names_;
+        ar << image;
         ar << md5_;
     }
 
@@ -64,6 +71,7 @@ public:
         CHECK_WARN  =  1
     } Status;
 
+    Grammar();
     Grammar( const Grammar& ) = default;
     explicit Grammar( const std::string &file );
     explicit Grammar( const char *grammar_in );
@@ -72,11 +80,18 @@ public:
     void initialize( std::istream &is );
 //    void check();
 //    void check( std::string section, std::string key );
+
+    // resolve the section references and check the grammar
     void updatePointers();
 
     Status status() const { return status_; };
     std::string issues() const { return issues_; } ;
-    const char *getMd5() { return md5_.c_str(); };
+    const char *getMd5() const { return md5_.c_str(); };
+
+    // the compiled form of the grammar used by Search, it is built
+    // when the grammar is read or loaded from an archive so it is safe
+    // to share a Grammar between threads, NULL for an empty Grammar
+    std::shared_ptr<const CompiledGrammar> program() const { return program_; };
 
 
 private:
@@ -87,23 +102,66 @@ private:
         UNKNWN
     } RuleType;
 
+    // where a section name is defined, an index into metas_ or rules_
+    // by kind, names that are only referenced are UNKNWN
+    struct SectionDef {
+        SectionDef() : kind( UNKNWN ), index( 0 ) {};
+        RuleType kind;
+        unsigned long int index;
+    };
+
+    SectionDef &sectionDef( const SectionPtr &ptr );
+
+    // the archived form of the sections, a handful of flat arrays
+    // instead of one archive object per rule and reference
+    struct Image {
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int /* version */) {
+            ar & metaNames;
+            ar & ruleNames;
+            ar & counts;
+            ar & sizes;
+            ar & refs;
+            ar & in;
+            ar & out;
+            ar & scores;
+        }
+        std::vector<uint32_t> metaNames;    // name id of each meta section
+        std::vector<uint32_t> ruleNames;    // name id of each rule section
+        std::vector<uint32_t> counts;       // rules in each section, metas first
+        std::vector<uint32_t> sizes;        // refs of each meta rule, then the
+                                            // in and out sizes of each rule
+        std::vector<uint32_t> refs;
+        std::vector<int> in;
+        std::vector<int> out;
+        std::vector<float> scores;
+    };
+
+    void flatten( Image &image ) const;
+    // rebuild the sections from an archive in one pass and check them
+    void relink( const Image &image );
+
 
 protected:
 
+    SectionNames names_;
     std::vector<MetaSection> metas_;
     std::vector<RuleSection> rules_;
-    std::map<std::string,unsigned long int> sectionIndex_;
+    std::vector<SectionDef> sectionDefs_;   // by section name id
     std::string md5_;
+    std::shared_ptr<const CompiledGrammar> program_;
 
     // temp storage for analysis and checking of grammar
     std::string issues_;
-    std::map<std::string, int> references_;
+    std::vector<int> references_;           // by section name id
     std::set<std::string> checked_;
     Status status_;
 
 };
 
 // Added md5_ in version 1
-BOOST_CLASS_VERSION(Grammar, 1)
+// Section references became name ids in version 2
+// Sections are archived as flat arrays in version 3
+BOOST_CLASS_VERSION(Grammar, 3)
 
 #endif
@@ -0,0 +1,392 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+#include "instrument.h"
+
+
+std::atomic<bool> Instrument::enabled_( false );
+std::atomic<bool> Instrument::perf_( false );
+thread_local Instrument::Address *Instrument::current_ = NULL;
+
+
+namespace {
+
+// a slot is a histogram, the stages come first then the counters
+const int SLOTS = Instrument::STAGES + Instrument::COUNTERS;
+
+// the perf counters of a stage, the sum of each event, then the number
+// of valid deltas of each event, then the number of Timers
+const int PERFS = 2 * PerfCounters::EVENTS + 1;
+const int PERF_VALID = PerfCounters::EVENTS;
+const int PERF_TIMERS = 2 * PerfCounters::EVENTS;
+
+// the histograms of one thread, only that thread writes them so the
+// updates are plain loads and stores and the readers never see a torn
+// value. A block is handed on to a new thread when its thread exits.
+struct Block {
+    std::atomic<uint64_t> counts[SLOTS][Instrument::Histogram::BUCKETS];
+    std::atomic<uint64_t> sums[SLOTS];
+    std::atomic<uint64_t> perf[Instrument::STAGES][PERFS];
+    bool inUse;
+};
+
+std::mutex &registryMutex() {
+    static std::mutex m;
+    return m;
+}
+
+std::vector<Block*> &registry() {
+    static std::vector<Block*> blocks;
+    return blocks;
+}
+
+// what had been recorded at the last reset(), it is subtracted on read
+std::vector<Instrument::Histogram> &baseline() {
+    static std::vector<Instrument::Histogram> b( SLOTS );
+    return b;
+}
+
+std::vector<uint64_t> &perfBaseline() {
+    static std::vector<uint64_t> b( Instrument::STAGES * PERFS );
+    return b;
+}
+
+struct Owner {
+    Owner() : block( NULL ) {};
+    ~Owner() {
+        if ( block ) {
+            std::lock_guard<std::mutex> lock( registryMutex() );
+            block->inUse = false;
+        }
+    };
+    Block *block;
+};
+
+thread_local Owner owner;
+
+Block &block() {
+    if ( not owner.block ) {
+        std::lock_guard<std::mutex> lock( registryMutex() );
+        for ( auto b : registry() ) {
+            if ( not b->inUse ) {
+                owner.block = b;
+                break;
+            }
+        }
+        if ( not owner.block ) {
+            Block *b = new Block;
+            for ( int s = 0; s < SLOTS; ++s ) {
+                for ( int i = 0; i < Instrument::Histogram::BUCKETS; ++i )
+                    b->counts[s][i].store( 0, std::memory_order_relaxed );
+                b->sums[s].store( 0, std::memory_order_relaxed );
+            }
+            for ( int s = 0; s < Instrument::STAGES; ++s )
+                for ( int i = 0; i < PERFS; ++i )
+                    b->perf[s][i].store( 0, std::memory_order_relaxed );
+            registry().push_back( b );
+            owner.block = b;
+        }
+        owner.block->inUse = true;
+    }
+    return *owner.block;
+}
+
+inline void bump( std::atomic<uint64_t> &a, uint64_t n ) {
+    a.store( a.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+}
+
+}
+
+
+Instrument::Histogram::Histogram() : count_( 0 ), sum_( 0 ) {
+    for ( int i = 0; i < BUCKETS; ++i )
+        counts_[i] = 0;
+}
+
+
+// values below 8 have a bucket each, above that every power of two is
+// split into eight buckets by the three bits after the leading one
+int Instrument::Histogram::bucket( uint64_t value ) {
+    if ( value < 8 )
+        return static_cast<int>( value );
+    int k = 63 - __builtin_clzll( value );
+    return 8 * ( k - 2 ) + static_cast<int>( ( value >> ( k - 3 ) ) & 7 );
+}
+
+
+uint64_t Instrument::Histogram::lower( int bucket ) {
+    if ( bucket < 8 )
+        return static_cast<uint64_t>( bucket );
+    int k = bucket / 8 + 2;
+    return static_cast<uint64_t>( 8 + bucket % 8 ) << ( k - 3 );
+}
+
+
+uint64_t Instrument::Histogram::upper( int bucket ) {
+    if ( bucket < 8 )
+        return static_cast<uint64_t>( bucket );
+    int k = bucket / 8 + 2;
+    return lower( bucket ) + ( static_cast<uint64_t>( 1 ) << ( k - 3 ) ) - 1;
+}
+
+
+void Instrument::Histogram::add( uint64_t value, uint64_t n ) {
+    counts_[bucket( value )] += n;
+    count_ += n;
+    sum_ += value * n;
+}
+
+
+double Instrument::Histogram::mean() const {
+    return count_ ? static_cast<double>( sum_ ) / static_cast<double>( count_ ) : 0.0;
+}
+
+
+double Instrument::Histogram::percentile( double p ) const {
+    if ( count_ == 0 )
+        return 0.0;
+    uint64_t rank = static_cast<uint64_t>( std::ceil( p / 100.0 * static_cast<double>( count_ ) ) );
+    if ( rank < 1 )
+        rank = 1;
+    uint64_t seen = 0;
+    int last = 0;
+    for ( int i = 0; i < BUCKETS; ++i ) {
+        if ( counts_[i] == 0 )
+            continue;
+        last = i;
+        seen += counts_[i];
+        if ( seen >= rank )
+            break;
+    }
+    return ( static_cast<double>( lower( last ) ) + static_cast<double>( upper( last ) ) ) / 2.0;
+}
+
+
+Instrument::Address::Address( bool always ) : record_( enabled() ), outer_( current_ ) {
+    on_ = always or record_;
+    for ( int c = 0; c < COUNTERS; ++c )
+        counts_[c].store( 0, std::memory_order_relaxed );
+    for ( int s = 0; s < STAGES; ++s )
+        nanos_[s].store( 0, std::memory_order_relaxed );
+    if ( on_ ) {
+        start_ = std::chrono::steady_clock::now();
+        current_ = this;
+    }
+}
+
+
+Instrument::Address::~Address() {
+    if ( not on_ )
+        return;
+    current_ = outer_;
+    if ( not record_ )
+        return;
+    record( TOTAL, nanos( TOTAL ) );
+    for ( int c = 0; c < COUNTERS; ++c )
+        record( STAGES + c, counts_[c].load( std::memory_order_relaxed ) );
+}
+
+
+uint64_t Instrument::Address::nanos( Stage s ) const {
+    if ( s != TOTAL )
+        return nanos_[s].load( std::memory_order_relaxed );
+    if ( not on_ )
+        return 0;
+    return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_ ).count() );
+}
+
+
+void Instrument::record( int slot, uint64_t value ) {
+    Block &b = block();
+    bump( b.counts[slot][Histogram::bucket( value )], 1 );
+    bump( b.sums[slot], value );
+}
+
+
+void Instrument::recordPerf( Stage s, const PerfCounters::Sample &start ) {
+    PerfCounters::Sample end;
+    PerfCounters::thread().read( end );
+    Block &b = block();
+    for ( int e = 0; e < PerfCounters::EVENTS; ++e ) {
+        uint64_t d;
+        if ( PerfCounters::delta( start, end, static_cast<PerfCounters::Event>( e ), d ) ) {
+            bump( b.perf[s][e], d );
+            bump( b.perf[s][PERF_VALID + e], 1 );
+        }
+    }
+    bump( b.perf[s][PERF_TIMERS], 1 );
+}
+
+
+// everything recorded since the start, the registry must be locked
+Instrument::Histogram Instrument::total( int slot ) {
+    Histogram h;
+    for ( const auto b : registry() ) {
+        for ( int i = 0; i < Histogram::BUCKETS; ++i ) {
+            uint64_t n = b->counts[slot][i].load( std::memory_order_relaxed );
+            h.counts_[i] += n;
+            h.count_ += n;
+        }
+        h.sum_ += b->sums[slot].load( std::memory_order_relaxed );
+    }
+    return h;
+}
+
+
+Instrument::Histogram Instrument::read( int slot ) {
+    std::lock_guard<std::mutex> lock( registryMutex() );
+    Histogram h = total( slot );
+    const Histogram &base = baseline()[slot];
+    for ( int i = 0; i < Histogram::BUCKETS; ++i )
+        h.counts_[i] -= base.counts_[i];
+    h.count_ -= base.count_;
+    h.sum_ -= base.sum_;
+    return h;
+}
+
+
+uint64_t Instrument::readPerf( Stage s, int i ) {
+    std::lock_guard<std::mutex> lock( registryMutex() );
+    uint64_t n = 0;
+    for ( const auto b : registry() )
+        n += b->perf[s][i].load( std::memory_order_relaxed );
+    return n - perfBaseline()[s * PERFS + i];
+}
+
+
+uint64_t Instrument::perfSamples( Stage s ) {
+    return readPerf( s, PERF_TIMERS );
+}
+
+
+double Instrument::perfMean( Stage s, PerfCounters::Event e ) {
+    uint64_t n = readPerf( s, PERF_VALID + e );
+    return n ? static_cast<double>( readPerf( s, e ) ) / static_cast<double>( n ) : 0.0;
+}
+
+
+Instrument::Histogram Instrument::stage( Stage s ) {
+    return read( s );
+}
+
+
+Instrument::Histogram Instrument::counter( Counter c ) {
+    return read( STAGES + c );
+}
+
+
+void Instrument::reset() {
+    std::lock_guard<std::mutex> lock( registryMutex() );
+    for ( int s = 0; s < SLOTS; ++s )
+        baseline()[s] = total( s );
+    for ( int s = 0; s < STAGES; ++s ) {
+        for ( int i = 0; i < PERFS; ++i ) {
+            uint64_t n = 0;
+            for ( const auto b : registry() )
+                n += b->perf[s][i].load( std::memory_order_relaxed );
+            perfBaseline()[s * PERFS + i] = n;
+        }
+    }
+}
+
+
+void Instrument::report( std::ostream &os ) {
+    // leave the formatting of os as it was
+    std::ios_base::fmtflags flags( os.flags() );
+    std::streamsize precision( os.precision() );
+
+    os << std::left << std::setw( 14 ) << "stage" << std::right
+       << std::setw( 10 ) << "samples"
+       << std::setw( 12 ) << "mean"
+       << std::setw( 12 ) << "p50"
+       << std::setw( 12 ) << "p90"
+       << std::setw( 12 ) << "p99"
+       << std::setw( 12 ) << "max" << "\n";
+
+    auto line = [&os]( const std::string &name, const Histogram &h, double scale ) {
+        if ( h.count() == 0 )
+            return;
+        os << std::left << std::setw( 14 ) << name << std::right
+           << std::setw( 10 ) << h.count() << std::fixed << std::setprecision( 1 )
+           << std::setw( 12 ) << h.mean() / scale
+           << std::setw( 12 ) << h.percentile( 50.0 ) / scale
+           << std::setw( 12 ) << h.percentile( 90.0 ) / scale
+           << std::setw( 12 ) << h.percentile( 99.0 ) / scale
+           << std::setw( 12 ) << h.max() / scale << "\n";
+    };
+
+    // stages in microseconds, counters per address
+    for ( int s = 0; s < STAGES; ++s )
+        line( asString( static_cast<Stage>( s ) ) + " us", stage( static_cast<Stage>( s ) ), 1000.0 );
+    for ( int c = 0; c < COUNTERS; ++c )
+        line( asString( static_cast<Counter>( c ) ), counter( static_cast<Counter>( c ) ), 1.0 );
+
+    // perf counters per Timer, the events that could not be opened are
+    // shown as "-"
+    const PerfCounters &pc = PerfCounters::thread();
+    bool header = false;
+    for ( int s = 0; s < STAGES; ++s ) {
+        Stage st = static_cast<Stage>( s );
+        if ( perfSamples( st ) == 0 )
+            continue;
+        if ( not header ) {
+            os << std::left << std::setw( 14 ) << "perf" << std::right
+               << std::setw( 10 ) << "samples";
+            for ( int e = 0; e < PerfCounters::EVENTS; ++e )
+                os << std::setw( 15 ) << PerfCounters::asString( static_cast<PerfCounters::Event>( e ) );
+            os << std::setw( 8 ) << "ipc" << "\n";
+            header = true;
+        }
+        os << std::left << std::setw( 14 ) << asString( st ) << std::right
+           << std::setw( 10 ) << perfSamples( st ) << std::fixed << std::setprecision( 1 );
+        for ( int e = 0; e < PerfCounters::EVENTS; ++e ) {
+            PerfCounters::Event ev = static_cast<PerfCounters::Event>( e );
+            if ( pc.available( ev ) )
+                os << std::setw( 15 ) << perfMean( st, ev );
+            else
+                os << std::setw( 15 ) << "-";
+        }
+        double cycles = perfMean( st, PerfCounters::CYCLES );
+        if ( pc.available( PerfCounters::CYCLES ) and pc.available( PerfCounters::INSTRUCTIONS ) and cycles > 0 )
+            os << std::setw( 8 ) << std::setprecision( 2 ) << perfMean( st, PerfCounters::INSTRUCTIONS ) / cycles;
+        else
+            os << std::setw( 8 ) << "-";
+        os << "\n";
+    }
+
+    os.flags( flags );
+    os.precision( precision );
+}
+
+
+std::string Instrument::asString( Stage s ) {
+    static const char *names[] = {
+        "normalize", "tokenize", "split", "alts", "enumerate",
+        "search", "reclass", "standardize", "output", "total"
+    };
+    int i = static_cast<int>( s );
+    return ( i >= 0 and i < STAGES ) ? names[i] : "unknown";
+}
+
+
+std::string Instrument::asString( Counter c ) {
+    static const char *names[] = { "patterns", "alternatives", "paths", "rules" };
+    int i = static_cast<int>( c );
+    return ( i >= 0 and i < COUNTERS ) ? names[i] : "unknown";
+}
@@ -0,0 +1,233 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "perfcounters.h"
+
+/*
+ * Instrument records where the time goes when standardizing addresses.
+ *
+ * It is always compiled in and off by default, enable() turns it on for
+ * the whole process. When it is off a Timer or an Address costs one
+ * relaxed atomic load and a thread local load.
+ *
+ * A Timer records the nanoseconds spent in one stage of the pipeline and
+ * an Address brackets all the work done for one address, its TOTAL time
+ * and the counters charged to it while it is current. An Address also
+ * keeps the stage times and counters of its own address, one made with
+ * always set does so even while it is off, to explain a single address
+ * without touching the histograms. Every sample goes
+ * into a histogram of the calling thread, so recording never contends
+ * with another thread, and the histograms of all threads are added up
+ * when they are read.
+ *
+ * The histograms have eight buckets per power of two, so percentiles are
+ * within about 6% of the true value.
+ *
+ * perf() also reads the PerfCounters of the thread around every Timer
+ * and adds up the counts per stage. That costs a few system calls per
+ * Timer so it is off unless asked for.
+ */
+class Instrument
+{
+public:
+
+    typedef enum {
+        NORMALIZE   = 0,    // Utils::normalizeUTF8 and upperCaseUTF8
+        TOKENIZE    = 1,    // Tokenizer::getTokens
+        SPLIT       = 2,    // Tokenizer::splitToken
+        ALTS        = 3,    // generating alternate phrases
+        ENUMERATE   = 4,    // Token::enumerate
+        SEARCH      = 5,    // matching the patterns against the grammar, includes ENUMERATE
+        RECLASS     = 6,    // Search::reclassTokens
+        STANDARDIZE = 7,    // Lexicon::standardize of the best tokens
+        OUTPUT      = 8,    // building the result
+        TOTAL       = 9     // one address from start to end
+    } Stage;
+    static const int STAGES = 10;
+
+    typedef enum {
+        PATTERNS     = 0,   // class patterns enumerated
+        ALTERNATIVES = 1,   // alternate phrases generated
+        PATHS        = 2,   // partial paths taken off the search stack
+        RULES        = 3    // rules compared against a pattern
+    } Counter;
+    static const int COUNTERS = 4;
+
+    static void enable( bool on ) { enabled_.store( on, std::memory_order_relaxed ); };
+    static bool enabled() { return enabled_.load( std::memory_order_relaxed ); };
+
+    static void perf( bool on ) { perf_.store( on, std::memory_order_relaxed ); };
+    static bool perf() { return perf_.load( std::memory_order_relaxed ); };
+
+    class Histogram
+    {
+    public:
+        static const int BUCKETS = 496;
+
+        Histogram();
+
+        void add( uint64_t value, uint64_t n = 1 );
+
+        uint64_t count() const { return count_; };
+        uint64_t sum() const { return sum_; };
+        double mean() const;
+        // the middle of the bucket holding the p'th percentile, p is 0..100
+        double percentile( double p ) const;
+        double max() const { return percentile( 100.0 ); };
+
+        static int bucket( uint64_t value );
+        static uint64_t lower( int bucket );
+        static uint64_t upper( int bucket );
+
+    private:
+        friend class Instrument;
+        uint64_t counts_[BUCKETS];
+        uint64_t count_;
+        uint64_t sum_;
+    };
+
+    // the work for one address, counters charged on this thread go to
+    // it while it exists and are recorded when it is destroyed, with
+    // always it is current even while instrumentation is off
+    class Address
+    {
+    public:
+        explicit Address( bool always = false );
+        ~Address();
+
+        Address( const Address& ) = delete;
+        Address &operator=( const Address& ) = delete;
+
+        uint64_t counter( Counter c ) const { return counts_[c].load( std::memory_order_relaxed ); };
+        // nanoseconds spent in a stage of this address, TOTAL is the
+        // time since the Address was made
+        uint64_t nanos( Stage s ) const;
+
+    private:
+        friend class Instrument;
+        bool on_;
+        bool record_;       // add it to the histograms when destroyed
+        Address *outer_;
+        std::atomic<uint64_t> counts_[COUNTERS];
+        std::atomic<uint64_t> nanos_[STAGES];
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    // times a stage from construction to destruction
+    class Timer
+    {
+    public:
+        explicit Timer( Stage stage ) : stage_( stage ), on_( enabled() ), perf_( on_ and perf() ), address_( current_ ) {
+            if ( perf_ )
+                PerfCounters::thread().read( counts_ );
+            if ( on_ or address_ )
+                start_ = std::chrono::steady_clock::now();
+        };
+        ~Timer() { stop(); };
+
+        // record the time now instead of when it is destroyed
+        void stop() {
+            if ( on_ or address_ ) {
+                uint64_t ns = static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start_ ).count() );
+                if ( on_ )
+                    record( stage_, ns );
+                if ( address_ )
+                    address_->nanos_[stage_].fetch_add( ns, std::memory_order_relaxed );
+            }
+            if ( perf_ )
+                recordPerf( stage_, counts_ );
+            on_ = false;
+            perf_ = false;
+            address_ = NULL;
+        };
+
+        Timer( const Timer& ) = delete;
+        Timer &operator=( const Timer& ) = delete;
+
+    private:
+        Stage stage_;
+        bool on_;
+        bool perf_;
+        Address *address_;
+        std::chrono::steady_clock::time_point start_;
+        PerfCounters::Sample counts_;
+    };
+
+    // charge the work of a pool thread to the address of the thread
+    // that handed it out, see current()
+    class Attach
+    {
+    public:
+        explicit Attach( Address *address ) : outer_( current_ ) { current_ = address; };
+        ~Attach() { current_ = outer_; };
+
+        Attach( const Attach& ) = delete;
+        Attach &operator=( const Attach& ) = delete;
+
+    private:
+        Address *outer_;
+    };
+
+    // the address being worked on by this thread, NULL if none
+    static Address *current() { return current_; };
+
+    static void count( Counter c, uint64_t n ) {
+        if ( current_ )
+            current_->counts_[c].fetch_add( n, std::memory_order_relaxed );
+    };
+
+    // the samples of all threads since the last reset(), in nanoseconds
+    // for a stage and per address for a counter
+    static Histogram stage( Stage s );
+    static Histogram counter( Counter c );
+
+    // the Timers that read the perf counters for a stage since the last
+    // reset() and the mean of an event over those that read it, a delta
+    // is dropped when a read failed or the count went down
+    static uint64_t perfSamples( Stage s );
+    static double perfMean( Stage s, PerfCounters::Event e );
+
+    static void reset();
+
+    // one line per stage and counter that has samples, followed by the
+    // perf counter means of the stages that have any
+    static void report( std::ostream &os );
+
+    static std::string asString( Stage s );
+    static std::string asString( Counter c );
+
+private:
+
+    static void record( int slot, uint64_t value );
+    static Histogram total( int slot );
+    static Histogram read( int slot );
+    static void recordPerf( Stage s, const PerfCounters::Sample &start );
+    static uint64_t readPerf( Stage s, int i );
+
+    static std::atomic<bool> enabled_;
+    static std::atomic<bool> perf_;
+    static thread_local Address *current_;
+
+};
+
+#endif
@@ -122,13 +122,24 @@ LexEntry::LexEntry(const std::string &line)
     std::string in_type;
     std::string in_attached;
 
-    std::stringstream buffer(line);
-    std::getline(buffer, in_word, '\t');
+    // split on tabs, missing fields are left empty
+    std::string::size_type pos = 0;
+    auto next = [&line, &pos]( std::string &field ) {
+        if ( pos > line.size() )
+            return;
+        std::string::size_type tab = line.find( '\t', pos );
+        if ( tab == std::string::npos )
+            tab = line.size();
+        field.assign( line, pos, tab - pos );
+        pos = tab + 1;
+    };
+
+    next( in_word );
     if (in_word == "LEXENTRY:")
-        std::getline(buffer, in_word, '\t');
-    std::getline(buffer, in_stdword, '\t');
-    std::getline(buffer, in_type, '\t');
-    std::getline(buffer, in_attached, '\t');
+        next( in_word );
+    next( in_stdword );
+    next( in_type );
+    next( in_attached );
 
     word_     = in_word;
     stdword_  = in_stdword;
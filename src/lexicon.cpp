@@ -22,6 +22,8 @@
 #include "lexentry.h"
 #include "inclass.h"
 #include "lexicon.h"
+#include "threadpool.h"
+#include "fstlexiconstore.h"
 
 // constructors
 
@@ -39,10 +41,10 @@ Lexicon::Lexicon(std::string name) :
 {}
 
 
-Lexicon::Lexicon(std::string name, std::istream &is ) :
+Lexicon::Lexicon(std::string name, std::istream &is, ThreadPool *pool ) :
     name_(name), lang_(InClass::UNKNOWN), locale_(""), md5_("")
 {
-    initialize( is );
+    initialize( is, pool );
 }
 
 
@@ -54,23 +56,52 @@ Lexicon::Lexicon( char *lexicon_in ) :
 }
 
 
-Lexicon::Lexicon(std::string name, std::string file) :
+Lexicon::Lexicon(std::string name, std::string file, ThreadPool *pool) :
     name_(name), lang_(InClass::UNKNOWN), locale_("")
 {
     std::ifstream ifs;
     ifs.open( file.c_str(), std::ifstream::in);
-    initialize( ifs );
+    initialize( ifs, pool );
     ifs.close();
 }
 
 
-void Lexicon::initialize( std::istream &is ) {
+Lexicon::Lexicon( std::shared_ptr<const LexiconStore> store, std::string name,
+                  InClass::Lang lang, std::string locale, std::string md5,
+                  std::string regex, std::string regexPrefix, std::string regexSuffix ) :
+    name_(name), lang_(lang), locale_(locale), store_(store),
+    regex_(regex), regexPrefix_(regexPrefix), regexSuffix_(regexSuffix),
+    md5_(md5)
+{}
+
+
+// collapse runs of spaces to a single space, tabs are left alone
+static void squeezeSpaces( std::string &line ) {
+    std::string::size_type j = 0;
+    bool space = false;
+    for ( std::string::size_type i = 0; i < line.size(); ++i ) {
+        if ( line[i] == ' ' and space )
+            continue;
+        space = line[i] == ' ';
+        line[j++] = line[i];
+    }
+    line.resize( j );
+}
+
+
+// entries are normalized and uppercased this many bytes at a time
+// because the ICU calls cost far more than the work on one line,
+// each batch is also one task when the entries are parsed on a pool
+#define LEXICON_BATCH_SIZE 65536
+
+
+void Lexicon::initialize( std::istream &is, ThreadPool *pool ) {
     std::string line;
-    std::string lexicon_in;
+    MD5 digest;
     unsigned long int cnt = 0;
 
     std::getline( is, line );
-    lexicon_in += line;
+    digest.update( line.data(), static_cast<MD5::size_type>( line.size() ) );
 
     // remove UTF8 BOM if one exists
     if (line[0] == '\xEF' && line[1] == '\xBB' && line[2] == '\xBF')
@@ -83,7 +114,7 @@ void Lexicon::initialize( std::istream &is ) {
             throw std::runtime_error("Lexicon-LexEntry-Before-Lexicon");
         }
         std::getline( is, line );
-        lexicon_in += line;
+        digest.update( line.data(), static_cast<MD5::size_type>( line.size() ) );
         ++cnt;
     }
 
@@ -108,41 +139,102 @@ void Lexicon::initialize( std::istream &is ) {
     std::getline(buffer, locale_, '\t');    // set the locale
                                             // ignore the count of keys
 
-    UErrorCode errorCode;
+    detach();
+
+    // the entry lines are collected in batches, one entry per line of
+    // text with their line numbers for error messages, the entries and
+    // the first error are filled in when the batch is parsed
+    struct Batch {
+        std::string text;
+        std::vector<unsigned long int> lines;
+        std::vector<LexEntry> entries;
+        std::string error;
+    };
+    std::vector<Batch> batches;
+    std::string badLine;
 
     // read in the lexicon entries
-    while ( is ) {
-        std::getline( is, line );
-        lexicon_in += line;
+    while ( std::getline( is, line ) ) {
+        digest.update( line.data(), static_cast<MD5::size_type>( line.size() ) );
         ++cnt;
         //std::cout << "\t" << line << "\n";
 
         // replace multiple space chars with a single space
         // but don't touch tab chars
-        auto re = boost::make_u32regex( "( +)" );
-        const char* replace = " ";
-        std::string tmp = boost::u32regex_replace(line, re, replace);
-        line = tmp;
+        squeezeSpaces( line );
 
         if (line.length() == 0) continue;
 
         if ( line.compare(0, 9, "LEXENTRY:") == 0 or
              line.compare(0, 9, "LexEntry:") == 0 ) {
-            line = Utils::normalizeUTF8( line, errorCode );
-            if (locale_ != "") {
-                line = Utils::upperCaseUTF8( line, locale_ );
-            }
-            LexEntry le( line );
-            if ( le.isInClass( InClass::BADTOKEN ) )
-                throw std::runtime_error("Lexicon-Invalid-LexEntry: "+ std::to_string(cnt) + ": " + line);
-            insert( le );
+            if ( batches.empty() or batches.back().text.size() >= LEXICON_BATCH_SIZE )
+                batches.push_back( Batch() );
+            batches.back().text += line;
+            batches.back().text += '\n';
+            batches.back().lines.push_back( cnt );
         }
         else {
-            throw std::runtime_error("Lexicon-Invalid-LexEntry: "+ std::to_string(cnt) + ": " + line);
+            // any bad entries before this line are reported first
+            badLine = "Lexicon-Invalid-LexEntry: "+ std::to_string(cnt) + ": " + line;
+            break;
+        }
+    }
+
+    // batches only read locale_ so they can be parsed in any order
+    auto parse = [this, &batches]( long unsigned int i ) {
+        Batch &batch = batches[i];
+
+        UErrorCode errorCode;
+        std::string text = Utils::normalizeUTF8( batch.text, errorCode );
+        if ( U_FAILURE(errorCode) ) {
+            batch.error = "Lexicon-Invalid-LexEntry: " + std::to_string(batch.lines.front()) + ": can not normalize";
+            return;
         }
+        if (locale_ != "") {
+            text = Utils::upperCaseUTF8( text, locale_ );
+        }
+
+        batch.entries.reserve( batch.lines.size() );
+        std::string::size_type start = 0;
+        for ( const auto n : batch.lines ) {
+            std::string::size_type end = text.find( '\n', start );
+            if ( end == std::string::npos ) {
+                batch.error = "Lexicon-Invalid-LexEntry: " + std::to_string(n) + ": can not normalize";
+                return;
+            }
+            std::string entry = text.substr( start, end - start );
+            start = end + 1;
+
+            LexEntry le( entry );
+            if ( le.isInClass( InClass::BADTOKEN ) ) {
+                batch.error = "Lexicon-Invalid-LexEntry: "+ std::to_string(n) + ": " + entry;
+                return;
+            }
+            batch.entries.push_back( le );
+        }
+        batch.text.clear();
+    };
+
+    if ( pool )
+        pool->parallelFor( batches.size(), parse );
+    else
+        for ( long unsigned int i = 0; i < batches.size(); ++i )
+            parse( i );
+
+    // merge the entries in file order so the index and the order of the
+    // entries for a key do not depend on how the batches were parsed
+    for ( auto &batch : batches ) {
+        for ( const auto &le : batch.entries )
+            insert( le );
+        if ( not batch.error.empty() )
+            throw std::runtime_error( batch.error );
+        std::vector<LexEntry>().swap( batch.entries );
     }
 
-    md5_ = md5( lexicon_in );
+    if ( not badLine.empty() )
+        throw std::runtime_error( badLine );
+
+    md5_ = digest.finalize().hexdigest();
 }
 
 // getters
@@ -152,6 +244,11 @@ std::vector<LexEntry> Lexicon::find( const std::string key ) {
 
     std::vector<LexEntry> empty;
 
+    if ( store_ ) {
+        store_->find( key, empty );
+        return empty;
+    }
+
     auto it = lex_.find( key );
     if ( it != lex_.end() )
         return (*it).second;
@@ -167,12 +264,13 @@ std::ostream &operator<<(std::ostream &ss, const Lexicon &lex) {
        << lex.name_ << "\t"
        << lex.langAsString() << "\t"
        << lex.locale_ << "\t"
-       << lex.lex_.size() << "\n";
+       << lex.size() << "\n";
 
     // each lexicon entry is a vector of LexEntry objects
-    for (const auto &l  : lex.lex_)
-        for (const auto &d : l.second)
+    lex.forEach( [&ss]( const std::string &, const std::vector<LexEntry> &entries ) {
+        for (const auto &d : entries)
             ss << d << "\n";
+    } );
 
     return ss;
 }
@@ -312,12 +410,10 @@ void Lexicon::classify( Token& token, InClass::Type typ ) {
 
 void Lexicon::insert( const LexEntry &le ) {
 
-    // get the map key we want to find
-    std::string key = le.word();
+    detach();
 
-    // fetch the entry from the lexicon
-    // we get an empty container if it is not found
-    std::vector<LexEntry> entries = find( key );
+    // the entries for this word, the key is added if it is new
+    std::vector<LexEntry> &entries = lex_[ le.word() ];
 
     // see if it is already here and do nothing if it is
     for( const auto &entry : entries )
@@ -327,9 +423,6 @@ void Lexicon::insert( const LexEntry &le ) {
     // append the lexentry to the existing entries for this key
     entries.push_back( le );
 
-    // save it back in the lexicon
-    lex_[key] = entries;
-
     // set cached regex strings to empty
     // so it will get regenerated
     regex_.clear();
@@ -339,7 +432,9 @@ void Lexicon::insert( const LexEntry &le ) {
 
 
 void Lexicon::remove( const LexEntry &le ) {
-    
+
+    detach();
+
     // get the map key we want to find
     std::string key = le.word();
 
@@ -386,11 +481,7 @@ std::string Lexicon::regex() {
 
 #define USE_TRIE
 #ifdef USE_TRIE
-        TrieUtf8 trie;
-        for ( const auto &e : lex_ )
-            trie.addWord( e.first );
-
-        regex_ = trie.getRegexp() + "|";
+        compile();
 #else
         // collect all lexicon keys in vector
         std::vector<std::string> keys;
@@ -419,12 +510,7 @@ std::string Lexicon::regexPrefixAtt() {
 
     if (regexPrefix_.length() == 0) {
 #ifdef USE_TRIE
-        TrieUtf8 trie;
-        for ( const auto &e : lex_ )
-            for ( const auto &le : e.second )
-                if ( le.isPrefixAttached() )
-                    trie.addWord( e.first );
-        regexPrefix_ = "^" + trie.getRegexp() + "\\B";
+        compile();
 #else
 
         std::vector<std::string> prefix;
@@ -460,13 +546,7 @@ std::string Lexicon::regexSuffixAtt() {
 
     if (regexSuffix_.length() == 0) {
 #ifdef USE_TRIE
-        TrieUtf8 trie;
-        for ( const auto &e : lex_ )
-            for ( const auto &le : e.second )
-                if ( le.isSuffixAttached() )
-                    trie.addWord( e.first );
-
-        regexSuffix_ = trie.getRegexp();
+        compile();
 #else
         std::vector<std::string> suffix;
 
@@ -497,8 +577,92 @@ std::string Lexicon::regexSuffixAtt() {
 }
 
 
+void Lexicon::compact() {
+    auto fst = std::make_shared<FstLexiconStore>();
+
+    if ( store_ )
+        store_->forEach( [&fst]( const std::string &key, const std::vector<LexEntry> &entries ) {
+            fst->add( key, entries );
+        } );
+    else {
+        // release the map as it is copied to keep the peak down
+        for ( auto it = lex_.begin(); it != lex_.end(); it = lex_.erase( it ) )
+            fst->add( it->first, it->second );
+    }
+
+    fst->finish();
+    store_ = fst;
+}
+
+
+void Lexicon::compile( ThreadPool *pool ) {
+    bool all    = regex_.length() == 0;
+    bool prefix = regexPrefix_.length() == 0;
+    bool suffix = regexSuffix_.length() == 0;
+    if ( not ( all or prefix or suffix ) )
+        return;
+
+    // fill the tries for every missing regex in one walk of the entries
+    TrieUtf8 allTrie;
+    TrieUtf8 prefixTrie;
+    TrieUtf8 suffixTrie;
+    forEach( [&]( const std::string &key, const std::vector<LexEntry> &entries ) {
+        if ( all )
+            allTrie.addWord( key );
+        bool isPrefix = false;
+        bool isSuffix = false;
+        for ( const auto &le : entries ) {
+            isPrefix = isPrefix or le.isPrefixAttached();
+            isSuffix = isSuffix or le.isSuffixAttached();
+        }
+        if ( prefix and isPrefix )
+            prefixTrie.addWord( key );
+        if ( suffix and isSuffix )
+            suffixTrie.addWord( key );
+    } );
+
+    // the tries are independent so they can be turned into regexes at once
+    auto build = [&]( long unsigned int i ) {
+        if ( i == 0 and all )
+            regex_ = allTrie.getRegexp() + "|";
+        else if ( i == 1 and prefix )
+            regexPrefix_ = "^" + prefixTrie.getRegexp() + "\\B";
+        else if ( i == 2 and suffix )
+            regexSuffix_ = suffixTrie.getRegexp();
+    };
+
+    if ( pool )
+        pool->parallelFor( 3, build );
+    else
+        for ( long unsigned int i = 0; i < 3; ++i )
+            build( i );
+}
+
+
 // PRIVATE methods
 
+void Lexicon::forEach( const std::function<void(const std::string&, const std::vector<LexEntry>&)> &fn ) const {
+    if ( store_ ) {
+        store_->forEach( fn );
+        return;
+    }
+    for ( const auto &e : lex_ )
+        fn( e.first, e.second );
+}
+
+
+void Lexicon::detach() {
+    if ( not store_ )
+        return;
+
+    lex_.clear();
+    store_->forEach( [this]( const std::string &key, const std::vector<LexEntry> &entries ) {
+        lex_[key] = entries;
+    } );
+    store_.reset();
+}
+
+
 static const char* special_chars_regex = "([-.+*~$()\\[\\]\\\\|?])";
 static const char* special_chars_replace = "\\\\$1";
 
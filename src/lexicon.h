@@ -19,6 +19,7 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <memory>
 #include <boost/regex.hpp>
 #include <boost/regex/icu.hpp>
 #include <boost/serialization/version.hpp>
@@ -29,9 +30,12 @@
 #include "inclass.h"
 #include "token.h"
 #include "lexentry.h"
+#include "lexiconstore.h"
 
 #define LEXICON_ARCHIVE_VERSION 2
 
+class ThreadPool;
+
 class Lexicon
 {
     friend class boost::serialization::access;
@@ -40,6 +44,7 @@ class Lexicon
     void load(Archive & ar, const unsigned int version) {
         if ( version < LEXICON_ARCHIVE_VERSION )
             throw std::runtime_error("Re-compile-lexicon");
+        store_.reset();
         ar >> name_;
         ar >> lang_;
         ar >> locale_;
@@ -56,7 +61,16 @@ class Lexicon
         ar << name_;
         ar << lang_;
         ar << locale_;
-        ar << lex_;
+        if ( store_ ) {
+            // archives always hold the map form of the entries
+            std::map <std::string, std::vector<LexEntry>, lexcomp> lex;
+            store_->forEach( [&lex]( const std::string &key, const std::vector<LexEntry> &entries ) {
+                lex[key] = entries;
+            } );
+            ar << lex;
+        }
+        else
+            ar << lex_;
         ar << regex_;
         ar << regexPrefix_;
         ar << regexSuffix_;
@@ -72,10 +86,16 @@ public:
     Lexicon();
     explicit Lexicon( std::string name );
     explicit Lexicon( char *lexicon_in );
-    Lexicon( std::string name, std::string file );
-    Lexicon( std::string name, std::istream &is );
+    // the entries are parsed on pool when one is given
+    Lexicon( std::string name, std::string file, ThreadPool *pool = NULL );
+    Lexicon( std::string name, std::istream &is, ThreadPool *pool = NULL );
+    // a read-only lexicon over a store, it is copied into the map
+    // the first time it is modified
+    Lexicon( std::shared_ptr<const LexiconStore> store, std::string name,
+             InClass::Lang lang, std::string locale, std::string md5,
+             std::string regex, std::string regexPrefix, std::string regexSuffix );
 
-    void initialize(std::istream &is);
+    void initialize( std::istream &is, ThreadPool *pool = NULL );
 
     // getters
     std::string name() const { return name_; };
@@ -83,7 +103,12 @@ public:
     std::string langAsString() const { return InClass::asString(lang_); };
     std::string langAsName() const { return InClass::asName(lang_); };
     std::string locale() const { return locale_; };
-    const char *getMd5() { return md5_.c_str(); };
+    const char *getMd5() const { return md5_.c_str(); };
+    long unsigned int size() const { return store_ ? store_->size() : lex_.size(); };
+    bool isReadOnly() const { return store_ != nullptr; };
+
+    // call fn for every key and its entries in ascending key order
+    void forEach( const std::function<void(const std::string&, const std::vector<LexEntry>&)> &fn ) const;
 
     std::vector<LexEntry> find( const std::string key );
 
@@ -100,6 +125,15 @@ public:
     std::string regexPrefixAtt();
     std::string regexSuffixAtt();
 
+    // move the entries into an FstLexiconStore, which takes a small
+    // fraction of the memory of the map, the lexicon becomes read-only
+    // until it is next modified
+    void compact();
+
+    // build all of the regex strings that are not cached in one pass
+    // over the entries, the tries are turned into regexes on pool
+    void compile( ThreadPool *pool = NULL );
+
     // operators
     friend std::ostream &operator<<(std::ostream &ss, const Lexicon &lex);
 
@@ -111,6 +145,9 @@ private:
 
     std::string escapeRegex( const std::string &str);
 
+    // copy the store into lex_ so it can be modified
+    void detach();
+
     struct lexcomp {
         bool operator() (const std::string &lhs, const std::string &rhs) const {
             return lhs<rhs;
@@ -123,6 +160,7 @@ private:
     InClass::Lang lang_;
     std::string locale_;
     std::map <std::string, std::vector<LexEntry>, lexcomp> lex_;
+    std::shared_ptr<const LexiconStore> store_;
     std::string regex_;
     std::string regexPrefix_;
     std::string regexSuffix_;
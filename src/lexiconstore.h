@@ -0,0 +1,45 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#ifndef LEXICONSTORE_H
+#define LEXICONSTORE_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "lexentry.h"
+
+/*
+ * LexiconStore is a read-only backend for the entries of a Lexicon.
+ * A Lexicon normally keeps its entries in a std::map that it owns, but
+ * it can instead be pointed at a store, for example one that reads a
+ * model image in place (see ModelFile). The store is shared between
+ * copies of the Lexicon and must be safe to read from several threads.
+ */
+class LexiconStore
+{
+public:
+    virtual ~LexiconStore() {};
+
+    // append the entries for key to entries, returns false if not found
+    virtual bool find( const std::string &key, std::vector<LexEntry> &entries ) const = 0;
+
+    // the number of distinct keys
+    virtual long unsigned int size() const = 0;
+
+    // call fn for every key and its entries in ascending key order
+    virtual void forEach( const std::function<void(const std::string&, const std::vector<LexEntry>&)> &fn ) const = 0;
+};
+
+#endif
@@ -11,40 +11,15 @@
  *
  ***************************************************ADDRESS_STANDARDIZER**/
 
-#include <boost/regex.hpp>
-#include <boost/regex/icu.hpp>
 #include "metarule.h"
 
 
-MetaRule::MetaRule( const std::string &line ) {
-    std::string token;
-    std::stringstream buffer(line);
-
-    auto re_meta = boost::make_u32regex( "@([\\w_]+)" );
-    boost::smatch what;
-
-    std::string::const_iterator start, end;
-    start = line.begin();
-    end   = line.end();
-
-    while ( boost::u32regex_search( start, end, what, re_meta ) ) {
-        if (what[1].first < what[1].second)
-            refs_.push_back( SectionPtr( std::string( what[1].first, what[1].second ) ) );
-        start = what[0].second;
-    }
-}
-
-
-
-std::ostream &operator<<(std::ostream &ss, const MetaRule &r) {
+void MetaRule::print( std::ostream &ss, const SectionNames &names ) const {
     bool first = true;
-    for ( auto e = r.begin(); e != r.end(); e++ ) {
+    for ( const auto &ref : refs_ ) {
         if (not first)
             ss << " ";
-        ss << "@" << e->name();
+        ss << "@" << names.name( ref );
         first = false;
     }
-
-    return ss;
 }
-
@@ -32,14 +32,14 @@ class MetaRule {
 
 public:
     MetaRule() {};
-    explicit MetaRule( const std::string &line );
     long unsigned int size() const { return refs_.size(); };
-    std::vector<SectionPtr> refs() const { return refs_; };
+    const std::vector<SectionPtr> &refs() const { return refs_; };
 
     void refs( const std::vector<SectionPtr> &refs ) { refs_ = refs; };
-    void push_back( SectionPtr &ptr ) { refs_.push_back( ptr ); };
+    void push_back( const SectionPtr &ptr ) { refs_.push_back( ptr ); };
 
-    friend std::ostream &operator<<(std::ostream &ss, const MetaRule &r);
+    // write the rule as "@name @name ..." with the names of the grammar
+    void print( std::ostream &ss, const SectionNames &names ) const;
 
     // iterator access to refs_
 
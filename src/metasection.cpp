@@ -21,9 +21,10 @@ MetaRule MetaSection::rule( long unsigned int index ) const {
 }
 
 
-std::ostream &operator<<(std::ostream &ss, const MetaSection &e) {
-    ss << "[" << e.name() << "]\n";
-    for ( auto r = e.begin(); r != e.end(); ++r )
-        ss << *r << "\n";
-    return ss;
+void MetaSection::print( std::ostream &ss, const SectionNames &names ) const {
+    ss << "[" << name_ << "]\n";
+    for ( const auto &r : rules_ ) {
+        r.print( ss, names );
+        ss << "\n";
+    }
 }
@@ -38,7 +38,7 @@ public:
 public:
     MetaSection() {};
     explicit MetaSection( const std::string &name ) : name_(name) {};
-    std::string name() const { return name_; };
+    const std::string &name() const { return name_; };
     long unsigned int size() const { return rules_.size(); };
     MetaRule rule( long unsigned int index ) const;
     std::vector<MetaRule> rules() const { return rules_; };
@@ -47,7 +47,8 @@ public:
     void rules( const std::vector<MetaRule> &rules ) { rules_ = rules; };
     void push_back( MetaRule &m ) { rules_.push_back( m ); };
 
-    friend std::ostream &operator<<(std::ostream &ss, const MetaSection &ms);
+    // write the section in the grammar file format
+    void print( std::ostream &ss, const SectionNames &names ) const;
 
     // iterator access to rules_
 
@@ -0,0 +1,520 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "modelfile.h"
+
+
+namespace {
+
+const char MAGIC[8] = { 'A', 'S', 'M', 'O', 'D', 'E', 'L', '\0' };
+const uint32_t ENDIAN_MARK = 0x01020304;
+const long unsigned int ALIGN = 8;
+
+// the on disk structures, all offsets are relative to the image or
+// to the STRINGS section and every field has a fixed size
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t size;
+    uint32_t nsections;
+    uint32_t reserved;
+};
+
+struct DirEntry {
+    uint32_t id;
+    uint32_t count;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct LexInfo {
+    uint32_t name;
+    uint32_t locale;
+    uint32_t md5;
+    uint32_t regex;
+    uint32_t regexPrefix;
+    uint32_t regexSuffix;
+    int32_t lang;
+    uint32_t reserved;
+};
+
+struct KeyRec {
+    uint32_t key;
+    uint32_t length;
+    uint32_t first;
+    uint32_t count;
+};
+
+struct EntryRec {
+    uint32_t word;
+    uint32_t stdword;
+    uint64_t types;         // bit n set for InClass::Type n
+    uint32_t attached;      // bit n set for InClass::AttachType n
+    uint32_t reserved;
+};
+
+struct GmrInfo {
+    uint32_t md5;
+    float maxScore;
+};
+
+static_assert( sizeof(Header) == 32, "ModelFile Header layout" );
+static_assert( sizeof(DirEntry) == 24, "ModelFile DirEntry layout" );
+static_assert( sizeof(LexInfo) == 32, "ModelFile LexInfo layout" );
+static_assert( sizeof(KeyRec) == 16, "ModelFile KeyRec layout" );
+static_assert( sizeof(EntryRec) == 24, "ModelFile EntryRec layout" );
+static_assert( sizeof(CompiledGrammar::Section) == 16, "ModelFile Section layout" );
+static_assert( sizeof(CompiledGrammar::Span) == 8, "ModelFile Span layout" );
+static_assert( sizeof(CompiledGrammar::RuleDef) == 12, "ModelFile RuleDef layout" );
+
+
+void corrupt( const std::string &what ) {
+    throw std::runtime_error( "ModelFile-Corrupt: " + what );
+}
+
+
+// a read-only mapping of a whole file, unmapped with the last reference
+class Mapping {
+public:
+    explicit Mapping( const std::string &file ) : addr_( NULL ), size_( 0 ) {
+        int fd = open( file.c_str(), O_RDONLY );
+        if ( fd < 0 )
+            throw std::runtime_error( "ModelFile-Open-Failed: " + file );
+        struct stat st;
+        if ( fstat( fd, &st ) != 0 or st.st_size <= 0 ) {
+            close( fd );
+            throw std::runtime_error( "ModelFile-Open-Failed: " + file );
+        }
+        size_ = static_cast<long unsigned int>( st.st_size );
+        addr_ = mmap( NULL, size_, PROT_READ, MAP_SHARED, fd, 0 );
+        close( fd );
+        if ( addr_ == MAP_FAILED ) {
+            addr_ = NULL;
+            throw std::runtime_error( "ModelFile-Map-Failed: " + file );
+        }
+    };
+    ~Mapping() {
+        if ( addr_ )
+            munmap( addr_, size_ );
+    };
+
+    const void *data() const { return addr_; };
+    long unsigned int size() const { return size_; };
+
+private:
+    void *addr_;
+    long unsigned int size_;
+};
+
+
+// the lexicon entries read in place from the image
+class ImageLexiconStore : public LexiconStore {
+public:
+    ImageLexiconStore( const char *strings, uint32_t nstrings,
+                       const KeyRec *keys, uint32_t nkeys,
+                       const EntryRec *entries, uint32_t nentries,
+                       std::shared_ptr<const void> owner )
+        : strings_( strings ), nstrings_( nstrings ), keys_( keys ), nkeys_( nkeys ),
+          entries_( entries ), nentries_( nentries ), owner_( owner )
+    {
+        for ( uint32_t i = 0; i < nkeys_; ++i ) {
+            const KeyRec &k = keys_[i];
+            if ( k.key >= nstrings_ or k.length > nstrings_ - k.key
+                    or k.first > nentries_ or k.count > nentries_ - k.first )
+                corrupt( "LEX_KEYS" );
+            if ( i > 0 and compare( keys_[i - 1], strings_ + k.key, k.length ) >= 0 )
+                corrupt( "LEX_KEYS order" );
+        }
+        for ( uint32_t i = 0; i < nentries_; ++i )
+            if ( entries_[i].word >= nstrings_ or entries_[i].stdword >= nstrings_ )
+                corrupt( "LEX_ENTRIES" );
+    };
+
+    bool find( const std::string &key, std::vector<LexEntry> &entries ) const {
+        const KeyRec *last = keys_ + nkeys_;
+        const KeyRec *it = std::lower_bound( keys_, last, key,
+            [this]( const KeyRec &k, const std::string &s ) {
+                return compare( k, s.data(), s.size() ) < 0;
+            } );
+        if ( it == last or compare( *it, key.data(), key.size() ) != 0 )
+            return false;
+        append( *it, entries );
+        return true;
+    };
+
+    long unsigned int size() const { return nkeys_; };
+
+    void forEach( const std::function<void(const std::string&, const std::vector<LexEntry>&)> &fn ) const {
+        std::vector<LexEntry> entries;
+        for ( uint32_t i = 0; i < nkeys_; ++i ) {
+            entries.clear();
+            append( keys_[i], entries );
+            fn( std::string( strings_ + keys_[i].key, keys_[i].length ), entries );
+        }
+    };
+
+private:
+    // the same order as std::string::compare()
+    int compare( const KeyRec &k, const char *s, long unsigned int len ) const {
+        int c = std::memcmp( strings_ + k.key, s, std::min<long unsigned int>( k.length, len ) );
+        if ( c != 0 )
+            return c;
+        return k.length < len ? -1 : ( k.length > len ? 1 : 0 );
+    };
+
+    void append( const KeyRec &k, std::vector<LexEntry> &entries ) const {
+        for ( uint32_t i = k.first; i < k.first + k.count; ++i ) {
+            const EntryRec &e = entries_[i];
+            LexEntry le;
+            le.word( strings_ + e.word );
+            le.stdword( strings_ + e.stdword );
+            std::set<InClass::Type> types;
+            for ( int t = 0; t < 64; ++t )
+                if ( e.types & ( 1ULL << t ) )
+                    types.insert( static_cast<InClass::Type>( t ) );
+            le.type( types );
+            std::set<InClass::AttachType> attached;
+            for ( int a = 0; a < 32; ++a )
+                if ( e.attached & ( 1U << a ) )
+                    attached.insert( static_cast<InClass::AttachType>( a ) );
+            le.attached( attached );
+            entries.push_back( le );
+        }
+    };
+
+    const char *strings_;
+    uint32_t nstrings_;
+    const KeyRec *keys_;
+    uint32_t nkeys_;
+    const EntryRec *entries_;
+    uint32_t nentries_;
+    std::shared_ptr<const void> owner_;
+};
+
+
+// collects NUL terminated strings, each distinct string is stored once
+class StringTable {
+public:
+    uint32_t add( const std::string &str ) {
+        auto it = index_.find( str );
+        if ( it != index_.end() )
+            return it->second;
+        if ( data_.size() + str.size() + 1 > 0xffffffffUL )
+            throw std::runtime_error( "ModelFile-Too-Large" );
+        uint32_t offset = static_cast<uint32_t>( data_.size() );
+        data_.append( str );
+        data_.push_back( '\0' );
+        index_[str] = offset;
+        return offset;
+    };
+    const std::string &data() const { return data_; };
+
+private:
+    std::string data_;
+    std::unordered_map<std::string, uint32_t> index_;
+};
+
+
+struct Block {
+    uint32_t id;
+    uint32_t count;
+    std::string bytes;
+};
+
+
+template <typename T>
+Block block( uint32_t id, const T *items, long unsigned int count ) {
+    Block b;
+    b.id = id;
+    b.count = static_cast<uint32_t>( count );
+    if ( count > 0 )
+        b.bytes.assign( reinterpret_cast<const char *>( items ), count * sizeof(T) );
+    return b;
+}
+
+
+uint32_t checked32( long unsigned int n ) {
+    if ( n > 0xffffffffUL )
+        throw std::runtime_error( "ModelFile-Too-Large" );
+    return static_cast<uint32_t>( n );
+}
+
+}   // namespace
+
+
+ModelFile::ModelFile( const std::string &file ) : data_( NULL ), size_( 0 ) {
+    std::shared_ptr<Mapping> mapping( new Mapping( file ) );
+    attach( mapping->data(), mapping->size(), mapping );
+}
+
+
+ModelFile::ModelFile( const void *data, long unsigned int size, bool copyImage ) : data_( NULL ), size_( 0 ) {
+    if ( not copyImage and reinterpret_cast<uintptr_t>( data ) % ALIGN == 0 ) {
+        attach( data, size, std::shared_ptr<const void>() );
+        return;
+    }
+
+    // the sections need aligned access so take an aligned copy
+    std::shared_ptr<std::vector<uint64_t> > copy(
+        new std::vector<uint64_t>( ( size + ALIGN - 1 ) / ALIGN ) );
+    if ( size > 0 )
+        std::memcpy( copy->data(), data, size );
+    attach( copy->data(), size, copy );
+}
+
+
+void ModelFile::attach( const void *data, long unsigned int size, std::shared_ptr<const void> owner ) {
+    const char *base = static_cast<const char *>( data );
+
+    if ( size < sizeof(Header) )
+        corrupt( "short header" );
+    const Header &h = *reinterpret_cast<const Header *>( base );
+    if ( std::memcmp( h.magic, MAGIC, sizeof(MAGIC) ) != 0 )
+        throw std::runtime_error( "ModelFile-Not-A-Model" );
+    if ( h.byteOrder != ENDIAN_MARK )
+        throw std::runtime_error( "ModelFile-Wrong-Byte-Order" );
+    if ( h.version != MODELFILE_VERSION )
+        throw std::runtime_error( "ModelFile-Unsupported-Version: " + std::to_string( h.version ) );
+    if ( h.size != size )
+        corrupt( "size" );
+    if ( h.nsections > ( size - sizeof(Header) ) / sizeof(DirEntry) )
+        corrupt( "directory" );
+
+    // locate every section and check it lies inside the image
+    const DirEntry *dir = reinterpret_cast<const DirEntry *>( base + sizeof(Header) );
+    const DirEntry *sections[GMR_BYNAME + 1] = { NULL };
+    for ( uint32_t i = 0; i < h.nsections; ++i ) {
+        const DirEntry &d = dir[i];
+        if ( d.offset % ALIGN != 0 or d.offset > size or d.size > size - d.offset )
+            corrupt( "section bounds" );
+        if ( d.id >= STRINGS and d.id <= GMR_BYNAME )
+            sections[d.id] = &d;
+    }
+
+    // find a section and check it holds count items of type T
+    auto section = [&]( uint32_t id, long unsigned int itemSize ) -> const DirEntry & {
+        if ( sections[id] == NULL )
+            corrupt( "missing section " + std::to_string( id ) );
+        if ( sections[id]->size != sections[id]->count * itemSize )
+            corrupt( "section size " + std::to_string( id ) );
+        return *sections[id];
+    };
+
+    const DirEntry &strs = section( STRINGS, 1 );
+    const char *strings = base + strs.offset;
+    if ( strs.count > 0 and strings[strs.count - 1] != '\0' )
+        corrupt( "STRINGS" );
+    auto str = [&]( uint32_t offset ) -> std::string {
+        if ( offset >= strs.count )
+            corrupt( "string offset" );
+        return std::string( strings + offset );
+    };
+
+    // the lexicon
+    const DirEntry &li = section( LEX_INFO, sizeof(LexInfo) );
+    if ( li.count != 1 )
+        corrupt( "LEX_INFO" );
+    const LexInfo &info = *reinterpret_cast<const LexInfo *>( base + li.offset );
+    const DirEntry &keys = section( LEX_KEYS, sizeof(KeyRec) );
+    const DirEntry &entries = section( LEX_ENTRIES, sizeof(EntryRec) );
+
+    std::shared_ptr<const LexiconStore> store( new ImageLexiconStore(
+        strings, strs.count,
+        reinterpret_cast<const KeyRec *>( base + keys.offset ), keys.count,
+        reinterpret_cast<const EntryRec *>( base + entries.offset ), entries.count,
+        owner ) );
+    lexicon_ = Lexicon( store, str( info.name ), static_cast<InClass::Lang>( info.lang ),
+                        str( info.locale ), str( info.md5 ),
+                        str( info.regex ), str( info.regexPrefix ), str( info.regexSuffix ) );
+
+    data_ = data;
+    size_ = size;
+
+    // the grammar, which a lexicon only image does not have
+    program_.reset();
+    grammarMd5_.clear();
+    if ( sections[GMR_INFO] == NULL )
+        return;
+
+    const DirEntry &gi = section( GMR_INFO, sizeof(GmrInfo) );
+    if ( gi.count != 1 )
+        corrupt( "GMR_INFO" );
+    const GmrInfo &ginfo = *reinterpret_cast<const GmrInfo *>( base + gi.offset );
+    grammarMd5_ = str( ginfo.md5 );
+
+    const DirEntry &gs = section( GMR_SECTIONS, sizeof(CompiledGrammar::Section) );
+    const DirEntry &ga = section( GMR_ALTS, sizeof(CompiledGrammar::Span) );
+    const DirEntry &gr = section( GMR_REFS, sizeof(CompiledGrammar::Index) );
+    const DirEntry &gd = section( GMR_RULES, sizeof(CompiledGrammar::RuleDef) );
+    const DirEntry &gin = section( GMR_IN, sizeof(CompiledGrammar::Class) );
+    const DirEntry &gout = section( GMR_OUT, sizeof(CompiledGrammar::Class) );
+    const DirEntry &gn = section( GMR_NAMES, 1 );
+    const DirEntry &gb = section( GMR_BYNAME, sizeof(CompiledGrammar::Index) );
+    if ( gin.count != gout.count or gb.count != gs.count )
+        corrupt( "grammar" );
+
+    CompiledGrammar::Image image;
+    image.sections  = reinterpret_cast<const CompiledGrammar::Section *>( base + gs.offset );
+    image.nsections = gs.count;
+    image.alts      = reinterpret_cast<const CompiledGrammar::Span *>( base + ga.offset );
+    image.nalts     = ga.count;
+    image.refs      = reinterpret_cast<const CompiledGrammar::Index *>( base + gr.offset );
+    image.nrefs     = gr.count;
+    image.rules     = reinterpret_cast<const CompiledGrammar::RuleDef *>( base + gd.offset );
+    image.nrules    = gd.count;
+    image.in        = reinterpret_cast<const CompiledGrammar::Class *>( base + gin.offset );
+    image.out       = reinterpret_cast<const CompiledGrammar::Class *>( base + gout.offset );
+    image.nclasses  = gin.count;
+    image.names     = base + gn.offset;
+    image.nnames    = gn.count;
+    image.byName    = reinterpret_cast<const CompiledGrammar::Index *>( base + gb.offset );
+    image.maxScore  = ginfo.maxScore;
+    program_ = std::shared_ptr<const CompiledGrammar>( new CompiledGrammar( image, owner ) );
+}
+
+
+void ModelFile::write( std::ostream &os, Lexicon &lex, const Grammar &G ) {
+    writeImage( os, lex, &G );
+}
+
+
+void ModelFile::write( std::ostream &os, Lexicon &lex ) {
+    writeImage( os, lex, NULL );
+}
+
+
+void ModelFile::writeImage( std::ostream &os, Lexicon &lex, const Grammar *G ) {
+    StringTable strings;
+    std::vector<Block> blocks;
+
+    // the lexicon
+    LexInfo info;
+    std::memset( &info, 0, sizeof(info) );
+    info.name        = strings.add( lex.name() );
+    info.locale      = strings.add( lex.locale() );
+    info.md5         = strings.add( lex.getMd5() );
+    info.regex       = strings.add( lex.regex() );
+    info.regexPrefix = strings.add( lex.regexPrefixAtt() );
+    info.regexSuffix = strings.add( lex.regexSuffixAtt() );
+    info.lang        = static_cast<int32_t>( lex.lang() );
+
+    std::vector<KeyRec> keys;
+    std::vector<EntryRec> entries;
+    lex.forEach( [&]( const std::string &key, const std::vector<LexEntry> &les ) {
+        KeyRec k;
+        k.key    = strings.add( key );
+        k.length = checked32( key.size() );
+        k.first  = checked32( entries.size() );
+        k.count  = checked32( les.size() );
+        keys.push_back( k );
+        for ( const auto &le : les ) {
+            EntryRec e;
+            std::memset( &e, 0, sizeof(e) );
+            e.word    = strings.add( le.word() );
+            e.stdword = strings.add( le.stdword() );
+            for ( const auto &t : le.type() ) {
+                if ( t < 0 or t >= 64 )
+                    throw std::runtime_error( "ModelFile-Unsupported-InClass: " + InClass::asString( t ) );
+                e.types |= 1ULL << t;
+            }
+            for ( const auto &a : le.attached() )
+                e.attached |= 1U << a;
+            entries.push_back( e );
+        }
+    } );
+
+    blocks.push_back( block( LEX_INFO, &info, 1 ) );
+    blocks.push_back( block( LEX_KEYS, keys.data(), keys.size() ) );
+    blocks.push_back( block( LEX_ENTRIES, entries.data(), entries.size() ) );
+
+    // the grammar
+    if ( G != NULL ) {
+        auto program = G->program();
+        const CompiledGrammar::Image &im = program->image();
+
+        GmrInfo ginfo;
+        ginfo.md5 = strings.add( G->getMd5() );
+        ginfo.maxScore = im.maxScore;
+
+        blocks.push_back( block( GMR_INFO, &ginfo, 1 ) );
+        blocks.push_back( block( GMR_SECTIONS, im.sections, im.nsections ) );
+        blocks.push_back( block( GMR_ALTS, im.alts, im.nalts ) );
+        blocks.push_back( block( GMR_REFS, im.refs, im.nrefs ) );
+        blocks.push_back( block( GMR_RULES, im.rules, im.nrules ) );
+        blocks.push_back( block( GMR_IN, im.in, im.nclasses ) );
+        blocks.push_back( block( GMR_OUT, im.out, im.nclasses ) );
+        blocks.push_back( block( GMR_NAMES, im.names, im.nnames ) );
+        blocks.push_back( block( GMR_BYNAME, im.byName, im.nsections ) );
+    }
+
+    // the strings go last because everything above adds to them
+    blocks.push_back( block( STRINGS, strings.data().data(), strings.data().size() ) );
+
+    // lay the sections out after the header and directory
+    std::vector<DirEntry> dir;
+    long unsigned int offset = sizeof(Header) + blocks.size() * sizeof(DirEntry);
+    for ( const auto &b : blocks ) {
+        offset = ( offset + ALIGN - 1 ) / ALIGN * ALIGN;
+        DirEntry d;
+        d.id     = b.id;
+        d.count  = b.count;
+        d.offset = offset;
+        d.size   = b.bytes.size();
+        dir.push_back( d );
+        offset += b.bytes.size();
+    }
+
+    Header h;
+    std::memset( &h, 0, sizeof(h) );
+    std::memcpy( h.magic, MAGIC, sizeof(MAGIC) );
+    h.version   = MODELFILE_VERSION;
+    h.byteOrder = ENDIAN_MARK;
+    h.size      = offset;
+    h.nsections = checked32( blocks.size() );
+
+    std::string out;
+    out.reserve( offset );
+    out.append( reinterpret_cast<const char *>( &h ), sizeof(h) );
+    out.append( reinterpret_cast<const char *>( dir.data() ), dir.size() * sizeof(DirEntry) );
+    for ( long unsigned int i = 0; i < blocks.size(); ++i ) {
+        out.resize( dir[i].offset, '\0' );
+        out.append( blocks[i].bytes );
+    }
+
+    os.write( out.data(), static_cast<std::streamsize>( out.size() ) );
+}
+
+
+void ModelFile::write( const std::string &file, Lexicon &lex, const Grammar &G ) {
+    std::ofstream ofs( file.c_str(), std::ofstream::out | std::ofstream::trunc
+        | std::ofstream::binary );
+    if ( not ofs.good() )
+        throw std::runtime_error( "ModelFile-Write-Failed: " + file );
+    write( ofs, lex, G );
+    ofs.close();
+    if ( ofs.fail() )
+        throw std::runtime_error( "ModelFile-Write-Failed: " + file );
+}
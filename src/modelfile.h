@@ -0,0 +1,119 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#ifndef MODELFILE_H
+#define MODELFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <iostream>
+
+#include "lexicon.h"
+#include "grammar.h"
+#include "compiledgrammar.h"
+
+#define MODELFILE_VERSION 1
+
+/*
+ * ModelFile is a binary image of a compiled lexicon and grammar that is
+ * used in place, without deserializing it. The file is mmap()ed read-only
+ * so every process using the same file shares one copy of it through
+ * the page cache and opening it costs little more than the system call.
+ *
+ * The image only holds offsets relative to its own start, never
+ * pointers, so it can be mapped at any address. It is laid out as
+ *
+ *   Header        magic, version, byte order, total size, section count
+ *   Directory     one entry per section: id, count, offset, size
+ *   Sections      each starts on an 8 byte boundary
+ *
+ *   STRINGS       NUL terminated strings referred to by offset
+ *   LEX_INFO      name, lang, locale, md5 and the three regex strings
+ *   LEX_KEYS      distinct keys in ascending byte order, each with its
+ *                 [first, first+count) range into LEX_ENTRIES
+ *   LEX_ENTRIES   word, stdword, inclass bitmask and attach bitmask
+ *   GMR_INFO      grammar md5 and the highest rule score
+ *   GMR_*         the flat arrays of a CompiledGrammar
+ *
+ * The GMR_* sections are left out of a lexicon only image, which is
+ * how a compiled lexicon is stored on its own (see as_compile_lexicon_binary).
+ *
+ * The byte order and version must match the reader, a model is
+ * rebuilt with compile-model when the format changes.
+ */
+class ModelFile
+{
+public:
+
+    typedef enum {
+        STRINGS         = 1,
+        LEX_INFO        = 2,
+        LEX_KEYS        = 3,
+        LEX_ENTRIES     = 4,
+        GMR_INFO        = 5,
+        GMR_SECTIONS    = 6,
+        GMR_ALTS        = 7,
+        GMR_REFS        = 8,
+        GMR_RULES       = 9,
+        GMR_IN          = 10,
+        GMR_OUT         = 11,
+        GMR_NAMES       = 12,
+        GMR_BYNAME      = 13
+    } SectionId;
+
+    // map a model file read-only
+    explicit ModelFile( const std::string &file );
+
+    // use an image that is already in memory, it is used in place when
+    // it is suitably aligned and the caller keeps it alive for as long
+    // as this object and anything taken from it, otherwise or if
+    // copyImage is true it is copied
+    ModelFile( const void *data, long unsigned int size, bool copyImage = false );
+
+    ModelFile( const ModelFile& ) = delete;
+    ModelFile &operator=( const ModelFile& ) = delete;
+
+    // write the image of lex and G, lex is not const because its
+    // regex strings are generated if they have not been yet
+    static void write( std::ostream &os, Lexicon &lex, const Grammar &G );
+    static void write( const std::string &file, Lexicon &lex, const Grammar &G );
+
+    // write a lexicon only image, it has no program()
+    static void write( std::ostream &os, Lexicon &lex );
+
+    // the models, both are read-only views of the image
+    Lexicon &lexicon() { return lexicon_; };
+    std::shared_ptr<const CompiledGrammar> program() const { return program_; };
+    bool hasGrammar() const { return program_ != nullptr; };
+
+    const char *getLexiconMd5() { return lexicon_.getMd5(); };
+    const char *getGrammarMd5() const { return grammarMd5_.c_str(); };
+
+    const void *data() const { return data_; };
+    long unsigned int size() const { return size_; };
+
+private:
+
+    void attach( const void *data, long unsigned int size, std::shared_ptr<const void> owner );
+    static void writeImage( std::ostream &os, Lexicon &lex, const Grammar *G );
+
+    const void *data_;
+    long unsigned int size_;
+    Lexicon lexicon_;
+    std::shared_ptr<const CompiledGrammar> program_;
+    std::string grammarMd5_;
+
+};
+
+#endif
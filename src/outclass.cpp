@@ -43,39 +43,36 @@ std::string OutClass::asString(const OutClass::Type &t) {
 
 
 OutClass::Type OutClass::asType(const std::string &s) {
-    OutClass::Type t;
-    std::map<std::string, OutClass::Type> m;
-    std::map<std::string, OutClass::Type>::iterator it;
-
-    m["STOP"]      = STOP;
-    m["BLDNG"]     = BLDNG;
-    m["HOUSE"]     = HOUSE;
-    m["PREDIR"]    = PREDIR;
-    m["QUALIF"]    = QUALIF;
-    m["PRETYP"]    = PRETYP;
-    m["STREET"]    = STREET;
-    m["SUFTYP"]    = SUFTYP;
-    m["SUFDIR"]    = SUFDIR;
-    m["RR"]        = RR;
-    m["EXTRA"]     = EXTRA;
-    m["CITY"]      = CITY;
-    m["PROV"]      = PROV;
-    m["NATION"]    = NATION;
-    m["POSTAL"]    = POSTAL;
-    m["BOXH"]      = BOXH;
-    m["BOXT"]      = BOXT;
-    m["UNITH"]     = UNITH;
-    m["UNITT"]     = UNITT;
-    m["IGNORE"]    = IGNORE;
-    m["BADTOKEN"]  = BADTOKEN;
+    // built once, every rule of a grammar looks up its output classes here
+    static const std::map<std::string, OutClass::Type> m = {
+        { "STOP",      STOP },
+        { "BLDNG",     BLDNG },
+        { "HOUSE",     HOUSE },
+        { "PREDIR",    PREDIR },
+        { "QUALIF",    QUALIF },
+        { "PRETYP",    PRETYP },
+        { "STREET",    STREET },
+        { "SUFTYP",    SUFTYP },
+        { "SUFDIR",    SUFDIR },
+        { "RR",        RR },
+        { "EXTRA",     EXTRA },
+        { "CITY",      CITY },
+        { "PROV",      PROV },
+        { "NATION",    NATION },
+        { "POSTAL",    POSTAL },
+        { "BOXH",      BOXH },
+        { "BOXT",      BOXT },
+        { "UNITH",     UNITH },
+        { "UNITT",     UNITT },
+        { "IGNORE",    IGNORE },
+        { "BADTOKEN",  BADTOKEN }
+    };
 
-    it = m.find(s);
+    auto it = m.find(s);
     if (it == m.end())
-        t = BADTOKEN;
-    else
-        t = it->second;
+        return BADTOKEN;
 
-    return t;
+    return it->second;
 }
 
 
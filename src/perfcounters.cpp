@@ -0,0 +1,138 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "perfcounters.h"
+
+
+#ifdef __linux__
+
+namespace {
+
+struct EventDef {
+    uint32_t type;
+    uint64_t config;
+};
+
+const EventDef events[PerfCounters::EVENTS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+                          | ( PERF_COUNT_HW_CACHE_OP_READ << 8 )
+                          | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+};
+
+}
+
+
+PerfCounters::PerfCounters() {
+    for ( int e = 0; e < EVENTS; ++e ) {
+        struct perf_event_attr attr;
+        memset( &attr, 0, sizeof(attr) );
+        attr.size = sizeof(attr);
+        attr.type = events[e].type;
+        attr.config = events[e].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fd_[e] = static_cast<int>( syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 ) );
+    }
+}
+
+
+PerfCounters::~PerfCounters() {
+    for ( int e = 0; e < EVENTS; ++e )
+        if ( fd_[e] >= 0 )
+            close( fd_[e] );
+}
+
+
+void PerfCounters::read( Sample &s ) const {
+    for ( int e = 0; e < EVENTS; ++e ) {
+        s.value[e] = 0;
+        s.valid[e] = false;
+        if ( fd_[e] < 0 )
+            continue;
+        // the count, the time enabled and the time actually counting
+        uint64_t buf[3];
+        if ( ::read( fd_[e], buf, sizeof(buf) ) != static_cast<ssize_t>( sizeof(buf) ) or buf[2] == 0 )
+            continue;
+        if ( buf[2] < buf[1] )
+            s.value[e] = static_cast<uint64_t>( static_cast<double>( buf[0] )
+                                                * static_cast<double>( buf[1] ) / static_cast<double>( buf[2] ) );
+        else
+            s.value[e] = buf[0];
+        s.valid[e] = true;
+    }
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    for ( int e = 0; e < EVENTS; ++e )
+        fd_[e] = -1;
+}
+
+
+PerfCounters::~PerfCounters() {
+}
+
+
+void PerfCounters::read( Sample &s ) const {
+    for ( int e = 0; e < EVENTS; ++e ) {
+        s.value[e] = 0;
+        s.valid[e] = false;
+    }
+}
+
+#endif
+
+
+bool PerfCounters::any() const {
+    for ( int e = 0; e < EVENTS; ++e )
+        if ( fd_[e] >= 0 )
+            return true;
+    return false;
+}
+
+
+bool PerfCounters::delta( const Sample &start, const Sample &end, Event e, uint64_t &d ) {
+    if ( not start.valid[e] or not end.valid[e] or end.value[e] < start.value[e] )
+        return false;
+    d = end.value[e] - start.value[e];
+    return true;
+}
+
+
+PerfCounters &PerfCounters::thread() {
+    thread_local PerfCounters counters;
+    return counters;
+}
+
+
+std::string PerfCounters::asString( Event e ) {
+    static const char *names[] = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+    };
+    int i = static_cast<int>( e );
+    return ( i >= 0 and i < EVENTS ) ? names[i] : "unknown";
+}
@@ -0,0 +1,79 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+/*
+ * PerfCounters reads the hardware performance counters of the calling
+ * thread with perf_event_open(2), user space only.
+ *
+ * Each event is opened on its own so a host that lacks one, or a virtual
+ * machine or container that has none, still gets the others. An event
+ * that could not be opened reads as zero and available() is false for
+ * it, on anything but Linux none are. A read that fails also reads as
+ * zero and is flagged in the Sample. When more events are open than the
+ * PMU has counters the kernel time slices them and the values are scaled
+ * up to the full time, so they are estimates.
+ *
+ * Counting is per thread, thread() opens the counters of the calling
+ * thread the first time it is used and they are closed when it exits.
+ */
+class PerfCounters
+{
+public:
+
+    typedef enum {
+        CYCLES        = 0,
+        INSTRUCTIONS  = 1,
+        L1D_MISSES    = 2,  // L1 data cache read misses
+        LLC_MISSES    = 3,  // last level cache misses
+        BRANCH_MISSES = 4
+    } Event;
+    static const int EVENTS = 5;
+
+    struct Sample {
+        uint64_t value[EVENTS];
+        bool valid[EVENTS];     // the event was read
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters( const PerfCounters& ) = delete;
+    PerfCounters &operator=( const PerfCounters& ) = delete;
+
+    bool available( Event e ) const { return fd_[e] >= 0; };
+    bool any() const;
+
+    // the counts since the counters were opened
+    void read( Sample &s ) const;
+
+    // the count of e from start to end, false if either read failed or
+    // it went down, which scaled estimates can do
+    static bool delta( const Sample &start, const Sample &end, Event e, uint64_t &d );
+
+    // the counters of the calling thread
+    static PerfCounters &thread();
+
+    static std::string asString( Event e );
+
+private:
+    int fd_[EVENTS];
+
+};
+
+#endif
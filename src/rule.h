@@ -37,6 +37,10 @@ public:
     Rule( const Rule &rule ) = default;
     Rule() : score_(0.0) {};
     explicit Rule( const std::string &line );
+    Rule( const std::vector<InClass::Type> &in,
+          const std::vector<OutClass::Type> &out,
+          float score )
+        : inClass_( in ), outClass_( out ), score_( score ) {};
 
     // accessors
     std::vector<InClass::Type> in() const { return inClass_; };
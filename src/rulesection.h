@@ -36,7 +36,7 @@ class RuleSection {
 public:
     RuleSection() {};
     explicit RuleSection( const std::string &name ) : name_(name) {};
-    std::string name() const { return name_; };
+    const std::string &name() const { return name_; };
     long unsigned int size() const { return rules_.size(); };
     Rule rule( long unsigned int index ) const;
     std::vector<Rule> rules() const { return rules_; };
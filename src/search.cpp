@@ -11,9 +11,19 @@
  *
  ***************************************************ADDRESS_STANDARDIZER**/
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 #include "search.h"
+#include "tokenizer.h"
+#include "counter.h"
+#include "instrument.h"
+
+
+// meta and rule sections expanded by Search::match
+static Counter findMetas( "findMetas" );
+static Counter findRules( "findRules" );
 
 
 SearchPaths Search::search( const std::string &grammarNode, const std::vector<Token> &phrase ) {
@@ -29,28 +39,31 @@ SearchPaths Search::search( const std::string &grammarNode, const std::vector<To
     std::cout << "\n";
 #endif
 
-    // make a list of enumerated token patterns
-    std::vector< std::vector<InClass::Type> > list
-        = Token::enumerate( phrase );
+    auto root = program_->find( grammarNode );
+    if ( root == CompiledGrammar::NONE )
+        throw std::runtime_error( std::string("Search-Rule-Not-Found:")+grammarNode );
 
-    // seed the search for each pattern with an empty result
-    SearchPaths patterns;
-    for (const auto &e : list ) {
-        SearchPath pattern;
-        pattern.remaining = e;
-        patterns.push_back( pattern );
-    }
-
-    // do the search and return the results
-    // we need to check if we consumed all the tokens
-    // and toss out partial matches
     SearchPaths results;
-    auto grammarNodePtr = stringToSectionPtr( grammarNode );
-    SearchPaths matchs = match( grammarNodePtr, patterns, 0 );
-    for ( const auto match : matchs )
-        if ( match.remaining.size() == 0 )
-            results.push_back( match );
 
+    // make the patterns one at a time and search each one, so the
+    // deadline also bounds a phrase with a huge number of patterns.
+    // each pattern is taken from the budget before it is searched so
+    // phrases searched in parallel can not go over maxPatterns.
+    // match() tosses out partial matches that did not consume all the
+    // tokens. ENUMERATE is timed within SEARCH.
+    const long unsigned int total = Token::countPatterns( phrase );
+    Instrument::Timer timer( Instrument::SEARCH );
+    std::vector<InClass::Type> pattern;
+    long unsigned int searched = 0;
+    for ( ; searched < total; ++searched ) {
+        if ( budget_ and not ( budget_->checkDeadline() and budget_->takePattern() ) )
+            break;
+        Instrument::Timer enumerate( Instrument::ENUMERATE );
+        Token::pattern( phrase, searched, pattern );
+        enumerate.stop();
+        match( root, pattern, results );
+    }
+    Instrument::count( Instrument::PATTERNS, searched );
 
     return results;
 }
@@ -62,6 +75,7 @@ SearchPaths Search::search( const std::vector<Token> &phrase ) {
 
 
 bool Search::reclassTokens( std::vector<Token> &tokens, const SearchPath &result ) const {
+    Instrument::Timer timer( Instrument::RECLASS );
     auto rules = result.rules;
 
     // count the tokens in the rules and compare to tokens
@@ -94,69 +108,62 @@ bool Search::reclassTokens( std::vector<Token> &tokens, const SearchPath &result
 }
 
 
-std::vector<Token> Search::searchAndReclassBest( const std::vector<Token> &phrase, float &score, std::string &matched, float &nrules ) {
-    
-    SearchPaths results = search( phrase );
-    // if we failed to match against the grammar
-    // set score to -1.0 and return an empty result
-    if ( results.size() == 0 ) {
-        score = -1.0;
-        nrules = -1.0;
-        return std::vector<Token>();
+void SearchProfile::resize( const CompiledGrammar &cg ) {
+    if ( paths.size() < cg.sectionCount() ) {
+        paths.resize( cg.sectionCount(), 0 );
+        nanos.resize( cg.sectionCount(), 0 );
     }
-
-    // for each result compute the average score of the rules in the result
-    // and select the record with the best average score
-    int best = 0;
-    float bestScore = 0.0;
-    float bestNrules = -1.0;
-    int i = 0;
-    for ( const auto &result : results ) {
-        float sum = 0.0;
-        for ( const auto &rule : result.rules )
-            sum += rule.score();
-        sum /= static_cast<float>( result.rules.size() );
-        if (sum > bestScore) {
-            best = i;
-            bestScore = sum;
-            bestNrules = static_cast<float>( result.rules.size() );
+    for ( auto counts : { &alts, &rules } ) {
+        long unsigned int n = counts == &alts ? cg.image().nalts : cg.ruleCount();
+        if ( counts->tried.size() < n ) {
+            counts->tried.resize( n, 0 );
+            counts->matched.resize( n, 0 );
+            counts->wins.resize( n, 0 );
         }
-        ++i;
     }
+}
 
-    score = bestScore;
-    std::vector<Token> reclassed( phrase );
-    nrules = bestNrules;
-
-    if ( not reclassTokens( reclassed, results[best] ) )
-        score = -2.0;
-    else
-        matched = toString( reclassed );
 
-    return reclassed;
+std::vector<Token> Search::searchAndReclassBest( const std::vector<Token> &phrase, float &score, std::string &matched, float &nrules ) {
+    std::vector<Index> taken;
+    auto best = bestPhrase( phrase, score, matched, nrules, taken );
+    win( taken );
+    return best;
 }
 
 
 std::vector<Token> Search::searchAndReclassBest( const std::vector<std::vector<Token> > &phrases, float &score, std::string &matched, float &nrules ) {
-    
+
+    if ( pool_ and not profile_ and phrases.size() > 1 )
+        return parallelBest( phrases, score, matched, nrules );
+
     std::vector<Token> best;
     float bestScore = -1.;
     float bestNrules = -1.;
     std::string bestMatched;
+    std::vector<Index> bestTaken;
 
     for ( auto &phrase : phrases ) {
+        if ( budget_ and budget_->exceeded() )
+            break;
         float thisScore = -1.;
         float thisNrules = -1.;
         std::string thisMatched;
-        auto result = searchAndReclassBest( phrase, thisScore, thisMatched, thisNrules );
+        std::vector<Index> thisTaken;
+        auto result = bestPhrase( phrase, thisScore, thisMatched, thisNrules, thisTaken );
         if ( thisScore > bestScore ) {
             bestScore = thisScore;
             bestNrules = thisNrules;
             best = result;
             bestMatched = thisMatched;
+            bestTaken.swap( thisTaken );
         }
+        // later phrases can only tie so they would not be picked
+        if ( bestScore >= program_->maxScore() )
+            break;
     }
 
+    win( bestTaken );
     score = bestScore;
     matched = bestMatched;
     nrules = bestNrules;
@@ -164,33 +171,78 @@ std::vector<Token> Search::searchAndReclassBest( const std::vector<std::vector<T
 }
 
 
-MatchResults Search::searchAndReclassAll(const std::vector<std::vector<Token> > &phrases ) {
-    MatchResults patterns;
-    
-    SearchPaths allResults;
-    for ( const auto &phrase : phrases ) {
-        SearchPaths results = search( phrase );
-        if ( results.size() == 0 )
-            continue;
+std::vector<Token> Search::searchAndReclassBest( const std::vector<Token> &phrase, AltTokens &alts, float &score, std::string &matched, float &nrules ) {
+
+    if ( pool_ and not profile_ ) {
+        std::vector<std::vector<Token> > phrases;
+        phrases.push_back( phrase );
+        std::vector<Token> one;
+        while ( alts.next( one ) )
+            phrases.push_back( one );
+        return searchAndReclassBest( phrases, score, matched, nrules );
+    }
 
-        // for each result compute the average score of the rules in the result
-        for ( const auto &result : results ) {
-            double sum = 0.0;
-            for ( const auto &rule : result.rules )
-                sum += rule.score();
-            sum /= static_cast<double>( result.rules.size() );
+    std::vector<Token> best;
+    float bestScore = -1.;
+    float bestNrules = -1.;
+    std::string bestMatched;
+    std::vector<Index> bestTaken;
 
-            std::vector<Token> reclassed( phrase );
+    std::vector<Token> current( phrase );
+    do {
+        if ( budget_ and budget_->exceeded() )
+            break;
+        float thisScore = -1.;
+        float thisNrules = -1.;
+        std::string thisMatched;
+        std::vector<Index> thisTaken;
+        auto result = bestPhrase( current, thisScore, thisMatched, thisNrules, thisTaken );
+        if ( thisScore > bestScore ) {
+            bestScore = thisScore;
+            bestNrules = thisNrules;
+            best = result;
+            bestMatched = thisMatched;
+            bestTaken.swap( thisTaken );
+        }
+        // later phrases can only tie so they would not be picked
+        if ( bestScore >= program_->maxScore() )
+            break;
+    } while ( alts.next( current ) );
+
+    win( bestTaken );
+    score = bestScore;
+    matched = bestMatched;
+    nrules = bestNrules;
+    return best;
+}
 
-            if ( not reclassTokens( reclassed, result ) )
-                sum = -2.0;
 
-            MatchResult pattern;
-            pattern.matched = toString( reclassed );
-            pattern.score = sum;
-            pattern.nrules = static_cast<double>( result.rules.size() );
-            patterns.push_back( pattern );
+MatchResults Search::searchAndReclassAll(const std::vector<std::vector<Token> > &phrases ) {
+    MatchResults patterns;
 
+    if ( pool_ and not profile_ and phrases.size() > 1 ) {
+        // search each phrase on its own copy and keep the phrase order,
+        // the copies all charge the one budget
+        std::vector<MatchResults> found( phrases.size() );
+        Instrument::Address *address = Instrument::current();
+        pool_->parallelFor( phrases.size(), [&]( long unsigned int i ) {
+            Instrument::Attach attach( address );
+            if ( budget_ and budget_->exceeded() )
+                return;
+            Search s( *this );
+            s.pool_ = NULL;
+            s.reclassAll( phrases[i], found[i] );
+        } );
+        for ( long unsigned int i = 0; i < found.size(); ++i ) {
+            for ( const auto &p : found[i] )
+                patterns.push_back( p );
+        }
+    }
+    else {
+        for ( const auto &phrase : phrases ) {
+            if ( budget_ and budget_->exceeded() )
+                break;
+            reclassAll( phrase, patterns );
         }
     }
 
@@ -222,238 +274,317 @@ std::string Search::toString(const std::vector<Token> &result) const {
     return out;
 }
 
-SectionPtr Search::stringToSectionPtr( std::string str ) {
-    auto idx = sectionIndex_.find( str );
-    if ( idx != sectionIndex_.end() ) {
 
-        if ( idx->second < metas_.size() 
-             and str == metas_[idx->second].name() ) {
-            SectionPtr ptr( str );
-            ptr.mptr( & metas_[idx->second] );
-            return ptr;
-        }
-
-        if ( idx->second < rules_.size() 
-             and str == rules_[idx->second].name() ) {
-            SectionPtr ptr( str );
-            ptr.rptr( & rules_[idx->second] );
-            return ptr;
-        }
+// the best match of one phrase and the grammar items it took
+std::vector<Token> Search::bestPhrase( const std::vector<Token> &phrase, float &score, std::string &matched, float &nrules, std::vector<Index> &taken ) {
 
+    SearchPaths results = search( phrase );
+    // if we failed to match against the grammar
+    // set score to -1.0 and return an empty result
+    if ( results.size() == 0 ) {
+        score = -1.0;
+        nrules = -1.0;
+        return std::vector<Token>();
     }
-    throw std::runtime_error( std::string("Search-Rule-Not-Found:")+str );
-}
 
-
-SearchPaths Search::match( const SectionPtr &sectionPtr, const SearchPaths &paths, const unsigned long int level ) const {
-#ifdef TRACING_SEARCH
-    std::cout << level << ": Search::match1('" << sectionPtr.name() << "'[";
-    for (const auto &t_p : paths ) {
-        std::cout << "{";
-        for (const auto &t_e : t_p.remaining)
-            std::cout << InClass::asString(t_e) << " ";
-        std::cout << "}";
+    // for each result compute the average score of the rules in the result
+    // and select the record with the best average score
+    int best = 0;
+    float bestScore = 0.0;
+    float bestNrules = -1.0;
+    int i = 0;
+    for ( const auto &result : results ) {
+        float sum = 0.0;
+        for ( const auto &rule : result.rules )
+            sum += rule.score();
+        sum /= static_cast<float>( result.rules.size() );
+        if (sum > bestScore) {
+            best = i;
+            bestScore = sum;
+            bestNrules = static_cast<float>( result.rules.size() );
+        }
+        ++i;
     }
-    std::cout << "])\n";
-#endif
 
-    SearchPaths results;
-    for ( const auto &path : paths ) {
-        SearchPaths pathResults = match( sectionPtr, path, level );
-        for ( const auto result : pathResults )
-            results.push_back( result );
+    score = bestScore;
+    std::vector<Token> reclassed( phrase );
+    nrules = bestNrules;
+
+    if ( not reclassTokens( reclassed, results[best] ) )
+        score = -2.0;
+    else {
+        matched = toString( reclassed );
+        taken = results[best].taken;
     }
 
-#ifdef TRACING_SEARCH
-    std::cout << level <<": Returning: Search::match1(" << results.size() << ")\n";
-#endif
-    return results;
+    return reclassed;
 }
 
 
-SearchPaths Search::match( const SectionPtr &sectionPtr, const SearchPath &path, const unsigned long int level ) const {
-#ifdef TRACING_SEARCH
-    std::cout << level << ": Search::match2('" << sectionPtr.name()
-        << "'(" << sectionPtr.mptr() << ","
-        << sectionPtr.rptr() << ")" << "[";
-    for (const auto &t_e : path.remaining)
-        std::cout << InClass::asString(t_e) << " ";
-    std::cout << "])\n";
-#endif
-
-    // check for recursion limit
-    if ( level > recursion_limit_ ) {
-#ifdef TRACING_SEARCH
-        std::cout << level << ": Search::match2(0) hit recurssion limit! ###\n";
-#endif
-        return SearchPaths();
+// count the items of the best match as wins
+void Search::win( const std::vector<Index> &taken ) {
+    if ( not profile_ )
+        return;
+    for ( const auto t : taken ) {
+        if ( t & ALT )
+            ++profile_->alts.wins[t & ~ALT];
+        else
+            ++profile_->rules.wins[t];
     }
+}
 
-    auto meta = sectionPtr.mptr();
-    if ( meta != NULL ) {
-#ifdef TRACING_SEARCH
-        Utils::count("findMetas");
-#endif
-        SearchPaths results;
-        for ( auto r = meta->begin(); r != meta->end(); ++r ) {
-            SearchPath current( path );
-            current.next = r->refs();
-            for ( const auto &e : path.next )
-                current.next.push_back( e );
-
-            if ( current.next.size() > 0 ) {
-                auto mresults = matchNext( current, level );
-                for ( const auto &mr : mresults )
-                    results.push_back( mr );
-            }
+
+std::vector<Token> Search::parallelBest( const std::vector<std::vector<Token> > &phrases, float &score, std::string &matched, float &nrules ) {
+
+    struct Found {
+        float score;
+        float nrules;
+        std::string matched;
+        std::vector<Token> tokens;
+    };
+
+    const long unsigned int n = phrases.size();
+    std::vector<Found> found( n );
+
+    // the lowest index of a phrase that scored maxScore(), the
+    // phrases after it can only tie so they are cancelled
+    std::atomic<long unsigned int> first( n );
+
+    Instrument::Address *address = Instrument::current();
+    pool_->parallelFor( n, [&]( long unsigned int i ) {
+        Instrument::Attach attach( address );
+        found[i].score = -1.;
+        found[i].nrules = -1.;
+        if ( first.load() < i or ( budget_ and budget_->exceeded() ) )
+            return;
+
+        // the copy charges the one budget shared by all the phrases
+        Search s( *this );
+        s.pool_ = NULL;
+        s.cancel_ = &first;
+        s.cancelIndex_ = i;
+        found[i].tokens = s.searchAndReclassBest( phrases[i], found[i].score, found[i].matched, found[i].nrules );
+
+        if ( found[i].score >= program_->maxScore() ) {
+            long unsigned int f = first.load();
+            while ( i < f and not first.compare_exchange_weak( f, i ) )
+                ;
         }
-#ifdef TRACING_SEARCH
-        std::cout << level << ": Returning: Search::match2(" << results.size() << ")\n";
-#endif
-        return results;
-    }
+    } );
 
-    auto rule = sectionPtr.rptr();
-    if ( rule != NULL ) {
-#ifdef TRACING_SEARCH
-        Utils::count("findRules");
-#endif
-        SearchPaths results;
-        for ( auto r = rule->begin(); r != rule->end(); ++r ) {
-            auto mr = matchRule( *r, path );
-            if ( mr.rules.size() > 0 )
-                results.push_back( mr );
+    // pick the best the same way searching in order does, the first
+    // phrase with the highest score wins
+    const long unsigned int last = std::min( first.load() + 1, n );
+    long unsigned int best = n;
+    float bestScore = -1.;
+    for ( long unsigned int i = 0; i < last; ++i ) {
+        if ( found[i].score > bestScore ) {
+            bestScore = found[i].score;
+            best = i;
         }
-#ifdef TRACING_SEARCH
-        std::cout << level << ": Returning: Search::match2(" << results.size() << ")\n";
-#endif
-        return results;
     }
 
-#ifdef TRACING_SEARCH
-    std::cout << level << ": Returning: Search::match2(0) [RULE NOT FOUND]\n";
-#endif
-    return SearchPaths();
+    score = bestScore;
+    if ( best == n ) {
+        nrules = -1.;
+        matched.clear();
+        return std::vector<Token>();
+    }
+    matched = found[best].matched;
+    nrules = found[best].nrules;
+    return found[best].tokens;
 }
 
 
-SearchPaths Search::matchNext( const SearchPaths &paths, const unsigned long int level ) const {
-#ifdef TRACING_SEARCH
-    std::cout << level << ": Search::matchNext1(paths)\n";
-#endif
-    SearchPaths results;
-    for ( const auto &path : paths ) {
-        if ( path.next.size() > 0 ) {
-            SearchPaths matches = matchNext( path, level );
-            for ( const auto &match : matches )
-                results.push_back( match );
-        }
-    }
+void Search::reclassAll( const std::vector<Token> &phrase, MatchResults &patterns ) {
+    SearchPaths results = search( phrase );
 
-#ifdef TRACING_SEARCH
-    std::cout << level << ": Returning: Search::matchNext1(" << results.size() << ")\n";
-#endif
-    return results;
+    // for each result compute the average score of the rules in the result
+    for ( const auto &result : results ) {
+        double sum = 0.0;
+        for ( const auto &rule : result.rules )
+            sum += rule.score();
+        sum /= static_cast<double>( result.rules.size() );
+
+        std::vector<Token> reclassed( phrase );
+
+        if ( not reclassTokens( reclassed, result ) )
+            sum = -2.0;
+
+        MatchResult pattern;
+        pattern.matched = toString( reclassed );
+        pattern.score = sum;
+        pattern.nrules = static_cast<double>( result.rules.size() );
+        patterns.push_back( pattern );
+    }
 }
 
 
-SearchPaths Search::matchNext( const SearchPath &path, const unsigned long int level ) const {
+void Search::match( Index root, const std::vector<InClass::Type> &pattern, SearchPaths &results ) {
 #ifdef TRACING_SEARCH
-    std::cout << level << ": Search::matchNext2(path)\n";
-    std::cout << "\tNext:";
-    for (const auto &t_e : path.next )
-        std::cout << " " << t_e;
-    std::cout << "\n\tRemaining:";
-    for (const auto &t_e : path.remaining )
-        std::cout << " " << InClass::asString( t_e );
-    std::cout << "\n";
+    std::cout << "Search::match('" << program_->name( root ) << "'[";
+    for (const auto &t_e : pattern)
+        std::cout << InClass::asString(t_e) << " ";
+    std::cout << "])\n";
 #endif
 
-    // we should never call matchNext if there are no next items!
-    if ( path.next.size() == 0 ) {
+    const CompiledGrammar &cg = *program_;
+    const Index nil = CompiledGrammar::NONE;
+
+    pattern_.clear();
+    for ( const auto &e : pattern )
+        pattern_.push_back( static_cast<CompiledGrammar::Class>( e ) );
+    const unsigned int size = static_cast<unsigned int>( pattern_.size() );
+
+    cells_.clear();
+    stack_.clear();
+    if ( profile_ )
+        profile_->resize( cg );
+
+    State start;
+    start.next  = cons( root, nil );
+    start.trail = nil;
+    start.pos   = 0;
+    start.depth = 0;
+    stack_.push_back( start );
+    long unsigned int ticks = 0;
+    long unsigned int paths = 0;
+    long unsigned int tried = 0;
+    long unsigned int metas = 0;
+    long unsigned int rules = 0;
+
+    // this is a depth first walk of the grammar with an explicit stack
+    // branches are pushed in reverse so they are popped in grammar order
+    // and results come out in the same order as a recursive descent
+    while ( not stack_.empty() ) {
+        if ( budget_ and not ( budget_->chargeExpansion()
+                               and budget_->checkPaths( stack_.size() ) ) )
+            break;
+        if ( cancel_ and ( ++ticks & 0x3f ) == 0
+             and cancel_->load( std::memory_order_relaxed ) < cancelIndex_ )
+            break;
+
+        const State s = stack_.back();
+        stack_.pop_back();
+        ++paths;
+
+        // nothing left to match, keep it if all the tokens were consumed
+        if ( s.next == nil ) {
+            if ( s.pos == size )
+                results.push_back( makePath( s.trail ) );
+            continue;
+        }
+
+        // check for recursion limit
+        if ( s.depth > recursion_limit_ ) {
 #ifdef TRACING_SEARCH
-        std::cout << level << ": Returning: Search::matchNext2(0) NO INPUT\n";
+            std::cout << s.depth << ": Search::match hit recurssion limit! ###\n";
 #endif
-        return SearchPaths();
-    }
+            continue;
+        }
 
-    SearchPaths results;
-    SearchPath current( path );
-    auto sectionPtr = current.next.front();
-    current.next.erase( current.next.begin() );
+        const Index id   = cells_[s.next].item;
+        const Index rest = cells_[s.next].link;
+        if ( id == nil )
+            continue;
 
-    SearchPaths mr = match( sectionPtr, current, level+1 );
-    if ( mr.size() == 0 ) {
-#ifdef TRACING_SEARCH
-        std::cout << level << ": Returning: Search::matchNext2(0) for '" << sectionPtr.name() << "'\n";
-#endif
-        return SearchPaths();
-    }
+        const auto &section = cg.section( id );
+        std::chrono::steady_clock::time_point start;
+        if ( profile_ ) {
+            ++profile_->paths[id];
+            start = std::chrono::steady_clock::now();
+        }
 
-    for ( const auto &result : mr ) {
-        if ( result.next.size() > 0 ) {
-            SearchPaths nextResults = matchNext( mr, level );
-            for ( const auto &result : nextResults )
-                results.push_back( result );
+        if ( section.kind == CompiledGrammar::META ) {
+            ++metas;
+            for ( Index i = section.first + section.count; i-- > section.first; ) {
+                const auto &alt = cg.alt( i );
+                if ( alt.count == 0 and rest == nil )
+                    continue;
+
+                const Index *refs = cg.refs( alt );
+                Index next = rest;
+                for ( Index k = alt.count; k-- > 0; )
+                    next = cons( refs[k], next );
+
+                State branch;
+                branch.next  = next;
+                branch.trail = s.trail;
+                branch.pos   = s.pos;
+                branch.depth = s.depth + 1;
+                // the trail only needs the rules unless profiling
+                if ( profile_ ) {
+                    ++profile_->alts.tried[i];
+                    branch.trail = cons( i | ALT, s.trail );
+                }
+                stack_.push_back( branch );
+            }
         }
         else {
-            results.push_back( result );
+            ++rules;
+            for ( Index i = section.first + section.count; i-- > section.first; ) {
+                const auto &rd = cg.ruleDef( i );
+                ++tried;
+                if ( profile_ )
+                    ++profile_->rules.tried[i];
+                // rule has more items than what remains of the pattern
+                if ( rd.count > size - s.pos )
+                    continue;
+
+                const auto *in = cg.in( rd );
+                if ( not std::equal( in, in + rd.count, pattern_.begin() + s.pos ) )
+                    continue;
+
+                State branch;
+                branch.next  = rest;
+                branch.trail = cons( i, s.trail );
+                branch.pos   = s.pos + rd.count;
+                branch.depth = s.depth;
+                stack_.push_back( branch );
+            }
         }
+
+        if ( profile_ )
+            profile_->nanos[id] += static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start ).count() );
     }
 
+    Instrument::count( Instrument::PATHS, paths );
+    Instrument::count( Instrument::RULES, tried );
+    findMetas.add( metas );
+    findRules.add( rules );
+
 #ifdef TRACING_SEARCH
-    std::cout << level << ": Returning: Search::matchNext2(" << results.size() << ")\n";
+    std::cout << "Returning: Search::match(" << results.size() << ")\n";
 #endif
-    return results;
 }
 
 
-SearchPath Search::matchRule( const Rule &r, const SearchPath &path ) const {
-#ifdef TRACING_SEARCH
-    std::cout << "Search::matchRule\n";
-#endif
-    auto &pattern = path.remaining;
+Search::Index Search::cons( Index item, Index link ) {
+    Cell c;
+    c.item = item;
+    c.link = link;
+    cells_.push_back( c );
+    return static_cast<Index>( cells_.size() - 1 );
+}
 
-    if ( r.inSize() > pattern.size() ) {
-        // failed to match, rule has more items than pattern
-        // return an empty result
-#ifdef TRACING_SEARCH
-        std::cout << "\tReturning: Search::matchRule: Failed 1\n";
-#endif
-        return SearchPath();
-    }
 
-    // try to match the rule to the pattern
-    auto it = pattern.begin();
-    for ( long unsigned int pos = 0; pos < r.inSize(); ++pos ) {
-        if ( *it == r.in( pos ) )
-            it++;
-        else {
-            // failed to match
-#ifdef TRACING_SEARCH
-            std::cout << "\tReturning: Search::matchRule: Failed 2\n";
-#endif
-            return SearchPath();
+SearchPath Search::makePath( Index trail ) const {
+    SearchPath path;
+    for ( Index c = trail; c != CompiledGrammar::NONE; c = cells_[c].link ) {
+        const Index item = cells_[c].item;
+        if ( profile_ ) {
+            path.taken.push_back( item );
+            if ( item & ALT )
+                ++profile_->alts.matched[item & ~ALT];
+            else
+                ++profile_->rules.matched[item];
         }
+        if ( not ( item & ALT ) )
+            path.rules.push_back( program_->rule( item ) );
     }
-
-    // rule was matched, so return it
-    // and take what remains unmatched of pattern
-    // and copy it to remaining
-    SearchPath result( path );
-    result.rules.push_back(r);
-    result.remaining.clear();
-    for (;it!=pattern.end(); it++)
-        result.remaining.push_back(*it);
-
-#ifdef TRACING_SEARCH
-    std::cout << "\tReturning: Search::matchRule: rule[" << r << "], remaining:[";
-    for (const auto &t_e : result.remaining)
-        std::cout << InClass::asString(t_e) << " ";
-    std::cout << "]\n";
-#endif
-    return result;
+    std::reverse( path.rules.begin(), path.rules.end() );
+    return path;
 }
 
 
-
@@ -14,6 +14,8 @@
 #ifndef SEARCH_H
 #define SEARCH_H
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -24,12 +26,18 @@
 #include "utils.h"
 #include "sectionptr.h"
 #include "grammar.h"
+#include "compiledgrammar.h"
+#include "searchbudget.h"
+#include "threadpool.h"
+
+class AltTokens;
 
 class SearchPath {
 public:
     std::vector<Rule> rules;
-    std::vector<SectionPtr> next;
-    std::vector<InClass::Type> remaining;
+    // the meta alternatives and rules taken, only kept while profiling,
+    // see Search::ALT
+    std::vector<CompiledGrammar::Index> taken;
 };
 
 typedef std::vector<SearchPath> SearchPaths;
@@ -45,11 +53,57 @@ public:
 typedef std::vector<MatchResult> MatchResults;
 
 
-class Search : Grammar
+// the work of a search, see Search::profile(). Sections are indexed by
+// their CompiledGrammar id, meta alternatives by their alt() index and
+// rules by their ruleDef() index.
+class SearchProfile {
+public:
+    struct Counts {
+        std::vector<long unsigned int> tried;   // branched into or compared with a pattern
+        std::vector<long unsigned int> matched; // on a path that matched a whole pattern
+        std::vector<long unsigned int> wins;    // on the best match of a search
+    };
+
+    // make room for the grammar keeping what has been counted
+    void resize( const CompiledGrammar &cg );
+
+    std::vector<long unsigned int> paths;   // partial paths expanded at the section
+    std::vector<uint64_t> nanos;            // time spent expanding them
+    Counts alts;
+    Counts rules;
+};
+
+
+class Search
 {
 public:
 
-    Search( const Grammar &G ) : Grammar( G ), recursion_limit_(20) {};
+    Search( const Grammar &G ) : program_( G.program() ), budget_( NULL ), pool_( NULL ), profile_( NULL ), cancel_( NULL ), cancelIndex_( 0 ), recursion_limit_(20) {};
+    explicit Search( std::shared_ptr<const CompiledGrammar> program ) : program_( program ), budget_( NULL ), pool_( NULL ), profile_( NULL ), cancel_( NULL ), cancelIndex_( 0 ), recursion_limit_(20) {};
+
+    // limit the work done by the search, the caller owns the budget
+    // and must start() it, when it is exceeded the search stops and
+    // returns the results found so far
+    void budget( SearchBudget *budget ) { budget_ = budget; };
+    SearchBudget *budget() const { return budget_; };
+
+    // search the phrases of one address concurrently on the pool, the
+    // results are the same as searching them in order. NULL, the
+    // default, searches them in order on the calling thread. When a
+    // budget is set the phrases all charge it, so together they do no
+    // more work than in order, but which phrases were searched when a
+    // limit is hit can differ. maxPaths still bounds each stack.
+    void pool( ThreadPool *pool ) { pool_ = pool; };
+    ThreadPool *pool() const { return pool_; };
+
+    // add the work done to profile, the caller owns it. The pool is not
+    // used while a profile is set so it is only written by this thread.
+    // Profiling times every partial path, so it slows the search down.
+    void profile( SearchProfile *profile ) { profile_ = profile; };
+    SearchProfile *profile() const { return profile_; };
+
+    // marks a meta alternative in SearchPath::taken
+    static const CompiledGrammar::Index ALT = 0x80000000u;
 
     SearchPaths search( const std::vector<Token> &phrase );
 
@@ -61,17 +115,56 @@ public:
 
     std::vector<Token> searchAndReclassBest( const std::vector<std::vector<Token> > &phrases, float &cost, std::string &matched, float &nrules );
 
+    // search phrase and then its alternates as they are generated
+    // stopping once nothing left can score better
+    std::vector<Token> searchAndReclassBest( const std::vector<Token> &phrase, AltTokens &alts, float &cost, std::string &matched, float &nrules );
+
     MatchResults searchAndReclassAll( const std::vector<std::vector<Token> > &phrases );
 
 private:
 
+    typedef CompiledGrammar::Index Index;
+
+    // a cons cell in the search arena, the list of sections still
+    // to be matched and the trail of matched rules, and of the meta
+    // alternatives taken while profiling, are both chains
+    // of cells linked from the head back to CompiledGrammar::NONE
+    struct Cell {
+        Index item;
+        Index link;
+    };
+
+    // one pending branch of the search
+    struct State {
+        Index next;             // cell of the next section to match
+        Index trail;            // cell of the last rule matched
+        unsigned int pos;       // tokens of the pattern consumed so far
+        unsigned int depth;     // level the next section is matched at
+    };
+
     std::string toString( const std::vector<Token> &results ) const;
-    SectionPtr stringToSectionPtr( std::string str );
-    SearchPaths match( const SectionPtr &ptr, const SearchPaths &paths, const unsigned long int level ) const;
-    SearchPaths match( const SectionPtr &ptr, const SearchPath &path, const unsigned long int level ) const;
-    SearchPaths matchNext( const SearchPaths &paths, const unsigned long int level ) const;
-    SearchPaths matchNext( const SearchPath &path, const unsigned long int level ) const;
-    SearchPath matchRule( const Rule &r, const SearchPath &path ) const;
+    std::vector<Token> bestPhrase( const std::vector<Token> &phrase, float &cost, std::string &matched, float &nrules, std::vector<Index> &taken );
+    void win( const std::vector<Index> &taken );
+    std::vector<Token> parallelBest( const std::vector<std::vector<Token> > &phrases, float &cost, std::string &matched, float &nrules );
+    void reclassAll( const std::vector<Token> &phrase, MatchResults &patterns );
+    void match( Index root, const std::vector<InClass::Type> &pattern, SearchPaths &results );
+    Index cons( Index item, Index link );
+    SearchPath makePath( Index trail ) const;
+
+    std::shared_ptr<const CompiledGrammar> program_;
+    SearchBudget *budget_;
+    ThreadPool *pool_;
+    SearchProfile *profile_;
+
+    // set on the copies searching in parallel, stop once a phrase
+    // before this one has a score nothing else can beat
+    const std::atomic<long unsigned int> *cancel_;
+    long unsigned int cancelIndex_;
+
+    // scratch space reused across calls to match()
+    std::vector<Cell> cells_;
+    std::vector<State> stack_;
+    std::vector<CompiledGrammar::Class> pattern_;
 
 protected:
     unsigned long int recursion_limit_;
@@ -0,0 +1,92 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#include "searchbudget.h"
+
+
+SearchBudget::SearchBudget()
+    : maxPatterns_(0), maxPaths_(0), maxExpansions_(0), deadline_(0)
+{
+    start();
+}
+
+
+void SearchBudget::start() {
+    patterns_ = 0;
+    expansions_ = 0;
+    exceeded_ = NONE;
+    started_ = std::chrono::steady_clock::now();
+}
+
+
+long unsigned int SearchBudget::elapsed() const {
+    auto dt = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started_ );
+    return static_cast<long unsigned int>( dt.count() );
+}
+
+
+long unsigned int SearchBudget::patternsLeft() const {
+    long unsigned int n = patterns();
+    if ( maxPatterns_ == 0 )
+        return 0;
+    if ( n >= maxPatterns_ )
+        return 0;
+    return maxPatterns_ - n;
+}
+
+
+bool SearchBudget::chargePatterns( long unsigned int n ) {
+    long unsigned int total = patterns_.fetch_add( n, std::memory_order_relaxed ) + n;
+    if ( maxPatterns_ and total > maxPatterns_ )
+        exceed( PATTERNS );
+    return not exceeded();
+}
+
+
+bool SearchBudget::takePattern() {
+    long unsigned int n = patterns();
+    do {
+        if ( maxPatterns_ and n >= maxPatterns_ ) {
+            exceed( PATTERNS );
+            return false;
+        }
+    } while ( not patterns_.compare_exchange_weak( n, n + 1, std::memory_order_relaxed ) );
+    return true;
+}
+
+
+bool SearchBudget::checkPaths( long unsigned int n ) {
+    if ( maxPaths_ and n > maxPaths_ )
+        exceed( PATHS );
+    return not exceeded();
+}
+
+
+bool SearchBudget::checkDeadline() {
+    if ( deadline_ and elapsed() >= deadline_ )
+        exceed( DEADLINE );
+    return not exceeded();
+}
+
+
+std::string SearchBudget::asString( Limit limit ) {
+    switch ( limit ) {
+        case NONE:          return "NONE";
+        case PATTERNS:      return "PATTERNS";
+        case PATHS:         return "PATHS";
+        case EXPANSIONS:    return "EXPANSIONS";
+        case DEADLINE:      return "DEADLINE";
+    }
+    return "UNKNOWN";
+}
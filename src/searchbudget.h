@@ -0,0 +1,120 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#ifndef SEARCHBUDGET_H
+#define SEARCHBUDGET_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/*
+ * SearchBudget puts hard limits on the work done to standardize one
+ * address. A budget is started once per address and passed to
+ * Tokenizer::getAltTokens() and Search, which charge their work
+ * against it and stop as soon as any limit is exceeded. The search
+ * then returns the best result found so far and exceeded() is set.
+ *
+ * All limits default to zero which means unlimited. The counters are
+ * atomic so the phrases searched in parallel share one budget and
+ * together do no more work than searching them in order.
+ *
+ *   maxPatterns   - total class patterns enumerated over all phrases
+ *   maxPaths      - partial paths pending on the search stack at once
+ *   maxExpansions - grammar sections expanded over all patterns
+ *   deadline      - wall clock milliseconds since start()
+ */
+class SearchBudget
+{
+public:
+
+    typedef enum {
+        NONE        = 0,
+        PATTERNS    = 1,
+        PATHS       = 2,
+        EXPANSIONS  = 3,
+        DEADLINE    = 4
+    } Limit;
+
+    SearchBudget();
+
+    SearchBudget( const SearchBudget& ) = delete;
+    SearchBudget &operator=( const SearchBudget& ) = delete;
+
+    // limits, zero means unlimited
+    void maxPatterns( long unsigned int n ) { maxPatterns_ = n; };
+    void maxPaths( long unsigned int n ) { maxPaths_ = n; };
+    void maxExpansions( long unsigned int n ) { maxExpansions_ = n; };
+    void deadline( long unsigned int ms ) { deadline_ = ms; };
+
+    long unsigned int maxPatterns() const { return maxPatterns_; };
+    long unsigned int maxPaths() const { return maxPaths_; };
+    long unsigned int maxExpansions() const { return maxExpansions_; };
+    long unsigned int deadline() const { return deadline_; };
+
+    // reset the counters and the exceeded flag and start the clock
+    void start();
+
+    // work done so far
+    long unsigned int patterns() const { return patterns_.load( std::memory_order_relaxed ); };
+    long unsigned int expansions() const { return expansions_.load( std::memory_order_relaxed ); };
+    long unsigned int elapsed() const;
+
+    // how many more patterns may be enumerated when maxPatterns is set
+    long unsigned int patternsLeft() const;
+
+    // charge work against the budget, these return false once
+    // the budget is exceeded and the caller should stop
+    bool chargePatterns( long unsigned int n );
+    bool checkPaths( long unsigned int n );
+    inline bool chargeExpansion() {
+        long unsigned int n = expansions_.fetch_add( 1, std::memory_order_relaxed ) + 1;
+        if ( maxExpansions_ and n > maxExpansions_ )
+            exceed( EXPANSIONS );
+        // the clock is only read every so often
+        else if ( deadline_ and ( n & 0x3f ) == 0 )
+            checkDeadline();
+        return not exceeded();
+    };
+    bool checkDeadline();
+
+    // take one pattern out of maxPatterns, false and PATTERNS is
+    // exceeded when none are left, the count is exact between threads
+    bool takePattern();
+
+    // mark the budget as exceeded, the first limit hit is kept
+    void exceed( Limit limit ) {
+        Limit none = NONE;
+        exceeded_.compare_exchange_strong( none, limit );
+    };
+
+    bool exceeded() const { return exceeded_.load( std::memory_order_relaxed ) != NONE; };
+    Limit limit() const { return exceeded_.load(); };
+
+    static std::string asString( Limit limit );
+
+private:
+
+    long unsigned int maxPatterns_;
+    long unsigned int maxPaths_;
+    long unsigned int maxExpansions_;
+    long unsigned int deadline_;
+
+    std::atomic<long unsigned int> patterns_;
+    std::atomic<long unsigned int> expansions_;
+    std::chrono::steady_clock::time_point started_;
+    std::atomic<Limit> exceeded_;
+
+};
+
+#endif
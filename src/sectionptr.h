@@ -14,49 +14,101 @@
 #ifndef SECTIONPTR_H
 #define SECTIONPTR_H
 
+#include <cstdint>
 #include <string>
-#include <stdexcept>
-
-//#include "metasection.h"
-//#include "rulesection.h"
-
-class MetaSection;
-class RuleSection;
+#include <unordered_map>
+#include <vector>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
 
+/*
+ * SectionPtr is a reference from a meta rule to a section of a grammar.
+ * It is only the id its name was given in the SectionNames of the
+ * grammar, so it stays valid when the grammar is copied or archived.
+ * Grammar::updatePointers() maps the ids to the sections once, after
+ * the whole grammar has been read.
+ */
 class SectionPtr
 {
     friend class boost::serialization::access;
     template<class Archive>
     void serialize(Archive & ar, const unsigned int /* version */) {
-        ar & name_;
-        ar & mptr_;
-        ar & rptr_;
+        ar & id_;
     }
 
 public:
 
-    SectionPtr( const SectionPtr& ) = default;
-    explicit SectionPtr(std::string name) : name_( name ) , mptr_( NULL ) , rptr_( NULL ) {};
+    typedef uint32_t Id;
 
-    MetaSection * mptr() const { return mptr_; };
-    RuleSection * rptr() const { return rptr_; };
-    const std::string & name() const { return name_; };
+    SectionPtr() : id_( 0 ) {};
+    explicit SectionPtr( Id id ) : id_( id ) {};
 
-    void mptr( MetaSection * ptr ) { mptr_ = ptr; };
-    void rptr( RuleSection * ptr ) { rptr_ = ptr; };
+    Id id() const { return id_; };
 
-    inline friend std::ostream &operator<<(std::ostream &ss, const SectionPtr &p) {
-        ss << " " << p.name_;
-        return ss;
+    bool operator==( const SectionPtr &rhs ) const { return id_ == rhs.id_; };
+    bool operator!=( const SectionPtr &rhs ) const { return id_ != rhs.id_; };
+
+private:
+
+    Id id_;
+
+};
+
+
+/*
+ * SectionNames interns the section names of a grammar. Each distinct
+ * name gets the next id the first time it is seen, whether it is the
+ * name of a section or only referenced by a meta rule.
+ */
+class SectionNames
+{
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void load(Archive & ar, const unsigned int /* version */) {
+        ar >> names_;
+        ids_.clear();
+        for ( SectionPtr::Id i = 0; i < names_.size(); ++i )
+            ids_[names_[i]] = i;
+    }
+
+    template<class Archive>
+    void save(Archive & ar, const unsigned int /* version */) const {
+        ar << names_;
+    }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+public:
+
+    SectionPtr intern( const std::string &name ) {
+        auto it = ids_.find( name );
+        if ( it != ids_.end() )
+            return SectionPtr( it->second );
+        SectionPtr::Id id = static_cast<SectionPtr::Id>( names_.size() );
+        names_.push_back( name );
+        ids_[name] = id;
+        return SectionPtr( id );
+    };
+
+    // set ptr to the id of name, false if name has not been seen
+    bool find( const std::string &name, SectionPtr &ptr ) const {
+        auto it = ids_.find( name );
+        if ( it == ids_.end() )
+            return false;
+        ptr = SectionPtr( it->second );
+        return true;
     };
 
+    const std::string &name( const SectionPtr &ptr ) const { return names_[ptr.id()]; };
+    long unsigned int size() const { return names_.size(); };
+
 private:
 
-    std::string name_;
-    MetaSection * mptr_;
-    RuleSection * rptr_;
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, SectionPtr::Id> ids_;
 
 };
 
 #endif
-
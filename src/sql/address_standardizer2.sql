@@ -0,0 +1,71 @@
+-- the functions of the extension on a small lexicon and grammar,
+-- run with make -f Makefile.pg installcheck as a superuser
+create extension address_standardizer2;
+create table regress_model (gmr text, lex text);
+insert into regress_model values (
+E'[ADDRESS]\n@HOUSE @STREET\n\n[HOUSE]\nNUMBER -> HOUSE -> 0.5\n\n[STREET]\nWORD TYPE -> STREET SUFTYP -> 0.5\n',
+E'LEXICON:\tregress\tENG\ten_US\t4\nLEXENTRY:\tMA\tMASSACHUSETTS\tPROV\tDETACH\nLEXENTRY:\tN\tNORTH\tDIRECT\tDETACH\nLEXENTRY:\tST\tSTREET\tTYPE\tDETACH\nLEXENTRY:\tSTREET\tSTREET\tTYPE\tDETACH\n');
+
+-- text lexicon
+select house_num = '11' and name = 'OAK' and suftype = 'STREET' as ok
+  from regress_model, as_standardize('11 Oak St', gmr, lex, 'en_US', 'PUNCT,SPACE');
+
+-- the rows after the first are cache hits
+select count(*) = 3 as ok
+  from regress_model, generate_series(1, 3) g,
+       as_standardize(g || '1 Oak St', gmr, lex, 'en_US', 'PUNCT,SPACE') s
+ where s.house_num = g || '1';
+select entries >= 1 and hits >= 2 and misses >= 1 as ok from as_cache_stats();
+
+-- bytea lexicon
+select house_num = '22' and name = 'ELM' and suftype = 'STREET' as ok
+  from regress_model, as_standardize('22 Elm Street', gmr, as_compile_lexicon_binary(lex), 'en_US', 'PUNCT,SPACE');
+
+-- batch, parse, match and explain with text and bytea lexicons
+select array_agg(house_num order by ordinal) = '{11,22}' as ok
+  from regress_model, as_standardize_batch(array['11 Oak St', '22 Elm Street'], gmr, lex, 'en_US', 'PUNCT,SPACE');
+select array_agg(house_num order by ordinal) = '{11,22}' as ok
+  from regress_model, as_standardize_batch(array['11 Oak St', '22 Elm Street'], gmr, as_compile_lexicon_binary(lex), 'en_US', 'PUNCT,SPACE');
+select count(*) = 3 as ok
+  from regress_model, as_parse('11 Oak St', lex, 'en_US', 'PUNCT,SPACE');
+select count(*) = 3 as ok
+  from regress_model, as_parse('11 Oak St', as_compile_lexicon_binary(lex), 'en_US', 'PUNCT,SPACE');
+select count(*) = 1 as ok
+  from regress_model, as_match('11 Oak St', gmr, lex, 'en_US', 'PUNCT,SPACE');
+select count(*) = 1 as ok
+  from regress_model, as_match('11 Oak St', gmr, as_compile_lexicon_binary(lex), 'en_US', 'PUNCT,SPACE');
+select count(*) filter (where kind = 'token') = 3 and count(*) filter (where kind = 'result') = 2 as ok
+  from regress_model, as_explain('11 Oak St', gmr, lex, 'en_US', 'PUNCT,SPACE');
+select count(*) filter (where kind = 'token') = 3 and count(*) filter (where kind = 'result') = 2 as ok
+  from regress_model, as_explain('11 Oak St', gmr, as_compile_lexicon_binary(lex), 'en_US', 'PUNCT,SPACE');
+
+-- a compacted lexicon standardizes the same, the grammar is changed so
+-- the pair is not already in the cache
+set address_standardizer2.compact_lexicons = on;
+select house_num = '11' and name = 'OAK' and suftype = 'STREET' as ok
+  from regress_model, as_standardize('11 Oak St', gmr || E'\n', lex, 'en_US', 'PUNCT,SPACE');
+reset address_standardizer2.compact_lexicons;
+
+-- a shared model file is written and mapped
+set address_standardizer2.shared_models = on;
+select house_num = '11' and name = 'OAK' and suftype = 'STREET' as ok
+  from regress_model, as_standardize('11 Oak St', gmr || E'\n\n', lex, 'en_US', 'PUNCT,SPACE');
+select count(*) = 1 as ok from as_cache_entries() where shared;
+reset address_standardizer2.shared_models;
+
+-- the stages are recorded while instrument is on
+set address_standardizer2.instrument = on;
+select house_num = '11' as ok
+  from regress_model, as_standardize('11 Oak St', gmr, lex, 'en_US', 'PUNCT,SPACE');
+select count(*) > 0 as ok from as_stage_stats() where samples > 0;
+reset address_standardizer2.instrument;
+
+-- shrinking the cache keeps the most recently used entry
+set address_standardizer2.cache_size = 1;
+select house_num = '11' as ok
+  from regress_model, as_standardize('11 Oak St', gmr, lex, 'en_US', 'PUNCT,SPACE');
+select cache_size = 1 and entries = 1 as ok from as_cache_stats();
+reset address_standardizer2.cache_size;
+
+drop table regress_model;
+drop extension address_standardizer2;
@@ -1,4 +1,3 @@
-
 /* PostgreSQL headers */
 #include "postgres.h"
 #include "fmgr.h"
@@ -6,7 +5,16 @@
 #include "utils/memutils.h"
 #include "executor/spi.h"
 #include "access/hash.h"
-#include "utils/hsearch.h"
+#include "access/xact.h"
+#if PG_VERSION_NUM >= 130000
+#include "access/detoast.h"
+#include "common/hashfn.h"
+#else
+#include "access/tuptoaster.h"
+#endif
+#include "storage/fd.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
 #include "funcapi.h"
 #include "catalog/pg_type.h"
 
@@ -18,9 +26,14 @@
 
 /* C headers */
 #include <sys/time.h>
+#include <time.h>
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <utime.h>
 
 #ifdef DEBUG
 #include <stdio.h>
@@ -37,78 +50,118 @@
 #define FALSE 0
 #endif
 
-#ifdef DEBUG
-#define SET_TIME(a) gettimeofday(&(a), NULL)
-#define ELAPSED_T(a,b) \
-    elapsed = (b.tv_sec - a.tv_sec)*1000.0; \
-    elapsed += (b.tv_usec - a.tv_usec)/1000.0;
-#else
-#define SET_TIME(a) do { ; } while (0)
-#define ELAPSED_T(a,b) do { ; } while (0)
-#endif
-
-#define MAX_RULE_LENGTH 128
-#define TUPLIMIT 1000
-
-#define STD_CACHE_ITEMS 4
-#define STD_BACKEND_HASH_SIZE 16
+#define STD_CACHE_DEFAULT_SIZE 8
+#define STD_CACHE_MAX_SIZE 1000
 
-static HTAB* StdHash = NULL;
+/* shared model files, relative to the data directory */
+#define STD_MODEL_DIR "pg_address_standardizer2"
+#define STD_SHARED_MODELS_DEFAULT 64
+#define STD_SHARED_MODELS_MAX 100000
+/* a temporary model file this old was left by a crashed backend */
+#define STD_MODEL_TMP_AGE 3600
 
 
+/*
+ * A cheap key for a lexicon or grammar argument so we do not have to
+ * copy and md5 the whole text for every row. A toasted value is known
+ * by its toast pointer without fetching it, anything else is hashed as
+ * it is stored. The md5 is only computed when the cheap key misses.
+ *
+ * Toast value oids are reused once a row is deleted and vacuumed and
+ * the hash is never checked against the md5, so a key is only trusted
+ * by the statement that made it. The first row of every statement
+ * confirms its entry by md5.
+ */
 typedef struct
 {
-    char *lex_md5;
-    char *gmr_md5;
-    STANDARDIZER *std;
-    MemoryContext std_mcxt;
+    Oid toastrelid;
+    Oid valueid;
+    uint64 hash;
+    int32 size;     /* zero for an unused key */
+    TimestampTz xact_start;
+    TimestampTz stmt_start;
 }
-StdCacheItem;
+StdArgKey;
 
+/*
+ * The lexicon argument, either lexicon text or a compiled lexicon
+ * image from as_compile_lexicon_binary() which is not NUL terminated.
+ */
 typedef struct
 {
-    StdCacheItem StdCache[STD_CACHE_ITEMS];
-    int NextSlot;
-    MemoryContext StdCacheContext;
+    char *data;
+    long unsigned int size;
+    bool binary;
 }
-StdPortalCache;
+StdLexicon;
 
+/*
+ * The cache lives for the life of the backend in TopMemoryContext so
+ * it survives from one query to the next. Entries are identified by
+ * the md5 of the lexicon and grammar text, so a changed lexicon or
+ * grammar is simply a different entry and the stale one ages out.
+ * When the cache is full the least recently used entry is evicted.
+ */
 typedef struct
 {
-    MemoryContext context;
-    STANDARDIZER *std;
+    STANDARDIZER *std;      /* NULL when the slot is empty */
+    char lex_md5[STD_MD5_SIZE];
+    char gmr_md5[STD_MD5_SIZE];
+    StdArgKey lex_key;
+    StdArgKey gmr_key;
+    uint64 generation;      /* unique for every entry built */
+    uint64 last_used;       /* StdCacheClock when it was last used */
+    int64 hits;
+    double build_ms;
+    int64 memory;
 }
-StdHashEntry;
-
-
-/* Memory context hash table function prototypes */
-uint32 mcxt_ptr_hash_std(const void *key, Size keysize);
-static void CreateStdHash(void);
-static void AddStdHashEntry(MemoryContext mcxt, STANDARDIZER *std);
-static StdHashEntry *GetStdHashEntry(MemoryContext mcxt);
-static void DeleteStdHashEntry(MemoryContext mcxt);
-
-/* Memory context cache function prototypes */
-/*
-static void StdCacheInit(MemoryContext context);
-static void StdCacheReset(MemoryContext context);
-static void StdCacheDelete(MemoryContext context);
-static bool StdCacheIsEmpty(MemoryContext context);
-static void StdCacheStats(MemoryContext context, int level);
-#ifdef MEMORY_CONTEXT_CHECKING
-static void StdCacheCheck(MemoryContext context);
-#endif
-*/
-
-static bool IsInStdPortalCache(StdPortalCache *STDCache,  char *lexicon, char *grammar);
-static STANDARDIZER *GetStdFromPortalCache(StdPortalCache *STDCache,  char *lexicon, char *grammar);
-static void AddToStdPortalCache(StdPortalCache *STDCache, char *lexicon, char *grammar);
-static StdPortalCache *GetStdPortalCache(FunctionCallInfo fcinfo);
+StdCacheEntry;
+
+int std_cache_size = STD_CACHE_DEFAULT_SIZE;
+bool std_shared_models = false;
+int std_max_shared_models = STD_SHARED_MODELS_DEFAULT;
+bool std_instrument_on = false;
+bool std_compact_lexicons_on = false;
+
+static StdCacheEntry *StdCacheEntries = NULL;
+static int StdCacheAllocated = 0;
+static uint64 StdCacheClock = 0;
+static uint64 StdCacheGeneration = 0;
+static int64 StdCacheHits = 0;
+static int64 StdCacheMisses = 0;
+static int64 StdCacheEvictions = 0;
+
+
+/* cache function prototypes */
+static void StdCacheResize(void);
+static int StdCacheFindByKey(StdArgKey *lex_key, StdArgKey *gmr_key);
+static int StdCacheFindByMd5(char *lex_md5, char *gmr_md5);
+static int StdCacheAdd(StdLexicon *lexicon, char *grammar, char *lex_md5, char *gmr_md5);
+static void StdCacheEvict(int slot);
+static int StdCacheVictim(void);
+static int StdCacheLru(void);
+static STANDARDIZER *StdCacheUse(int slot);
+static int64 StdHeapInUse(void);
+
+/* cheap argument key function prototypes */
+static uint64 StdHashBytes(const char *data, int len);
+static void StdArgKeyFromDatum(Datum datum, StdArgKey *key);
+static bool StdArgKeyEqual(StdArgKey *a, StdArgKey *b);
+static char *StdPallocMd5(char *md5);
+
+
+/* settings */
+static void StdInstrumentAssign(bool newval, void *extra);
+static void StdCompactLexiconsAssign(bool newval, void *extra);
 
 
 /* standardizer api functions */
 
-static STANDARDIZER *CreateStd(char *lexicon, char *grammar);
+static STANDARDIZER *CreateStd(StdLexicon *lexicon, char *grammar, char *lex_md5, char *gmr_md5);
+static void LoadLexicon(STANDARDIZER *std, StdLexicon *lexicon);
+static void *MapSharedModel(char *lex_md5, char *gmr_md5);
+static void *WriteSharedModel(void *lex, void *gmr, char *lex_md5, char *gmr_md5);
+static void PruneSharedModels(const char *keep);
 
 
 static void
@@ -116,7 +169,10 @@ std_free(STANDARDIZER *std)
 {
     DBG("Enter: std_free()");
     if (std) {
-        if (std->lex_obj) freeLexiconPtr( std->lex_obj );
+        /* the lexicon of a model belongs to the model */
+        if (std->model_obj) freeModelPtr( std->model_obj );
+        else if (std->lex_obj) freeLexiconPtr( std->lex_obj );
+        std->model_obj = NULL;
         std->lex_obj = NULL;
         if (std->gmr_obj) freeGrammarPtr( std->gmr_obj );
         std->gmr_obj = NULL;
@@ -126,468 +182,697 @@ std_free(STANDARDIZER *std)
 }
 
 
-static void
-#if PGSQL_VERSION < 96
-
-StdCacheDelete(MemoryContext context)
-{
-#else
-StdCacheDelete(void *ptr)
+/* public api */
+void
+InitStdCache(void)
 {
-    MemoryContext context = (MemoryContext)ptr;
-#endif
-    StdHashEntry *she;
-
-    DBG("Enter: StdCacheDelete");
-    /* lookup the hash entry in the global hash table
-       so we can free it */
-    she = GetStdHashEntry(context);
-
-    if (!she)
-        elog(ERROR, "StdCacheDelete: Trying to delete non-existant hash entry object with MemoryContext key (%p)", (void *)context);
-
-    DBG("deleting std object (%p) with MemoryContext key (%p)", she->std, context);
-
-    if (she->std)
-        std_free(she->std);
-
-    DeleteStdHashEntry(context);
+    DefineCustomIntVariable("address_standardizer2.cache_size",
+                            "Number of lexicon and grammar pairs each backend keeps built.",
+                            "The least recently used pair is dropped when the cache is full.",
+                            &std_cache_size,
+                            STD_CACHE_DEFAULT_SIZE,
+                            1,
+                            STD_CACHE_MAX_SIZE,
+                            PGC_USERSET,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    DefineCustomBoolVariable("address_standardizer2.shared_models",
+                             "Share compiled lexicon and grammar pairs between backends.",
+                             "Each pair is compiled once into a model file in pg_address_standardizer2 under the data directory that every backend maps read-only.",
+                             &std_shared_models,
+                             false,
+                             PGC_SUSET,
+                             0,
+                             NULL,
+                             NULL,
+                             NULL);
+
+    DefineCustomIntVariable("address_standardizer2.max_shared_models",
+                            "Number of shared model files kept in the data directory.",
+                            "The least recently used files are removed when a new one is written.",
+                            &std_max_shared_models,
+                            STD_SHARED_MODELS_DEFAULT,
+                            1,
+                            STD_SHARED_MODELS_MAX,
+                            PGC_SUSET,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    DefineCustomBoolVariable("address_standardizer2.instrument",
+                             "Record the time spent in each stage of standardizing an address.",
+                             "The figures are kept per backend and reported by as_stage_stats().",
+                             &std_instrument_on,
+                             false,
+                             PGC_USERSET,
+                             0,
+                             NULL,
+                             StdInstrumentAssign,
+                             NULL);
+
+    DefineCustomBoolVariable("address_standardizer2.compact_lexicons",
+                             "Compact the lexicons a backend loads to save memory.",
+                             "The entries are moved into a finite state transducer, this only applies to lexicons that are not in a shared model.",
+                             &std_compact_lexicons_on,
+                             false,
+                             PGC_USERSET,
+                             0,
+                             NULL,
+                             StdCompactLexiconsAssign,
+                             NULL);
 }
 
-#if PGSQL_VERSION < 96
 
 static void
-StdCacheInit(MemoryContext context)
+StdInstrumentAssign(bool newval, void *extra)
 {
-    /* NOP - initialized when first used. */
+    std_instrument( newval ? 1 : 0 );
 }
 
 
 static void
-StdCacheReset(MemoryContext context)
+StdCompactLexiconsAssign(bool newval, void *extra)
 {
-    // NOP - Seems to be a required function
+    std_compact_lexicons( newval ? 1 : 0 );
 }
 
 
-static bool
-StdCacheIsEmpty(MemoryContext context)
+/*
+ * make the entry array match the cache_size setting, evicting the
+ * least recently used entries if it is shrinking
+ */
+static void
+StdCacheResize(void)
 {
-    // always return false - another required function
-    return FALSE;
+    StdCacheEntry *entries;
+    int used = 0;
+    int i;
+    int k;
+
+    if (StdCacheAllocated == std_cache_size)
+        return;
+
+    DBG("StdCacheResize: %d -> %d", StdCacheAllocated, std_cache_size);
+    for (i=0; i<StdCacheAllocated; i++)
+        if (StdCacheEntries[i].std)
+            ++used;
+    while (used > std_cache_size) {
+        StdCacheEvict(StdCacheLru());
+        --used;
+    }
+
+    entries = (StdCacheEntry *) MemoryContextAllocZero(TopMemoryContext,
+                    sizeof(StdCacheEntry) * std_cache_size);
+    for (i=0, k=0; i<StdCacheAllocated && k<std_cache_size; i++)
+        if (StdCacheEntries[i].std)
+            entries[k++] = StdCacheEntries[i];
+
+    if (StdCacheEntries)
+        pfree(StdCacheEntries);
+    StdCacheEntries = entries;
+    StdCacheAllocated = std_cache_size;
 }
 
 
-static void
-StdCacheStats(MemoryContext context, int level)
+static int
+StdCacheFindByKey(StdArgKey *lex_key, StdArgKey *gmr_key)
 {
-    // another required function
-    fprintf(stderr, "%s: STANDARDIZER context\n", context->name);
+    int i;
+
+    for (i=0; i<StdCacheAllocated; i++) {
+        StdCacheEntry *ce = &StdCacheEntries[i];
+        if ( ce->std && ce->lex_key.size != 0 &&
+             StdArgKeyEqual(&ce->lex_key, lex_key) &&
+             StdArgKeyEqual(&ce->gmr_key, gmr_key) )
+            return i;
+    }
+    return -1;
 }
 
 
-#ifdef MEMORY_CONTEXT_CHECKING
-static void
-StdCacheCheck(MemoryContext context)
+static int
+StdCacheFindByMd5(char *lex_md5, char *gmr_md5)
 {
-    // NOP - another reuired function
+    int i;
+
+    for (i=0; i<StdCacheAllocated; i++) {
+        StdCacheEntry *ce = &StdCacheEntries[i];
+        if ( ce->std && !strcmp(ce->lex_md5, lex_md5) &&
+             !strcmp(ce->gmr_md5, gmr_md5) )
+            return i;
+    }
+    return -1;
 }
-#endif
 
 
-/* Memory context definition must match the current version of PostgreSQL */
-static MemoryContextMethods StdCacheContextMethods =
-{
-    NULL,
-    NULL,
-    NULL,
-    StdCacheInit,
-    StdCacheReset,
-    StdCacheDelete,
-    NULL,
-    StdCacheIsEmpty,
-    StdCacheStats
-#ifdef MEMORY_CONTEXT_CHECKING
-    , StdCacheCheck
-#endif
-};
+/* an empty slot if there is one, else the least recently used */
+static int
+StdCacheVictim(void)
+{
+    int i;
 
-#endif /* PGSQL_VERSION < 96 */
+    for (i=0; i<StdCacheAllocated; i++)
+        if (!StdCacheEntries[i].std)
+            return i;
+    return StdCacheLru();
+}
 
 
-uint32
-mcxt_ptr_hash_std(const void *key, Size keysize)
+/* the least recently used occupied slot, -1 if the cache is empty */
+static int
+StdCacheLru(void)
 {
-    uint32 hashval;
-    hashval = DatumGetUInt32(hash_any(key, (int32) keysize));
-    return hashval;
+    int victim = -1;
+    int i;
+
+    for (i=0; i<StdCacheAllocated; i++) {
+        StdCacheEntry *ce = &StdCacheEntries[i];
+        if (!ce->std)
+            continue;
+        if (victim < 0 || ce->last_used < StdCacheEntries[victim].last_used)
+            victim = i;
+    }
+    return victim;
 }
 
 
 static void
-CreateStdHash(void)
+StdCacheEvict(int slot)
 {
-    HASHCTL ctl;
-    
-    ctl.keysize = sizeof(MemoryContext);
-    ctl.entrysize = sizeof(StdHashEntry);
-    ctl.hash = mcxt_ptr_hash_std;
+    StdCacheEntry *ce = &StdCacheEntries[slot];
 
-    StdHash = hash_create("Address Standardizer 2 Backend MemoryContext Hash", STD_BACKEND_HASH_SIZE, &ctl, (HASH_ELEM | HASH_FUNCTION));
-    DBG("CreateStdHash: created StdHash (%p)", StdHash);
+    if (!ce->std)
+        return;
+
+    DBG("StdCacheEvict: slot %d ('%s', '%s')", slot, ce->lex_md5, ce->gmr_md5);
+    std_free(ce->std);
+    memset(ce, 0, sizeof(StdCacheEntry));
+    ++StdCacheEvictions;
 }
 
 
-static void
-AddStdHashEntry(MemoryContext mcxt, STANDARDIZER *std)
-{
-    bool found;
-    void **key;
-    StdHashEntry *he;
-
-    DBG("Enter: AddStdHashEntry(mcxt=%p, std=%p)", mcxt, std);
-    /* The hash key is the MemoryContext pointer */
-    key = (void *)&mcxt;
-
-    he = (StdHashEntry *) hash_search(StdHash, key, HASH_ENTER, &found);
-    DBG("AddStdHashEntry: he=%p, found=%d", he, found);
-    if (!found) {
-        he->context = mcxt;
-        he->std = std;
-        DBG("Leaving AddStdHashEntry - Added");
-    }
-    else {
-        elog(ERROR, "AddStdHashEntry: This memory context is already in use! (%p)", (void *)mcxt);
-    }
+/* build a standardizer and put it in the cache, the md5s are copied */
+static int
+StdCacheAdd(StdLexicon *lexicon, char *grammar, char *lex_md5, char *gmr_md5)
+{
+    STANDARDIZER *std;
+    StdCacheEntry *ce;
+    struct timeval t0;
+    struct timeval t1;
+    int64 mem0;
+    int64 mem1;
+    int slot;
+
+    DBG("Enter: StdCacheAdd");
+
+    /* build it before evicting anything in case this fails */
+    mem0 = StdHeapInUse();
+    gettimeofday(&t0, NULL);
+    std = CreateStd( lexicon, grammar, lex_md5, gmr_md5 );
+    if (!std)
+        elog(ERROR, "StdCacheAdd: could not create address standardizer");
+    gettimeofday(&t1, NULL);
+    mem1 = StdHeapInUse();
+
+    slot = StdCacheVictim();
+    StdCacheEvict(slot);
+
+    ce = &StdCacheEntries[slot];
+    ce->std = std;
+    strlcpy(ce->lex_md5, lex_md5, STD_MD5_SIZE);
+    strlcpy(ce->gmr_md5, gmr_md5, STD_MD5_SIZE);
+    ce->generation = ++StdCacheGeneration;
+    ce->last_used = StdCacheClock;
+    ce->hits = 0;
+    ce->build_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_usec - t0.tv_usec) / 1000.0;
+    ce->memory = mem1 > mem0 ? mem1 - mem0 : 0;
+
+    DBG("StdCacheAdd: slot %d ('%s', '%s') built in %.3f ms", slot, ce->lex_md5, ce->gmr_md5, ce->build_ms);
+    return slot;
 }
 
-static StdHashEntry *
-GetStdHashEntry(MemoryContext mcxt)
+
+static STANDARDIZER *
+StdCacheUse(int slot)
 {
-    void **key;
-    StdHashEntry *he;
+    StdCacheEntry *ce = &StdCacheEntries[slot];
 
-    DBG("Enter: GetStdHashEntry");
-    key = (void *)&mcxt;
-    he = (StdHashEntry *) hash_search(StdHash, key, HASH_FIND, NULL);
-    return he;
+    ce->last_used = ++StdCacheClock;
+    return ce->std;
 }
 
 
-static void
-DeleteStdHashEntry(MemoryContext mcxt)
+/* bytes allocated with malloc(), which is where the C++ objects live */
+static int64
+StdHeapInUse(void)
 {
-    void **key;
-    StdHashEntry *he;
-
-    DBG("Enter: DeleteStdHashEntry");
-    key = (void *)&mcxt;
-    he = (StdHashEntry *) hash_search(StdHash, key, HASH_REMOVE, NULL);
-    if (!he)
-        elog(ERROR, "DeleteStdHashEntry: There was an error removing the STD object from this MemoryContext (%p)", (void *)mcxt);
-
-    he->std = NULL;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    return (int64) mi.uordblks + (int64) mi.hblkhd;
+#elif defined(__GLIBC__)
+    struct mallinfo mi = mallinfo();
+    return (int64) (unsigned int) mi.uordblks + (int64) (unsigned int) mi.hblkhd;
+#else
+    return 0;
+#endif
 }
 
 
 /* public api */
-bool
-IsInStdCache(StdCache STDCache, char *lexicon, char *grammar) {
-    return IsInStdPortalCache((StdPortalCache *) STDCache, lexicon, grammar);
+STANDARDIZER *
+GetStdUsingFCInfo(FunctionCallInfo fcinfo, int lex_arg, int gmr_arg, bool lex_binary)
+{
+    StdCallCache *call;
+
+    if (fcinfo->flinfo->fn_extra == NULL) {
+        call = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, sizeof(StdCallCache));
+        call->slot = -1;
+        call->generation = 0;
+        fcinfo->flinfo->fn_extra = call;
+    }
+    call = (StdCallCache *) fcinfo->flinfo->fn_extra;
+
+    /*
+     * constant arguments can not change for the life of this call site
+     * so once we have found their entry we do not need to look again
+     */
+    if (!get_fn_expr_arg_stable(fcinfo->flinfo, lex_arg) ||
+            (gmr_arg >= 0 && !get_fn_expr_arg_stable(fcinfo->flinfo, gmr_arg)))
+        call->slot = -1;
+
+    return GetStdUsingCallCache(fcinfo, call, lex_arg, gmr_arg, lex_binary);
 }
 
 
-static bool
-IsInStdPortalCache(StdPortalCache *STDCache,  char *lexicon, char *grammar)
+/* public api */
+STANDARDIZER *
+GetStdUsingCallCache(FunctionCallInfo fcinfo, StdCallCache *call, int lex_arg, int gmr_arg, bool lex_binary)
 {
-    int i;
-    bool ret = FALSE;
-    char *lex_md5;
-    char *gmr_md5;
-
-    DBG("Enter: IsInStdPortalCache");
-
-    lex_md5 = getMd5( lexicon );
-    DBG("lex_md5: %p", lex_md5);
-
-    gmr_md5 = getMd5( grammar );
-    DBG("gmr_md5: %p", gmr_md5);
-    if ( gmr_md5 == NULL )
-        gmr_md5 = strdup("");
-    DBG("gmr_md5: %p", gmr_md5);
-
-    DBG("Looping through %d STD_CACHE_ITEMS", STD_CACHE_ITEMS);
-    for (i=0; i<STD_CACHE_ITEMS; i++) {
-        StdCacheItem *ci = &STDCache->StdCache[i];
-        DBG("StdCacheItem[%d] = %p", i, ci);
-        DBG("   ci->lex_md5: %p, ci->gmr_md5: %p", ci->lex_md5, ci->gmr_md5);
-        if ( ci->lex_md5 && !strcmp(ci->lex_md5, lex_md5 ) &&
-             ci->gmr_md5 && !strcmp(ci->gmr_md5, gmr_md5 ) ) {
-                ret = TRUE;
-                break;
+    StdArgKey lex_key;
+    StdArgKey gmr_key;
+    int slot;
+
+    StdCacheResize();
+
+    if (call->slot >= 0 && call->slot < StdCacheAllocated &&
+            StdCacheEntries[call->slot].generation == call->generation) {
+        DBG("GetStdUsingCallCache: same arguments, slot %d", call->slot);
+        ++StdCacheHits;
+        ++StdCacheEntries[call->slot].hits;
+        return StdCacheUse(call->slot);
+    }
+
+    StdArgKeyFromDatum(PG_GETARG_DATUM(lex_arg), &lex_key);
+    if (gmr_arg >= 0)
+        StdArgKeyFromDatum(PG_GETARG_DATUM(gmr_arg), &gmr_key);
+    else
+        memset(&gmr_key, 0, sizeof(StdArgKey));
+
+    slot = StdCacheFindByKey(&lex_key, &gmr_key);
+    if (slot < 0) {
+        StdLexicon lexicon;
+        char *grammar;
+        char *lex_md5;
+        char *gmr_md5;
+
+        /* only now pay for copying the text and computing the md5 */
+        DBG("GetStdUsingCallCache: key miss, checking md5");
+        lexicon.binary = lex_binary;
+        if (lexicon.binary) {
+            bytea *image = PG_GETARG_BYTEA_PP(lex_arg);
+            lexicon.data = VARDATA_ANY(image);
+            lexicon.size = VARSIZE_ANY_EXHDR(image);
+            lex_md5 = StdPallocMd5( getMd5Bytes( lexicon.data, lexicon.size ) );
         }
+        else {
+            lexicon.data = text_to_cstring(DatumGetTextPP(PG_GETARG_DATUM(lex_arg)));
+            lexicon.size = strlen(lexicon.data);
+            lex_md5 = StdPallocMd5( getMd5( lexicon.data ) );
+        }
+        if (gmr_arg >= 0)
+            grammar = text_to_cstring(DatumGetTextPP(PG_GETARG_DATUM(gmr_arg)));
+        else
+            grammar = pstrdup("");
+
+        gmr_md5 = StdPallocMd5( getMd5( grammar ) );
+
+        slot = StdCacheFindByMd5(lex_md5, gmr_md5);
+        if (slot < 0) {
+            ++StdCacheMisses;
+            slot = StdCacheAdd(&lexicon, grammar, lex_md5, gmr_md5);
+        }
+        else {
+            ++StdCacheHits;
+            ++StdCacheEntries[slot].hits;
+        }
+
+        /* the same text may arrive under a new key, remember the latest */
+        StdCacheEntries[slot].lex_key = lex_key;
+        StdCacheEntries[slot].gmr_key = gmr_key;
+
+        pfree( lex_md5 );
+        pfree( gmr_md5 );
+        if (!lexicon.binary)
+            pfree( lexicon.data );
+        pfree( grammar );
+    }
+    else {
+        ++StdCacheHits;
+        ++StdCacheEntries[slot].hits;
     }
-    DBG("End of loop, ret: %d", ret);
 
-    DBG("free( lex_md5 )");
-    free( lex_md5 );
-    DBG("free( lex_md5 )");
-    free( gmr_md5 );
+    call->slot = slot;
+    call->generation = StdCacheEntries[slot].generation;
 
-    DBG("Leaving IsInStdPortalCache, ret: %d", ret);
-    return ret;
+    DBG("GetStdUsingCallCache: slot %d std=%p", slot, StdCacheEntries[slot].std);
+    return StdCacheUse(slot);
 }
 
 
 /* public api */
-STANDARDIZER *
-GetStdFromStdCache(StdCache STDCache,  char *lexicon, char *grammar) {
-    return GetStdFromPortalCache((StdPortalCache *) STDCache, lexicon, grammar);
+void
+GetStdCacheStats(StdCacheStats *stats)
+{
+    int i;
+
+    memset(stats, 0, sizeof(StdCacheStats));
+    stats->size = std_cache_size;
+    stats->hits = StdCacheHits;
+    stats->misses = StdCacheMisses;
+    stats->evictions = StdCacheEvictions;
+    for (i=0; i<StdCacheAllocated; i++) {
+        if (StdCacheEntries[i].std) {
+            ++stats->entries;
+            stats->memory += StdCacheEntries[i].memory;
+        }
+    }
 }
 
 
-static STANDARDIZER *
-GetStdFromPortalCache(StdPortalCache *STDCache,  char *lexicon, char *grammar)
+/* public api */
+int
+GetStdCacheEntryStats(StdCacheEntryStats **entries)
 {
+    int n = 0;
     int i;
-    char *lex_md5;
-    char *gmr_md5;
-    STANDARDIZER *ret = NULL;
-
-    DBG("Enter: GetStdFromPortalCache");
-
-    lex_md5 = getMd5( lexicon );
-    gmr_md5 = getMd5( grammar );
-    if ( gmr_md5 == NULL )
-        gmr_md5 = strdup("");
-
-    for (i=0; i<STD_CACHE_ITEMS; i++) {
-        StdCacheItem *ci = &STDCache->StdCache[i];
-        if ( ci->lex_md5 && !strcmp(ci->lex_md5, lex_md5 ) &&
-             ci->gmr_md5 && !strcmp(ci->gmr_md5, gmr_md5 ) ) {
-                ret = STDCache->StdCache[i].std;
-                break;
-        }
-    }
 
-    free( lex_md5 );
-    free( gmr_md5 );
+    *entries = (StdCacheEntryStats *) palloc0(sizeof(StdCacheEntryStats) * (StdCacheAllocated + 1));
+    for (i=0; i<StdCacheAllocated; i++) {
+        StdCacheEntry *ce = &StdCacheEntries[i];
+        StdCacheEntryStats *es;
+        if (!ce->std)
+            continue;
+        es = &(*entries)[n++];
+        es->slot = i;
+        strlcpy(es->lex_md5, ce->lex_md5, STD_MD5_SIZE);
+        strlcpy(es->gmr_md5, ce->gmr_md5, STD_MD5_SIZE);
+        es->hits = ce->hits;
+        es->build_ms = ce->build_ms;
+        es->memory = ce->memory;
+        es->idle = (int64) (StdCacheClock - ce->last_used);
+        es->shared = ce->std->shared != 0;
+    }
+    return n;
+}
 
-    DBG("GetStdFromPortalCache returning: %p", (void*) ret);
 
-    return ret;
+static uint64
+StdHashBytes(const char *data, int len)
+{
+#if PG_VERSION_NUM >= 110000
+    return DatumGetUInt64(hash_any_extended((const unsigned char *) data, len, 0));
+#else
+    /* no 64 bit hash, so combine two 32 bit hashes of different ranges */
+    uint64 h1 = DatumGetUInt32(hash_any((const unsigned char *) data, len));
+    uint64 h2 = DatumGetUInt32(hash_any((const unsigned char *) data + len / 2, len - len / 2));
+    return (h1 << 32) | h2;
+#endif
 }
 
 
 static void
-DeleteNextSlotFromStdCache(StdPortalCache *STDCache)
-{
-    MemoryContext old_context;
-
-    DBG("Enter: DeleteNextSlotFromStdCache");
-    if (STDCache->StdCache[STDCache->NextSlot].std != NULL) {
-        StdCacheItem *ce = &STDCache->StdCache[STDCache->NextSlot];
-        DBG("Removing STD cache entry ('%s', '%s') index %d", ce->lex_md5, ce->gmr_md5, STDCache->NextSlot);
-
-        /*
-           zero out the entries and free the memory context
-           We will get a callback to free the std object.
-        */
-        old_context = MemoryContextSwitchTo(STDCache->StdCacheContext);
-        MemoryContextDelete(ce->std_mcxt);
-        pfree(ce->lex_md5);
-        ce->lex_md5 = NULL;
-        pfree(ce->gmr_md5);
-        ce->gmr_md5 = NULL;
-        ce->std    = NULL;
-        MemoryContextSwitchTo(old_context);
+StdArgKeyFromDatum(Datum datum, StdArgKey *key)
+{
+    struct varlena *raw = (struct varlena *) DatumGetPointer(datum);
+
+    memset(key, 0, sizeof(StdArgKey));
+    key->xact_start = GetCurrentTransactionStartTimestamp();
+    key->stmt_start = GetCurrentStatementStartTimestamp();
+
+    if (VARATT_IS_EXTERNAL_ONDISK(raw)) {
+        /* a toasted value is identified by its toast pointer */
+        struct varatt_external toast_pointer;
+
+        VARATT_EXTERNAL_GET_POINTER(toast_pointer, raw);
+        key->toastrelid = toast_pointer.va_toastrelid;
+        key->valueid = toast_pointer.va_valueid;
+        key->size = toast_pointer.va_rawsize;
+    }
+    else {
+        /* inline values are hashed as stored, even if compressed */
+        if (VARATT_IS_EXTERNAL(raw))
+            raw = pg_detoast_datum_packed(raw);
+        key->hash = StdHashBytes(VARDATA_ANY(raw), (int) VARSIZE_ANY_EXHDR(raw));
+        key->size = (int32) VARSIZE_ANY(raw);
     }
 }
 
 
-/* public api */
-void
-AddToStdCache(StdCache cache, char *lexicon, char *grammar) {
-    AddToStdPortalCache((StdPortalCache *) cache, lexicon, grammar);
+static bool
+StdArgKeyEqual(StdArgKey *a, StdArgKey *b)
+{
+    return a->toastrelid == b->toastrelid &&
+           a->valueid == b->valueid &&
+           a->hash == b->hash &&
+           a->size == b->size &&
+           a->xact_start == b->xact_start &&
+           a->stmt_start == b->stmt_start;
 }
 
 
+/*
+ * move a malloc'd md5 into palloc memory so it is not leaked when
+ * building the standardizer fails with elog(ERROR)
+ */
+static char *
+StdPallocMd5(char *md5)
+{
+    char *copy = pstrdup(md5 ? md5 : "");
+
+    free(md5);
+    return copy;
+}
+
+
+/*
+ * Shared models are model files named by the md5 of the lexicon and
+ * grammar so they never need invalidating, every backend that maps one
+ * shares a single read-only copy through the page cache.
+ */
 static void
-AddToStdPortalCache(StdPortalCache *STDCache, char *lexicon, char * grammar)
+ModelPath(char *path, char *lex_md5, char *gmr_md5)
 {
-    MemoryContext STDMemoryContext;
-    MemoryContext old_context;
-    STANDARDIZER *std = NULL;
-#if PGSQL_VERSION >= 96
-    MemoryContextCallback *callback;
-#endif
-    char * lex_md5;
-    char * gmr_md5;
+    snprintf(path, MAXPGPATH, "%s/%s-%s.model", STD_MODEL_DIR, lex_md5, gmr_md5);
+}
 
-    DBG("Enter: AddToStdPortalCache");
 
-    /* Create the std object */
-    std = CreateStd( lexicon, grammar );
-    if (!std)
-        elog(ERROR,
-            "AddToStdPortalCache: could not create address standardizer");
-
-    DBG("Calling getMd5( lexicon )");
-    lex_md5 = getMd5( lexicon );
-    DBG("Calling getMd5( grammar )");
-    gmr_md5 = getMd5( grammar );
-    if ( gmr_md5 == NULL )
-        gmr_md5 = strdup("");
-
-    /* if the NextSlot in the cache is used, then delete it */
-    if (STDCache->StdCache[STDCache->NextSlot].std != NULL) {
-#ifdef DEBUG
-        StdCacheItem *ce = &STDCache->StdCache[STDCache->NextSlot];
-        DBG("Removing item from STD cache ('%s', '%s') index %d", ce->lex_md5, ce->gmr_md5, STDCache->NextSlot);
-#endif
-        DeleteNextSlotFromStdCache(STDCache);
-    }
+/* map the shared model if some backend has written it, else NULL */
+static void *
+MapSharedModel(char *lex_md5, char *gmr_md5)
+{
+    char              path[MAXPGPATH];
+    void             *model;
+    char             *err_msg = NULL;
 
-    DBG("Adding item to STD cache ('%s', '%s') index %d", lex_md5, gmr_md5, STDCache->NextSlot);
+    ModelPath(path, lex_md5, gmr_md5);
+    if (access(path, R_OK) != 0)
+        return NULL;
+
+    model = getModelPtr( path, &err_msg );
+    if (!model) {
+        /* probably written by an older version, it gets replaced */
+        elog(DEBUG1, "MapSharedModel: can not use '%s' (%s)", path, err_msg);
+        free(err_msg);
+        return NULL;
+    }
+    /* the modification time orders the files for PruneSharedModels() */
+    utime(path, NULL);
+    DBG("MapSharedModel: mapped '%s'", path);
+    return model;
+}
 
-#if PGSQL_VERSION < 96
-    STDMemoryContext = MemoryContextCreate(T_AllocSetContext, 8192,
-                                           &StdCacheContextMethods,
-                                           STDCache->StdCacheContext,
-                                           "AddressStandardizer2 STD Memory Context");
-#else
-    STDMemoryContext = AllocSetContextCreate(STDCache->StdCacheContext,
-                                              "AddressStandardizer2 STD Memory Context",
-                                              ALLOCSET_SMALL_SIZES);
-    /* PgSQL comments suggest allocating calback in the context */
-    /* being managed, so that the callback object gets cleaned along with */
-    /* the context */
-    callback = MemoryContextAlloc(STDMemoryContext, sizeof(MemoryContextCallback));
-    callback->arg = (void*)(STDMemoryContext);
-    callback->func = StdCacheDelete;
-    MemoryContextRegisterResetCallback(STDMemoryContext, callback);
-#endif
 
+/*
+ * write the shared model for lex and gmr and map it, returns NULL if
+ * that fails and the caller keeps using lex and gmr
+ */
+static void *
+WriteSharedModel(void *lex, void *gmr, char *lex_md5, char *gmr_md5)
+{
+    char              path[MAXPGPATH];
+    char              tmppath[MAXPGPATH];
+    void             *model;
+    char             *err_msg = NULL;
 
-    /* Create the backend hash if it doesn't already exist */
-    DBG("Check if StdHash exists (%p)", (void*) StdHash);
-    if (!StdHash)
-        CreateStdHash();
+    if (mkdir(STD_MODEL_DIR, S_IRWXU) != 0 && errno != EEXIST) {
+        elog(WARNING, "could not create directory \"%s\": %m", STD_MODEL_DIR);
+        return NULL;
+    }
 
     /*
-     * Add the MemoryContext to the backend hash so we can
-     * clean up upon portal shutdown
+     * other backends only ever see a complete file, and durable_rename
+     * syncs it before renaming so a crash can not leave a torn file
+     * under the final name
      */
-    DBG("Adding standardizer obj (%p) to hash table with MemoryContext key (%p)", (void*) std, (void*) STDMemoryContext);
+    ModelPath(path, lex_md5, gmr_md5);
+    snprintf(tmppath, MAXPGPATH, "%s.%d.tmp", path, MyProcPid);
+    if (!writeModelFile( tmppath, lex, gmr, &err_msg )) {
+        elog(WARNING, "could not write address standardizer model \"%s\": %s", tmppath, err_msg);
+        free(err_msg);
+        unlink(tmppath);
+        return NULL;
+    }
+    if (durable_rename(tmppath, path, WARNING) != 0) {
+        unlink(tmppath);
+        return NULL;
+    }
 
-    AddStdHashEntry(STDMemoryContext, std);
+    PruneSharedModels(path);
 
-    /* change memory contexts so the pstrdup are allocated in the
-     * context of this cache item. They will be freed when the
-     * cache item is deleted.
-    */
-    DBG("AddToStdPortalCache: changing memory context to %p", STDCache->StdCacheContext);
-    old_context = MemoryContextSwitchTo(STDCache->StdCacheContext);
-    DBG("  old_context= %p", (void*) old_context);
-    STDCache->StdCache[STDCache->NextSlot].lex_md5 = pstrdup(lex_md5);
-    free( lex_md5 );
-    DBG("  pstrdup(lex_md5) completed");
-    STDCache->StdCache[STDCache->NextSlot].gmr_md5 = pstrdup(gmr_md5);
-    free( gmr_md5 );
-    DBG("  pstrdup(gmr_md5) completed");
-    MemoryContextSwitchTo(old_context);
-    DBG(" changed memory context to %p", (void*) old_context);
+    model = getModelPtr( path, &err_msg );
+    if (!model) {
+        elog(WARNING, "could not map address standardizer model \"%s\": %s", path, err_msg);
+        free(err_msg);
+        return NULL;
+    }
+    DBG("WriteSharedModel: compiled and mapped '%s'", path);
+    return model;
+}
 
-    STDCache->StdCache[STDCache->NextSlot].std = std;
-    STDCache->StdCache[STDCache->NextSlot].std_mcxt = STDMemoryContext;
-    STDCache->NextSlot = (STDCache->NextSlot + 1) % STD_CACHE_ITEMS;
-    DBG("STDCache->NextSlot=%d", STDCache->NextSlot);
+
+typedef struct
+{
+    char path[MAXPGPATH];
+    time_t mtime;
 }
+StdModelFile;
 
 
-/* pubilc api */
-StdCache
-GetStdCache(FunctionCallInfo fcinfo) {
-    return (StdCache) GetStdPortalCache(fcinfo);
+static int
+StdModelFileNewer(const void *a, const void *b)
+{
+    time_t ta = ((const StdModelFile *) a)->mtime;
+    time_t tb = ((const StdModelFile *) b)->mtime;
+
+    return ta > tb ? -1 : ta < tb ? 1 : 0;
 }
 
 
-static StdPortalCache *
-GetStdPortalCache(FunctionCallInfo fcinfo)
+/*
+ * remove all but the max_shared_models most recently used model files,
+ * counting keep, which is never removed. Removing a file does not affect a backend that has it
+ * mapped, the next backend to need it writes it again. Temporary files
+ * left by a crash are removed once they are old enough that no backend
+ * can still be writing them.
+ */
+static void
+PruneSharedModels(const char *keep)
 {
-    StdPortalCache *STDCache;
+    DIR              *dir;
+    struct dirent    *de;
+    struct stat       st;
+    StdModelFile     *files;
+    int               nfiles = 0;
+    int               allocated = 16;
+    int               kept = 1;
+    time_t            now = time(NULL);
+    int               i;
+
+    dir = AllocateDir(STD_MODEL_DIR);
+    if (!dir)
+        return;
+
+    files = (StdModelFile *) palloc(sizeof(StdModelFile) * allocated);
+    while ((de = ReadDir(dir, STD_MODEL_DIR)) != NULL) {
+        char path[MAXPGPATH];
+        int len = (int) strlen(de->d_name);
+
+        snprintf(path, MAXPGPATH, "%s/%s", STD_MODEL_DIR, de->d_name);
+        if (lstat(path, &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+
+        if (len > 4 && strcmp(de->d_name + len - 4, ".tmp") == 0) {
+            if (now - st.st_mtime > STD_MODEL_TMP_AGE)
+                unlink(path);
+            continue;
+        }
+        if (len <= 6 || strcmp(de->d_name + len - 6, ".model") != 0 ||
+                strcmp(path, keep) == 0)
+            continue;
 
-    DBG("Enter: GetStdPortalCache");
-    /* create it if we don't already have one for this portal */
-    if (fcinfo->flinfo->fn_extra == NULL) {
-        MemoryContext old_context;
-
-        old_context = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
-        STDCache = palloc(sizeof(StdPortalCache));
-        MemoryContextSwitchTo(old_context);
-
-        if (STDCache) {
-            int i;
-
-            DBG("Allocating STDCache for portal with STD MemoryContext (%p)", (void*) fcinfo->flinfo->fn_mcxt);
-            /* initial the cache items */
-            for (i=0; i<STD_CACHE_ITEMS; i++) {
-                STDCache->StdCache[i].lex_md5  = NULL;
-                STDCache->StdCache[i].gmr_md5  = NULL;
-                STDCache->StdCache[i].std      = NULL;
-                STDCache->StdCache[i].std_mcxt = NULL;
-            }
-            STDCache->NextSlot = 0;
-            STDCache->StdCacheContext = fcinfo->flinfo->fn_mcxt;
-
-            /* Store the pointer in fcinfo->flinfo->fn_extra */
-            fcinfo->flinfo->fn_extra = STDCache;
+        if (nfiles == allocated) {
+            allocated *= 2;
+            files = (StdModelFile *) repalloc(files, sizeof(StdModelFile) * allocated);
         }
+        strlcpy(files[nfiles].path, path, MAXPGPATH);
+        files[nfiles].mtime = st.st_mtime;
+        ++nfiles;
     }
-    else {
-        /* Use the existing cache */
-        STDCache = fcinfo->flinfo->fn_extra;
-    }
-
-    DBG("GetStdPortalCache: Using cache entry at (%p) in mcxt (%p)", (void*) STDCache, (void*)STDCache->StdCacheContext);
+    FreeDir(dir);
 
-    return STDCache;
+    qsort(files, nfiles, sizeof(StdModelFile), StdModelFileNewer);
+    for (i=0; i<nfiles; i++) {
+        if (kept < std_max_shared_models) {
+            ++kept;
+            continue;
+        }
+        DBG("PruneSharedModels: removing '%s'", files[i].path);
+        if (unlink(files[i].path) != 0 && errno != ENOENT)
+            elog(WARNING, "could not remove \"%s\": %m", files[i].path);
+    }
+    pfree(files);
 }
 
-/* public api */
-STANDARDIZER *
-GetStdUsingFCInfo(FunctionCallInfo fcinfo, char *lexicon, char *grammar)
-{
-    STANDARDIZER *std;
-    StdCache *std_cache = NULL;
 
-    DBG("GetStdUsingFCInfo: calling GetStdCache(fcinfo)");
-    std_cache = GetStdCache(fcinfo);
-    DBG("GetStdUsingFCInfo: got: (%p)", (void*)std_cache);
-    if (!std_cache)
-        return NULL;
+/* load the lexicon argument into std, a compiled one is used in place */
+static void
+LoadLexicon(STANDARDIZER *std, StdLexicon *lexicon)
+{
+    char             *err_msg = NULL;
+    char             *pmsg;
 
-    DBG("GetStdUsingFCInfo: calling IsInStdCache(std_cache, lexicon, grammar)");
-    if (!IsInStdCache(std_cache, lexicon, grammar)) {
-        DBG("GetStdUsingFCInfo: calling AddToStdCache(std_cache, lexicon, grammar)");
-        AddToStdCache(std_cache, lexicon, grammar);
+    if (lexicon->binary) {
+        DBG("Calling getModelPtrFromImage( lexicon, %lu )", lexicon->size);
+        std->model_obj = getModelPtrFromImage( lexicon->data, lexicon->size, &err_msg );
+        if (std->model_obj)
+            std->lex_obj = getModelLexiconPtr( std->model_obj );
     }
+    else {
+        DBG("Calling getLexiconPtr( lexicon, &err_msg )");
+        std->lex_obj = getLexiconPtr( lexicon->data, &err_msg );
+    }
+    DBG("Back from loading the lexicon (%p)", std->lex_obj);
 
-    DBG("GetStdUsingFCInfo: GetStdFromStdCache(std_cache, lexicon, grammar)");
-    std = GetStdFromStdCache(std_cache, lexicon, grammar);
-    DBG("GetStdUsingFCInfo: std=%p", std);
-
-    return std;
+    if (!std->lex_obj) {
+        std_free(std);
+        pmsg = pstrdup(err_msg);
+        free(err_msg);
+        elog(ERROR, "CreateStd: failed to load Lexicon (%s)", pmsg);
+    }
 }
 
 
 static STANDARDIZER *
-CreateStd(char *lexicon, char *grammar)
+CreateStd(StdLexicon *lexicon, char *grammar, char *lex_md5, char *gmr_md5)
 {
     STANDARDIZER     *std;
-    void             *lex;
     void             *gmr;
-    char            **err_msg = NULL;
+    void             *model;
+    char             *err_msg = NULL;
     char             *pmsg;
 
     DBG("Enter: CreateStd");
@@ -597,40 +882,60 @@ CreateStd(char *lexicon, char *grammar)
         elog(ERROR, "CreateStd: could not allocate memory (std)");
     DBG("CreateStd: std=%p", (void*)std);
 
+    /* a lexicon on its own is only used for parsing, keep it private */
+    if (std_shared_models && grammar[0] != '\0') {
+        std->model_obj = MapSharedModel( lex_md5, gmr_md5 );
+        if (std->model_obj) {
+            std->lex_obj = getModelLexiconPtr( std->model_obj );
+            std->shared = 1;
+            DBG("Returning shared model from CreateStd");
+            return std;
+        }
+    }
 
-    DBG("Calling getLexiconPtr( lexicon, err_msg )");
-    lex = getLexiconPtr( lexicon, err_msg );
-    DBG("Back from (%p) getLexiconPtr( lexicon, err_msg )", lex);
-    if (!lex) {
-        std_free(std);
-        SPI_finish();
-        pmsg = pstrdup(*err_msg);
-        free(*err_msg);
-        elog(ERROR, "CreateStd: failed to load Lexicon (%s)", pmsg);
+    LoadLexicon( std, lexicon );
+
+    /* parsing only needs the lexicon */
+    if (grammar[0] == '\0') {
+        DBG("Returning lexicon only from CreateStd");
+        return std;
     }
-    std->lex_obj = lex;
 
-    DBG("Calling getGrammarPtr( grammar, err_msg )");
-    gmr = getGrammarPtr( grammar, err_msg );
-    DBG("Back from (%p) getGrammarPtr( grammar, err_msg )", gmr);
+    DBG("Calling getGrammarPtr( grammar, &err_msg )");
+    gmr = getGrammarPtr( grammar, &err_msg );
+    DBG("Back from (%p) getGrammarPtr( grammar, &err_msg )", gmr);
     if (!gmr) {
-        freeLexiconPtr( lex );
         std_free(std);
-        SPI_finish();
-        pmsg = pstrdup(*err_msg);
-        free(*err_msg);
+        pmsg = pstrdup(err_msg);
+        free(err_msg);
         elog(ERROR, "CreateStd: failed to load Gammar (%s)", pmsg);
     }
     std->gmr_obj = gmr;
 
+    /* publish it for the other backends and use the shared copy too */
+    if (std_shared_models) {
+        model = WriteSharedModel( std->lex_obj, std->gmr_obj, lex_md5, gmr_md5 );
+        if (model) {
+            freeGrammarPtr( std->gmr_obj );
+            if (std->model_obj)
+                freeModelPtr( std->model_obj );
+            else
+                freeLexiconPtr( std->lex_obj );
+            std->model_obj = model;
+            std->lex_obj = getModelLexiconPtr( model );
+            std->gmr_obj = NULL;
+            std->shared = 1;
+        }
+    }
+
 #ifdef DEBUG
-    {
+    if (std->gmr_obj) {
     char             *md5hash;
     DBG("Fetching md5 hashes");
-    md5hash = getLexiconMd5( lex );
+    md5hash = getLexiconMd5( std->lex_obj );
     DBG("Lexicon md5: %s", md5hash);
     free(md5hash);
-    md5hash = getGrammarMd5( gmr );
+    md5hash = getGrammarMd5( std->gmr_obj );
     DBG("Grammar md5: %s", md5hash);
     free(md5hash);
     }
@@ -641,4 +946,3 @@ CreateStd(char *lexicon, char *grammar)
     return std;
 }
 
-
@@ -2,19 +2,88 @@
 
 #include "address_standardizer.h"
 
-/* Opaque type to use in standardizer cache API */
-typedef void *StdCache;
+/* an md5 as hex plus the trailing NUL */
+#define STD_MD5_SIZE 33
 
-StdCache GetStdCache(FunctionCallInfo fcinfo);
-bool IsInStdCache(StdCache STDCache, char *lexicon, char *grammar);
-void AddToStdCache(StdCache cache, char *lexicon, char *grammar);
-STANDARDIZER *GetStdFromStdCache(StdCache STDCache,  char *lexicon, char *grammar);
+/* the address_standardizer2.cache_size setting */
+extern int std_cache_size;
+
+/* the address_standardizer2.shared_models setting */
+extern bool std_shared_models;
+
+/* the address_standardizer2.max_shared_models setting */
+extern int std_max_shared_models;
+
+/* the address_standardizer2.instrument setting */
+extern bool std_instrument_on;
+
+/* the address_standardizer2.compact_lexicons setting */
+extern bool std_compact_lexicons_on;
+
+typedef struct
+{
+    int size;           /* cache_size setting */
+    int entries;        /* standardizers currently built */
+    int64 hits;
+    int64 misses;
+    int64 evictions;
+    int64 memory;       /* approximate bytes held by all entries */
+}
+StdCacheStats;
+
+typedef struct
+{
+    int slot;
+    char lex_md5[STD_MD5_SIZE];
+    char gmr_md5[STD_MD5_SIZE];
+    int64 hits;
+    double build_ms;    /* time taken to build the standardizer */
+    int64 memory;       /* approximate bytes it holds */
+    int64 idle;         /* cache lookups since it was last used */
+    bool shared;        /* uses a shared model file */
+}
+StdCacheEntryStats;
+
+/* register the cache settings, called from _PG_init() */
+void InitStdCache(void);
+
+/* counters for the backend's cache */
+void GetStdCacheStats(StdCacheStats *stats);
+
+/* a palloc'ed array describing each entry, returns the number of entries */
+int GetStdCacheEntryStats(StdCacheEntryStats **entries);
 
 /*
  * This is the only interface external code should be calling
  * it will get the standardizer out of the cache, or
  * it will create a new one and save it in the cache
+ *
+ * lex_arg and gmr_arg are the argument numbers of the lexicon and the
+ * grammar text, gmr_arg is -1 when no grammar is needed. The arguments
+ * are only detoasted and copied when they are not already cached.
+ * lex_binary is set when the lexicon is a compiled image from
+ * as_compile_lexicon_binary(), the bytea overloads are bound to their
+ * own C functions so this never depends on the call site.
 */
-STANDARDIZER *GetStdUsingFCInfo(FunctionCallInfo fcinfo, char *lexicon, char *grammar);
+STANDARDIZER *GetStdUsingFCInfo(FunctionCallInfo fcinfo, int lex_arg, int gmr_arg, bool lex_binary);
+
 
 
+/*
+ * Remembers which cache entry a call used, the generation tells us if
+ * the entry is still the one we found. Set slot to -1 before first use.
+ */
+typedef struct
+{
+    int slot;
+    uint64 generation;
+}
+StdCallCache;
+
+/*
+ * The same as GetStdUsingFCInfo() but the caller keeps the memo, for
+ * functions that need fn_extra for themselves such as set returning
+ * functions. The caller must reset call->slot to -1 whenever the
+ * lexicon or grammar arguments may have changed.
+ */
+STANDARDIZER *GetStdUsingCallCache(FunctionCallInfo fcinfo, StdCallCache *call, int lex_arg, int gmr_arg, bool lex_binary);
@@ -0,0 +1,187 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+// The following two defines are required by the Boost unit test framework
+// to create the necessary testing support. These defines must be placed
+// before the inclusion of the boost headers.
+//
+// The first define provides a name for our Boost test module.
+//
+// The second of these defines is used to indicate that we are building a
+// unit test module that will link dynamically with Boost. If you are using
+// a static library version of Boost, this define must be deleted. (or
+// in this case commented out)
+//
+// and include the test headers
+
+#define BOOST_TEST_MODULE AddressGeneratorTestModule
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include "addressgenerator.h"
+#include "grammar.h"
+#include "lexicon.h"
+#include "search.h"
+#include "tokenizer.h"
+
+// The two relevant Boost namespaces for the unit test framework are:
+using namespace boost;
+using namespace boost::unit_test;
+
+// Provide a name for our suite of tests. This statement is used to bracket
+// our test cases.
+BOOST_AUTO_TEST_SUITE(AddressGeneratorTestSuite)
+
+// The structure below allows us to pass a test initialization object to
+// each test case. Note the use of struct to default all methods and member
+// variables to public access.
+struct TestFixture
+{
+    TestFixture() : G( std::string( "good.grammar" ) ) {
+        // Put test initialization here, the constructor will be called
+        // prior to the execution of each test case
+        std::istringstream is(
+            "LEXICON:\tgenerator\tENG\ten_US\t0\n"
+            "LEXENTRY:\tSTREET\tST\tTYPE\tDETACH\n"
+            "LEXENTRY:\tAVENUE\tAVE\tTYPE\tDETACH\n"
+            "LEXENTRY:\tEXTENSION\tEXT\tQUALIF\tDETACH\n"
+            "LEXENTRY:\tOLD\tOLD\tQUALIF\tDETACH\n"
+            "LEXENTRY:\tOLD\tOLD\tWORD\tDETACH\n"
+            "LEXENTRY:\tHIGHWAY\tHWY\tROAD\tDETACH\n"
+            "LEXENTRY:\tRURAL ROUTE\tRR\tRR\tDETACH\n"
+            "LEXENTRY:\tHWY\tHWY\tROAD\tATT_SUF\n" );
+        lex.initialize( is );
+    }
+    ~TestFixture() {
+        // Put test cleanup here, the destructor will automatically be
+        // invoked at the end of each test case.
+        //printf("Cleanup test\n");
+    }
+    // Public test fixture variables are automatically available to all test
+    // cases. Don’t forget to initialize these variables in the constructors
+    // to avoid initialized variable errors.
+    
+    std::ostringstream os;
+
+    Grammar G;
+    Lexicon lex;
+
+    std::string classes( const std::vector<InClass::Type> &c ) {
+        std::string s;
+        for ( const auto &t : c )
+            s += ( s.empty() ? "" : " " ) + InClass::asString( t );
+        return s;
+    }
+
+};
+
+// Define a test case. The first argument specifies the name of the test.
+// Take some care in naming your tests. Do not reuse names or accidentally use
+// the same name for a test as specified for the module test suite name.
+//
+// The second argument provides a test build-up/tear-down object that is
+// responsible for creating and destroying any resources needed by the
+// unit test
+BOOST_FIXTURE_TEST_CASE(AddressGenerator_Rules, TestFixture)
+{
+    // the class sequences of the three alternatives of [ADDRESS]
+    std::set<std::string> accepted = {
+        "NUMBER WORD TYPE QUALIF ROAD RR",
+        "NUMBER WORD TYPE QUALIF ROAD",
+        "TYPE QUALIF ROAD RR"
+    };
+
+    AddressGenerator gen( G, lex, 7 );
+    std::set<std::string> seen;
+    std::vector<InClass::Type> c;
+    for ( int i = 0; i < 200; ++i ) {
+        std::string address = gen.next( &c );
+        BOOST_CHECK( accepted.count( classes( c ) ) == 1 );
+        seen.insert( classes( c ) );
+
+        // and the address parses back to a match
+        Tokenizer tokenizer( lex );
+        tokenizer.filter( InClass::asType( "PUNCT,SPACE" ) );
+        Search search( G );
+        BOOST_CHECK_MESSAGE( not search.search( tokenizer.getTokens( address ) ).empty(), address );
+    }
+    BOOST_CHECK_EQUAL( seen.size(), accepted.size() );
+}
+
+BOOST_FIXTURE_TEST_CASE(AddressGenerator_Seed, TestFixture)
+{
+    AddressGenerator a( G, lex, 42 );
+    AddressGenerator b( G, lex, 42 );
+    AddressGenerator c( G, lex, 43 );
+    bool differs = false;
+    for ( int i = 0; i < 50; ++i ) {
+        std::string x = a.next();
+        BOOST_CHECK_EQUAL( x, b.next() );
+        if ( x != c.next() )
+            differs = true;
+    }
+    BOOST_CHECK( differs );
+}
+
+BOOST_FIXTURE_TEST_CASE(AddressGenerator_Controls, TestFixture)
+{
+    std::vector<InClass::Type> c;
+
+    AddressGenerator longest( G, lex );
+    longest.minTokens( 6 );
+    for ( int i = 0; i < 20; ++i ) {
+        longest.next( &c );
+        BOOST_CHECK_EQUAL( classes( c ), "NUMBER WORD TYPE QUALIF ROAD RR" );
+    }
+
+    AddressGenerator shortest( G, lex );
+    shortest.maxTokens( 4 );
+    for ( int i = 0; i < 20; ++i ) {
+        shortest.next( &c );
+        BOOST_CHECK_EQUAL( classes( c ), "TYPE QUALIF ROAD RR" );
+    }
+
+    // OLD is the only word with two classes, HWY is only attached
+    AddressGenerator ambiguous( G, lex );
+    ambiguous.ambiguity( 1.0 );
+    AddressGenerator plain( G, lex );
+    for ( int i = 0; i < 20; ++i ) {
+        std::string a = ambiguous.next();
+        std::string p = plain.next();
+        BOOST_CHECK( a.find( "OLD" ) != std::string::npos );
+        BOOST_CHECK( p.find( "OLD" ) == std::string::npos );
+        BOOST_CHECK( a.find( "HWY" ) == std::string::npos );
+        BOOST_CHECK( p.find( "HWY" ) == std::string::npos );
+    }
+
+    AddressGenerator repeats( G, lex );
+    repeats.duplicates( 1.0 );
+    std::string first = repeats.next();
+    for ( int i = 0; i < 20; ++i )
+        BOOST_CHECK_EQUAL( repeats.next(), first );
+
+    AddressGenerator impossible( G, lex );
+    impossible.minTokens( 7 );
+    BOOST_CHECK_THROW( impossible.next(), std::runtime_error );
+}
+
+// This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
+// above and is used to bracket our test cases.
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,151 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+// The following two defines are required by the Boost unit test framework
+// to create the necessary testing support. These defines must be placed
+// before the inclusion of the boost headers.
+//
+// The first define provides a name for our Boost test module.
+//
+// The second of these defines is used to indicate that we are building a
+// unit test module that will link dynamically with Boost. If you are using
+// a static library version of Boost, this define must be deleted. (or
+// in this case commented out)
+//
+// and include the test headers
+
+#define BOOST_TEST_MODULE CompiledGrammarTestModule
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include "grammar.h"
+#include "compiledgrammar.h"
+
+// The two relevant Boost namespaces for the unit test framework are:
+using namespace boost;
+using namespace boost::unit_test;
+
+// Provide a name for our suite of tests. This statement is used to bracket
+// our test cases.
+BOOST_AUTO_TEST_SUITE(CompiledGrammarTestSuite)
+
+// The structure below allows us to pass a test initialization object to
+// each test case. Note the use of struct to default all methods and member
+// variables to public access.
+struct TestFixture
+{
+    TestFixture() {
+        // Put test initialization here, the constructor will be called
+        // prior to the execution of each test case
+        //printf("Initialize test\n");
+    }
+    ~TestFixture() {
+        // Put test cleanup here, the destructor will automatically be
+        // invoked at the end of each test case.
+        //printf("Cleanup test\n");
+    }
+    // Public test fixture variables are automatically available to all test
+    // cases. Don’t forget to initialize these variables in the constructors
+    // to avoid initialized variable errors.
+    
+    std::ostringstream os;
+
+};
+
+// Define a test case. The first argument specifies the name of the test.
+// Take some care in naming your tests. Do not reuse names or accidentally use
+// the same name for a test as specified for the module test suite name.
+//
+// The second argument provides a test build-up/tear-down object that is
+// responsible for creating and destroying any resources needed by the
+// unit test
+BOOST_FIXTURE_TEST_CASE(CompiledGrammar_Dump, TestFixture)
+{
+    // the compiled program should print exactly like the grammar
+    Grammar G( std::string("good.grammar") );
+    BOOST_REQUIRE( G.program() );
+
+    std::ostringstream expect;
+    expect << G;
+    os << *G.program();
+    BOOST_CHECK_EQUAL( os.str(), expect.str() );
+}
+
+BOOST_FIXTURE_TEST_CASE(CompiledGrammar_Layout, TestFixture)
+{
+    const char *text =
+        "[ADDRESS]\n"
+        "@HOUSE @STREET\n"
+        "@STREET\n"
+        "\n"
+        "[HOUSE]\n"
+        "NUMBER -> HOUSE -> 0.9\n"
+        "\n"
+        "[STREET]\n"
+        "WORD TYPE -> STREET SUFTYP -> 0.8\n"
+        "WORD -> STREET -> 0.3\n";
+
+    Grammar G( text );
+    auto cg = G.program();
+
+    BOOST_CHECK_EQUAL( cg->sectionCount(), 3u );
+    BOOST_CHECK_EQUAL( cg->ruleCount(), 3u );
+
+    // meta sections come first
+    auto addr = cg->find( "ADDRESS" );
+    BOOST_REQUIRE( addr != CompiledGrammar::NONE );
+    BOOST_CHECK_EQUAL( addr, 0u );
+    BOOST_CHECK( cg->section( addr ).kind == CompiledGrammar::META );
+    BOOST_CHECK_EQUAL( cg->section( addr ).count, 2u );
+
+    // references are resolved to section ids
+    const auto &alt = cg->alt( cg->section( addr ).first );
+    BOOST_CHECK_EQUAL( alt.count, 2u );
+    BOOST_CHECK_EQUAL( cg->refs( alt )[0], cg->find( "HOUSE" ) );
+    BOOST_CHECK_EQUAL( cg->refs( alt )[1], cg->find( "STREET" ) );
+
+    auto street = cg->find( "STREET" );
+    BOOST_REQUIRE( street != CompiledGrammar::NONE );
+    BOOST_CHECK( cg->section( street ).kind == CompiledGrammar::RULES );
+    BOOST_CHECK_EQUAL( cg->section( street ).count, 2u );
+
+    const auto &rd = cg->ruleDef( cg->section( street ).first );
+    BOOST_CHECK_EQUAL( rd.count, 2u );
+    BOOST_CHECK_CLOSE( rd.score, 0.8, 0.001 );
+    BOOST_CHECK_EQUAL( cg->in( rd )[0], static_cast<CompiledGrammar::Class>( InClass::WORD ) );
+    BOOST_CHECK_EQUAL( cg->out( rd )[1], static_cast<CompiledGrammar::Class>( OutClass::SUFTYP ) );
+
+    os << cg->rule( cg->section( street ).first );
+    BOOST_CHECK_EQUAL( os.str(), "WORD TYPE -> STREET SUFTYP -> 0.8" );
+
+    BOOST_CHECK( cg->find( "MISSING" ) == CompiledGrammar::NONE );
+}
+
+BOOST_FIXTURE_TEST_CASE(CompiledGrammar_Shared, TestFixture)
+{
+    // copies of a grammar share the same program
+    Grammar G( std::string("good.grammar") );
+    Grammar G2( G );
+    BOOST_CHECK( G.program() == G2.program() );
+}
+
+// This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
+// above and is used to bracket our test cases.
+
+BOOST_AUTO_TEST_SUITE_END()
+
@@ -0,0 +1,135 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+// The following two defines are required by the Boost unit test framework
+// to create the necessary testing support. These defines must be placed
+// before the inclusion of the boost headers.
+//
+// The first define provides a name for our Boost test module.
+//
+// The second of these defines is used to indicate that we are building a
+// unit test module that will link dynamically with Boost. If you are using
+// a static library version of Boost, this define must be deleted. (or
+// in this case commented out)
+//
+// and include the test headers
+
+#define BOOST_TEST_MODULE CounterTestModule
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include "counter.h"
+
+static Counter testEvents( "testEvents" );
+
+// The two relevant Boost namespaces for the unit test framework are:
+using namespace boost;
+using namespace boost::unit_test;
+
+// Provide a name for our suite of tests. This statement is used to bracket
+// our test cases.
+BOOST_AUTO_TEST_SUITE(CounterTestSuite)
+
+// The structure below allows us to pass a test initialization object to
+// each test case. Note the use of struct to default all methods and member
+// variables to public access.
+struct TestFixture
+{
+    TestFixture() {
+        // Put test initialization here, the constructor will be called
+        // prior to the execution of each test case
+        //printf("Initialize test\n");
+    }
+    ~TestFixture() {
+        // Put test cleanup here, the destructor will automatically be
+        // invoked at the end of each test case.
+        //printf("Cleanup test\n");
+    }
+    // Public test fixture variables are automatically available to all test
+    // cases. Don’t forget to initialize these variables in the constructors
+    // to avoid initialized variable errors.
+    
+    std::ostringstream os;
+
+};
+
+// Define a test case. The first argument specifies the name of the test.
+// Take some care in naming your tests. Do not reuse names or accidentally use
+// the same name for a test as specified for the module test suite name.
+//
+// The second argument provides a test build-up/tear-down object that is
+// responsible for creating and destroying any resources needed by the
+// unit test
+BOOST_FIXTURE_TEST_CASE(Counter_Basic, TestFixture)
+{
+    testEvents.clear();
+    BOOST_CHECK_EQUAL( testEvents.value(), 0u );
+    BOOST_CHECK_EQUAL( testEvents.name(), "testEvents" );
+
+    testEvents.add();
+    testEvents.add( 4 );
+    BOOST_CHECK_EQUAL( testEvents.value(), 5u );
+    BOOST_CHECK_EQUAL( Counter::get( "testEvents" ), 5u );
+
+    Counter::clear( "testEvents" );
+    BOOST_CHECK_EQUAL( testEvents.value(), 0u );
+
+    // unknown names read as zero
+    BOOST_CHECK_EQUAL( Counter::get( "noSuchCounter" ), 0u );
+    Counter::clear( "noSuchCounter" );
+}
+
+BOOST_FIXTURE_TEST_CASE(Counter_Registry, TestFixture)
+{
+    auto names = Counter::names();
+    BOOST_CHECK( std::find( names.begin(), names.end(), "testEvents" ) != names.end() );
+
+    // the counters in the library are registered before main()
+    BOOST_CHECK( std::find( names.begin(), names.end(), "findMetas" ) != names.end() );
+    BOOST_CHECK( std::find( names.begin(), names.end(), "findRules" ) != names.end() );
+
+    {
+        Counter local( "localEvents" );
+        local.add( 3 );
+        BOOST_CHECK_EQUAL( Counter::get( "localEvents" ), 3u );
+    }
+    // and a counter that is gone is no longer found
+    BOOST_CHECK_EQUAL( Counter::get( "localEvents" ), 0u );
+}
+
+BOOST_FIXTURE_TEST_CASE(Counter_Threads, TestFixture)
+{
+    testEvents.clear();
+
+    // more threads than shards so some of them share a slot
+    std::vector<std::thread> threads;
+    for ( int t = 0; t < Counter::SHARDS + 4; ++t )
+        threads.push_back( std::thread( []() {
+            for ( int i = 0; i < 10000; ++i )
+                testEvents.add();
+        } ) );
+    for ( auto &t : threads )
+        t.join();
+
+    BOOST_CHECK_EQUAL( testEvents.value(), 10000u * ( Counter::SHARDS + 4 ) );
+}
+
+// This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
+// above and is used to bracket our test cases.
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,212 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+// The following two defines are required by the Boost unit test framework
+// to create the necessary testing support. These defines must be placed
+// before the inclusion of the boost headers.
+//
+// The first define provides a name for our Boost test module.
+//
+// The second of these defines is used to indicate that we are building a
+// unit test module that will link dynamically with Boost. If you are using
+// a static library version of Boost, this define must be deleted. (or
+// in this case commented out)
+//
+// and include the test headers
+
+#define BOOST_TEST_MODULE FstLexiconStoreTestModule
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include "lexicon.h"
+#include "fstlexiconstore.h"
+#include "address_standardizer.h"
+
+// The two relevant Boost namespaces for the unit test framework are:
+using namespace boost;
+using namespace boost::unit_test;
+
+// Provide a name for our suite of tests. This statement is used to bracket
+// our test cases.
+BOOST_AUTO_TEST_SUITE(FstLexiconStoreTestSuite)
+
+// The structure below allows us to pass a test initialization object to
+// each test case. Note the use of struct to default all methods and member
+// variables to public access.
+struct TestFixture
+{
+    TestFixture() {
+        // Put test initialization here, the constructor will be called
+        // prior to the execution of each test case
+        //printf("Initialize test\n");
+    }
+    ~TestFixture() {
+        // Put test cleanup here, the destructor will automatically be
+        // invoked at the end of each test case.
+        //printf("Cleanup test\n");
+    }
+    // Public test fixture variables are automatically available to all test
+    // cases. Don’t forget to initialize these variables in the constructors
+    // to avoid initialized variable errors.
+    
+    std::ostringstream os;
+
+};
+
+// Define a test case. The first argument specifies the name of the test.
+// Take some care in naming your tests. Do not reuse names or accidentally use
+// the same name for a test as specified for the module test suite name.
+//
+// The second argument provides a test build-up/tear-down object that is
+// responsible for creating and destroying any resources needed by the
+// unit test
+BOOST_FIXTURE_TEST_CASE(FstLexiconStore_Find, TestFixture)
+{
+    FstLexiconStore fst;
+    fst.add( "ALLEY", { LexEntry( "ALLEY", "ALY", "TYPE", "DET_SUF" ) } );
+    fst.add( "AVE", { LexEntry( "AVE", "AVE", "TYPE", "" ),
+                      LexEntry( "AVE", "AVENUE", "WORD", "" ) } );
+    fst.add( "AVENUE", { LexEntry( "AVENUE", "AVE", "TYPE", "" ) } );
+    fst.add( "VALLEY", { LexEntry( "VALLEY", "VLY", "TYPE", "DET_SUF" ) } );
+    fst.finish();
+
+    BOOST_CHECK( fst.size() == 4 );
+
+    std::vector<LexEntry> entries;
+    BOOST_CHECK( fst.find( "AVE", entries ) );
+    BOOST_CHECK( entries.size() == 2 );
+    os << entries[0] << "\n" << entries[1];
+    BOOST_CHECK( os.str() == "LEXENTRY:\tAVE\tAVE\tTYPE\t\nLEXENTRY:\tAVE\tAVENUE\tWORD\t" );
+
+    entries.clear();
+    BOOST_CHECK( fst.find( "VALLEY", entries ) );
+    BOOST_CHECK( entries.size() == 1 and entries[0].stdword() == "VLY"
+                 and entries[0].isSuffix() );
+
+    entries.clear();
+    BOOST_CHECK( not fst.find( "AV", entries ) );
+    BOOST_CHECK( not fst.find( "AVENUES", entries ) );
+    BOOST_CHECK( not fst.find( "", entries ) );
+    BOOST_CHECK( entries.empty() );
+
+    // ALLEY and VALLEY share the states of their LLEY suffix
+    BOOST_CHECK( fst.states() < 1 + 5 + 5 + 3 );
+
+    // forEach returns the keys in order with their entries
+    os.str( "" );
+    fst.forEach( [this]( const std::string &key, const std::vector<LexEntry> &les ) {
+        os << key << ":" << les.size() << " ";
+    } );
+    BOOST_CHECK( os.str() == "ALLEY:1 AVE:2 AVENUE:1 VALLEY:1 " );
+}
+
+BOOST_FIXTURE_TEST_CASE(FstLexiconStore_Errors, TestFixture)
+{
+    FstLexiconStore fst;
+    fst.add( "B", { LexEntry( "B", "B", "WORD", "" ) } );
+    BOOST_CHECK_THROW( fst.add( "A", { LexEntry( "A", "A", "WORD", "" ) } ), std::runtime_error );
+    BOOST_CHECK_THROW( fst.add( "B", { LexEntry( "B", "B", "WORD", "" ) } ), std::runtime_error );
+    BOOST_CHECK_THROW( fst.add( "C", { LexEntry( "D", "D", "WORD", "" ) } ), std::runtime_error );
+}
+
+BOOST_FIXTURE_TEST_CASE(FstLexiconStore_Compact, TestFixture)
+{
+    Lexicon lex( "lex-test", std::string("lex-test.txt") );
+    os << lex;
+    std::string before = os.str();
+    std::string regex = lex.regex();
+    long unsigned int size = lex.size();
+
+    lex.compact();
+    BOOST_CHECK( lex.isReadOnly() );
+    os.str( "" );
+    os << lex;
+    BOOST_CHECK( os.str() == before );
+    BOOST_CHECK( lex.regex() == regex );
+    BOOST_CHECK( lex.find( "ALLEY" ).size() == 1 );
+    BOOST_CHECK( lex.find( "ALLEY" )[0].stdword() == "ALY" );
+
+    // modifying it copies the entries back into the map
+    lex.insert( LexEntry( "ZZ", "ZZ", "WORD", "" ) );
+    BOOST_CHECK( not lex.isReadOnly() );
+    BOOST_CHECK( lex.size() == size + 1 );
+}
+
+BOOST_FIXTURE_TEST_CASE(FstLexiconStore_Standardize, TestFixture)
+{
+    std::ifstream lf( "../../data/sample/usa.lex" );
+    std::string ltext( ( std::istreambuf_iterator<char>( lf ) ), std::istreambuf_iterator<char>() );
+    std::ifstream gf( "../../data/sample/usa.gmr" );
+    std::string gtext( ( std::istreambuf_iterator<char>( gf ) ), std::istreambuf_iterator<char>() );
+    BOOST_REQUIRE( not ltext.empty() and not gtext.empty() );
+
+    char *err = NULL;
+    void *gmr = getGrammarPtr( &gtext[0], &err );
+    BOOST_REQUIRE( gmr );
+    void *lex = getLexiconPtr( &ltext[0], &err );
+    BOOST_REQUIRE( lex );
+    std_compact_lexicons( 1 );
+    void *fst = getLexiconPtr( &ltext[0], &err );
+    std_compact_lexicons( 0 );
+    BOOST_REQUIRE( fst );
+    BOOST_CHECK( not static_cast<Lexicon*>( lex )->isReadOnly() );
+    BOOST_CHECK( static_cast<Lexicon*>( fst )->isReadOnly() );
+
+    // both lexicons standardize every address the same
+    auto standardize = [&]( const char *address, void *lexicon ) {
+        std::string a( address );
+        char locale[] = "en_US";
+        char filter[] = "PUNCT,SPACE,EMDASH";
+        STDADDR *sa = std_standardize_ptrs( &a[0], gmr, lexicon, locale, filter, &err );
+        BOOST_REQUIRE( sa );
+        char **f[] = { &sa->building, &sa->house_num, &sa->predir, &sa->qual,
+                       &sa->pretype, &sa->name, &sa->suftype, &sa->sufdir,
+                       &sa->ruralroute, &sa->extra, &sa->city, &sa->prov,
+                       &sa->country, &sa->postcode, &sa->box, &sa->unit,
+                       &sa->pattern };
+        std::string out;
+        for ( auto p : f ) {
+            out += std::string( *p ? *p : "" ) + "|";
+            free( *p );
+        }
+        free( sa );
+        return out;
+    };
+
+    const char *addresses[] = {
+        "11 Oak Street Ext, Boston, MA 02101",
+        "123 North Main St Apt 4, Springfield, IL 62701",
+        "PO Box 1234, Anytown, NY 12345",
+        "1600 Pennsylvania Ave NW, Washington, DC 20500"
+    };
+    for ( auto a : addresses ) {
+        std::string want = standardize( a, lex );
+        BOOST_CHECK( want.find( " -> " ) != std::string::npos );
+        BOOST_CHECK_EQUAL( standardize( a, fst ), want );
+    }
+
+    freeLexiconPtr( fst );
+    freeLexiconPtr( lex );
+    freeGrammarPtr( gmr );
+}
+
+// This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
+// above and is used to bracket our test cases.
+
+BOOST_AUTO_TEST_SUITE_END()
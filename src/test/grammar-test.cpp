@@ -30,8 +30,11 @@
 #include <boost/test/unit_test.hpp>
 
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <stdexcept>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
 #include "grammar.h"
 
 // The two relevant Boost namespaces for the unit test framework are:
@@ -123,6 +126,90 @@ BOOST_FIXTURE_TEST_CASE(Grammar_Good, TestFixture)
     BOOST_CHECK(os.str() == expect);
 }
 
+BOOST_FIXTURE_TEST_CASE(Grammar_Layout, TestFixture)
+{
+    // a byte order mark, comments, unicode spaces around headers and
+    // metas, and meta references written without spaces between them
+    std::istringstream is(
+        "\xEF\xBB\xBF# leading comment\n"
+        "\t[ADDRESS]\xE3\x80\x80\n"
+        "   \n"
+        "@AB@CD\n"
+        "\t@AB \n"
+        "[AB]\n"
+        "  # indented comment\n"
+        "NUMBER WORD -> BLDNG HOUSE -> 0.5\n"
+        "[CD]\n"
+        "TYPE -> SUFTYP -> 0.5\n" );
+    Grammar G( is );
+    BOOST_CHECK(G.status() == Grammar::CHECK_OK);
+
+    os.str("");
+    os << G;
+    std::string expect =
+        "[ADDRESS]\n"
+        "@AB @CD\n"
+        "@AB\n\n"
+        "[AB]\n"
+        "NUMBER WORD -> BLDNG HOUSE -> 0.5\n\n"
+        "[CD]\n"
+        "TYPE -> SUFTYP -> 0.5\n\n";
+    BOOST_CHECK(os.str() == expect);
+
+    std::istringstream mixed( "[A]\n@B\nNUMBER -> HOUSE -> 0.5\n" );
+    BOOST_CHECK_THROW( Grammar M( mixed ), std::runtime_error );
+    std::istringstream dup( "[A]\nNUMBER -> HOUSE -> 0.5\n[A]\n" );
+    BOOST_CHECK_THROW( Grammar D( dup ), std::runtime_error );
+}
+
+BOOST_FIXTURE_TEST_CASE(Grammar_Archive, TestFixture)
+{
+    // [XY] is not referenced so the grammar only warns
+    std::istringstream is(
+        "[ADDRESS]\n"
+        "@AB @CD\n"
+        "@CD\n"
+        "[AB]\n"
+        "NUMBER WORD -> BLDNG HOUSE -> 0.5\n"
+        "NUMBER -> HOUSE -> 0.25\n"
+        "[CD]\n"
+        "TYPE -> SUFTYP -> 0.5\n"
+        "[XY]\n"
+        "@AB\n" );
+    Grammar G( is );
+    BOOST_CHECK(G.status() == Grammar::CHECK_WARN);
+
+    std::ostringstream archive;
+    {
+        boost::archive::text_oarchive oa( archive );
+        oa << G;
+    }
+
+    Grammar L;
+    std::istringstream ia_is( archive.str() );
+    {
+        boost::archive::text_iarchive ia( ia_is );
+        ia >> L;
+    }
+
+    std::ostringstream expect;
+    expect << G;
+    os.str("");
+    os << L;
+    BOOST_CHECK(os.str() == expect.str());
+    BOOST_CHECK(std::string( L.getMd5() ) == G.getMd5());
+    BOOST_CHECK(L.status() == G.status());
+    BOOST_CHECK(L.issues() == G.issues());
+    BOOST_CHECK(L.program() != nullptr);
+
+    // a truncated archive must not load
+    std::string cut = archive.str();
+    cut.resize( cut.size() / 2 );
+    std::istringstream bad( cut );
+    Grammar B;
+    BOOST_CHECK_THROW( { boost::archive::text_iarchive ia( bad ); ia >> B; }, std::exception );
+}
+
 // This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
 // above and is used to bracket our test cases.
 
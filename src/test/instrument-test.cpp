@@ -0,0 +1,271 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+// The following two defines are required by the Boost unit test framework
+// to create the necessary testing support. These defines must be placed
+// before the inclusion of the boost headers.
+//
+// The first define provides a name for our Boost test module.
+//
+// The second of these defines is used to indicate that we are building a
+// unit test module that will link dynamically with Boost. If you are using
+// a static library version of Boost, this define must be deleted. (or
+// in this case commented out)
+//
+// and include the test headers
+
+#define BOOST_TEST_MODULE InstrumentTestModule
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include "instrument.h"
+
+// The two relevant Boost namespaces for the unit test framework are:
+using namespace boost;
+using namespace boost::unit_test;
+
+// Provide a name for our suite of tests. This statement is used to bracket
+// our test cases.
+BOOST_AUTO_TEST_SUITE(InstrumentTestSuite)
+
+// The structure below allows us to pass a test initialization object to
+// each test case. Note the use of struct to default all methods and member
+// variables to public access.
+struct TestFixture
+{
+    TestFixture() {
+        // Put test initialization here, the constructor will be called
+        // prior to the execution of each test case
+        //printf("Initialize test\n");
+    }
+    ~TestFixture() {
+        // Put test cleanup here, the destructor will automatically be
+        // invoked at the end of each test case.
+        //printf("Cleanup test\n");
+    }
+    // Public test fixture variables are automatically available to all test
+    // cases. Don’t forget to initialize these variables in the constructors
+    // to avoid initialized variable errors.
+    
+    std::ostringstream os;
+
+};
+
+// Define a test case. The first argument specifies the name of the test.
+// Take some care in naming your tests. Do not reuse names or accidentally use
+// the same name for a test as specified for the module test suite name.
+//
+// The second argument provides a test build-up/tear-down object that is
+// responsible for creating and destroying any resources needed by the
+// unit test
+BOOST_FIXTURE_TEST_CASE(Instrument_Buckets, TestFixture)
+{
+    typedef Instrument::Histogram H;
+
+    // small values have a bucket each
+    for ( uint64_t v = 0; v < 8; ++v ) {
+        BOOST_CHECK_EQUAL( H::bucket( v ), static_cast<int>( v ) );
+        BOOST_CHECK_EQUAL( H::lower( H::bucket( v ) ), v );
+        BOOST_CHECK_EQUAL( H::upper( H::bucket( v ) ), v );
+    }
+
+    // every value falls inside its bucket and the buckets are contiguous
+    for ( uint64_t v = 1; v < 100000; v = v * 3 / 2 + 1 ) {
+        int b = H::bucket( v );
+        BOOST_CHECK( H::lower( b ) <= v );
+        BOOST_CHECK( v <= H::upper( b ) );
+        BOOST_CHECK_EQUAL( H::lower( b + 1 ), H::upper( b ) + 1 );
+    }
+
+    BOOST_CHECK_EQUAL( H::bucket( 8 ), 8 );
+    BOOST_CHECK_EQUAL( H::bucket( 15 ), 15 );
+    BOOST_CHECK_EQUAL( H::bucket( 16 ), 16 );
+    BOOST_CHECK_EQUAL( H::upper( 16 ), 17u );
+    BOOST_CHECK_EQUAL( H::bucket( ~static_cast<uint64_t>( 0 ) ), H::BUCKETS - 1 );
+}
+
+BOOST_FIXTURE_TEST_CASE(Instrument_Percentile, TestFixture)
+{
+    Instrument::Histogram h;
+    BOOST_CHECK_EQUAL( h.count(), 0u );
+    BOOST_CHECK_EQUAL( h.percentile( 50.0 ), 0.0 );
+
+    for ( uint64_t v = 1; v <= 100; ++v )
+        h.add( v );
+    BOOST_CHECK_EQUAL( h.count(), 100u );
+    BOOST_CHECK_EQUAL( h.sum(), 5050u );
+    BOOST_CHECK_CLOSE( h.mean(), 50.5, 0.001 );
+
+    // within the resolution of the buckets
+    BOOST_CHECK_CLOSE( h.percentile( 50.0 ), 50.0, 7.0 );
+    BOOST_CHECK_CLOSE( h.percentile( 90.0 ), 90.0, 7.0 );
+    BOOST_CHECK_CLOSE( h.max(), 100.0, 7.0 );
+    BOOST_CHECK_EQUAL( h.percentile( 0.0 ), 1.0 );
+}
+
+BOOST_FIXTURE_TEST_CASE(Instrument_Record, TestFixture)
+{
+    // nothing is recorded while it is off
+    Instrument::enable( false );
+    Instrument::reset();
+    {
+        Instrument::Address address;
+        Instrument::Timer timer( Instrument::SEARCH );
+        Instrument::count( Instrument::RULES, 5 );
+        BOOST_CHECK( Instrument::current() == NULL );
+    }
+    BOOST_CHECK_EQUAL( Instrument::stage( Instrument::SEARCH ).count(), 0u );
+    BOOST_CHECK_EQUAL( Instrument::stage( Instrument::TOTAL ).count(), 0u );
+    BOOST_CHECK_EQUAL( Instrument::counter( Instrument::RULES ).count(), 0u );
+
+    Instrument::enable( true );
+    for ( int i = 0; i < 3; ++i ) {
+        Instrument::Address address;
+        BOOST_CHECK( Instrument::current() == &address );
+        Instrument::Timer timer( Instrument::SEARCH );
+        timer.stop();
+        timer.stop();   // only recorded once
+        Instrument::count( Instrument::RULES, 5 );
+        Instrument::count( Instrument::RULES, 2 );
+        BOOST_CHECK_EQUAL( address.counter( Instrument::RULES ), 7u );
+    }
+    BOOST_CHECK( Instrument::current() == NULL );
+    BOOST_CHECK_EQUAL( Instrument::stage( Instrument::SEARCH ).count(), 3u );
+    BOOST_CHECK_EQUAL( Instrument::stage( Instrument::TOTAL ).count(), 3u );
+    BOOST_CHECK_EQUAL( Instrument::counter( Instrument::RULES ).count(), 3u );
+    BOOST_CHECK_EQUAL( Instrument::counter( Instrument::RULES ).sum(), 21u );
+    BOOST_CHECK_EQUAL( Instrument::counter( Instrument::PATHS ).sum(), 0u );
+
+    Instrument::report( os );
+    BOOST_CHECK( os.str().find( "search us" ) != std::string::npos );
+    BOOST_CHECK( os.str().find( "rules" ) != std::string::npos );
+    BOOST_CHECK( os.str().find( "split us" ) == std::string::npos );
+
+    Instrument::reset();
+    BOOST_CHECK_EQUAL( Instrument::stage( Instrument::SEARCH ).count(), 0u );
+    BOOST_CHECK_EQUAL( Instrument::counter( Instrument::RULES ).sum(), 0u );
+    Instrument::enable( false );
+}
+
+BOOST_FIXTURE_TEST_CASE(Instrument_Threads, TestFixture)
+{
+    Instrument::enable( true );
+    Instrument::reset();
+    {
+        Instrument::Address address;
+
+        // work done on other threads is charged to the address and
+        // their samples are added to those of this thread
+        std::thread a( [&address]() {
+            Instrument::Attach attach( &address );
+            Instrument::Timer timer( Instrument::RECLASS );
+            Instrument::count( Instrument::PATHS, 10 );
+        } );
+        std::thread b( [&address]() {
+            Instrument::Attach attach( &address );
+            Instrument::Timer timer( Instrument::RECLASS );
+            Instrument::count( Instrument::PATHS, 20 );
+        } );
+        a.join();
+        b.join();
+        BOOST_CHECK_EQUAL( address.counter( Instrument::PATHS ), 30u );
+    }
+    BOOST_CHECK_EQUAL( Instrument::stage( Instrument::RECLASS ).count(), 2u );
+    BOOST_CHECK_EQUAL( Instrument::counter( Instrument::PATHS ).count(), 1u );
+    BOOST_CHECK_EQUAL( Instrument::counter( Instrument::PATHS ).sum(), 30u );
+
+    // the blocks of threads that have exited are reused
+    std::thread c( []() {
+        Instrument::Timer timer( Instrument::RECLASS );
+    } );
+    c.join();
+    BOOST_CHECK_EQUAL( Instrument::stage( Instrument::RECLASS ).count(), 3u );
+    Instrument::enable( false );
+}
+
+BOOST_FIXTURE_TEST_CASE(Instrument_Always, TestFixture)
+{
+    // an address made with always collects its own figures while
+    // instrumentation is off and leaves the histograms alone
+    Instrument::enable( false );
+    Instrument::reset();
+    {
+        Instrument::Address address( true );
+        BOOST_CHECK( Instrument::current() == &address );
+        {
+            Instrument::Timer timer( Instrument::SEARCH );
+            Instrument::count( Instrument::PATHS, 4 );
+        }
+        {
+            Instrument::Timer timer( Instrument::SEARCH );
+        }
+        BOOST_CHECK_EQUAL( address.counter( Instrument::PATHS ), 4u );
+        BOOST_CHECK( address.nanos( Instrument::SEARCH ) > 0u );
+        BOOST_CHECK_EQUAL( address.nanos( Instrument::SPLIT ), 0u );
+        BOOST_CHECK( address.nanos( Instrument::TOTAL ) >= address.nanos( Instrument::SEARCH ) );
+    }
+    BOOST_CHECK( Instrument::current() == NULL );
+    BOOST_CHECK_EQUAL( Instrument::stage( Instrument::SEARCH ).count(), 0u );
+    BOOST_CHECK_EQUAL( Instrument::stage( Instrument::TOTAL ).count(), 0u );
+    BOOST_CHECK_EQUAL( Instrument::counter( Instrument::PATHS ).count(), 0u );
+
+    // a plain one still costs nothing while it is off
+    Instrument::Address plain;
+    BOOST_CHECK( Instrument::current() == NULL );
+    BOOST_CHECK_EQUAL( plain.nanos( Instrument::TOTAL ), 0u );
+}
+
+BOOST_FIXTURE_TEST_CASE(Instrument_Perf, TestFixture)
+{
+    // the perf counters are only read when both are on
+    Instrument::enable( true );
+    Instrument::perf( false );
+    Instrument::reset();
+    {
+        Instrument::Timer timer( Instrument::TOKENIZE );
+    }
+    BOOST_CHECK_EQUAL( Instrument::perfSamples( Instrument::TOKENIZE ), 0u );
+
+    // the samples are counted even when the host has no counters, the
+    // events it lacks read as zero
+    Instrument::perf( true );
+    for ( int i = 0; i < 2; ++i ) {
+        Instrument::Timer timer( Instrument::TOKENIZE );
+    }
+    BOOST_CHECK_EQUAL( Instrument::perfSamples( Instrument::TOKENIZE ), 2u );
+    BOOST_CHECK_EQUAL( Instrument::perfSamples( Instrument::SEARCH ), 0u );
+    const PerfCounters &pc = PerfCounters::thread();
+    for ( int e = 0; e < PerfCounters::EVENTS; ++e ) {
+        auto ev = static_cast<PerfCounters::Event>( e );
+        if ( not pc.available( ev ) )
+            BOOST_CHECK_EQUAL( Instrument::perfMean( Instrument::TOKENIZE, ev ), 0.0 );
+    }
+
+    Instrument::report( os );
+    BOOST_CHECK( os.str().find( "instructions" ) != std::string::npos );
+
+    Instrument::reset();
+    BOOST_CHECK_EQUAL( Instrument::perfSamples( Instrument::TOKENIZE ), 0u );
+    BOOST_CHECK_EQUAL( Instrument::perfMean( Instrument::TOKENIZE, PerfCounters::CYCLES ), 0.0 );
+    Instrument::perf( false );
+    Instrument::enable( false );
+}
+
+// This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
+// above and is used to bracket our test cases.
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -33,6 +33,7 @@
 #include "lexentry.h"
 #include "token.h"
 #include "lexicon.h"
+#include "threadpool.h"
 
 // The two relevant Boost namespaces for the unit test framework are:
 using namespace boost;
@@ -224,6 +225,64 @@ BOOST_FIXTURE_TEST_CASE(Lexicon_mutators_test1, TestFixture)
 
 }
 
+BOOST_FIXTURE_TEST_CASE(Lexicon_ParallelLoad, TestFixture)
+{
+    // enough entries for several batches, with keys repeated across
+    // batches so the merge order shows up in the entries of a key
+    std::ostringstream text;
+    text << "LEXICON:\tparallel\tENG\ten_US\t0\n";
+    for ( int i = 0; i < 6000; ++i ) {
+        text << "LEXENTRY:\tword" << i % 2500 << "\tstd" << i << "\t"
+             << ( i % 3 ? "WORD" : "TYPE" ) << "\t"
+             << ( i % 7 ? "" : ( i % 2 ? "ATT_PRE" : "ATT_SUF" ) ) << "\n";
+    }
+
+    ThreadPool pool( 3 );
+    std::istringstream is1( text.str() );
+    std::istringstream is2( text.str() );
+    Lexicon serial( "lexicon", is1 );
+    Lexicon parallel( "lexicon", is2, &pool );
+
+    std::ostringstream os1;
+    std::ostringstream os2;
+    os1 << serial;
+    os2 << parallel;
+    BOOST_CHECK( os1.str() == os2.str() );
+    BOOST_CHECK( std::string( serial.getMd5() ) == parallel.getMd5() );
+
+    // compile() builds the same regexes as building them one at a time
+    parallel.compile( &pool );
+    BOOST_CHECK( serial.regex() == parallel.regex() );
+    BOOST_CHECK( serial.regexPrefixAtt() == parallel.regexPrefixAtt() );
+    BOOST_CHECK( serial.regexSuffixAtt() == parallel.regexSuffixAtt() );
+    BOOST_CHECK( parallel.regexPrefixAtt() != "^\\B" );
+
+    // the first bad entry in the file is reported whichever batch
+    // finishes first
+    std::string bad = text.str();
+    bad.replace( bad.find( "\tstd5000\t" ), 9, "\tstd5000\tFOO" );
+    bad.replace( bad.find( "\tstd100\t" ), 8, "\tstd100\tFOO" );
+    std::string serialError;
+    std::string parallelError;
+    try {
+        std::istringstream is( bad );
+        Lexicon lex( "bad", is );
+    }
+    catch ( std::runtime_error &e ) {
+        serialError = e.what();
+    }
+    try {
+        std::istringstream is( bad );
+        Lexicon lex( "bad", is, &pool );
+    }
+    catch ( std::runtime_error &e ) {
+        parallelError = e.what();
+    }
+    BOOST_CHECK( serialError.find( "Lexicon-Invalid-LexEntry: " ) == 0 );
+    BOOST_CHECK( serialError.find( "STD100" ) != std::string::npos );
+    BOOST_CHECK( serialError == parallelError );
+}
+
 // This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
 // above and is used to bracket our test cases.
 
@@ -0,0 +1,211 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+// The following two defines are required by the Boost unit test framework
+// to create the necessary testing support. These defines must be placed
+// before the inclusion of the boost headers.
+//
+// The first define provides a name for our Boost test module.
+//
+// The second of these defines is used to indicate that we are building a
+// unit test module that will link dynamically with Boost. If you are using
+// a static library version of Boost, this define must be deleted. (or
+// in this case commented out)
+//
+// and include the test headers
+
+#define BOOST_TEST_MODULE ModelFileTestModule
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include "lexicon.h"
+#include "grammar.h"
+#include "modelfile.h"
+
+// The two relevant Boost namespaces for the unit test framework are:
+using namespace boost;
+using namespace boost::unit_test;
+
+// Provide a name for our suite of tests. This statement is used to bracket
+// our test cases.
+BOOST_AUTO_TEST_SUITE(ModelFileTestSuite)
+
+// The structure below allows us to pass a test initialization object to
+// each test case. Note the use of struct to default all methods and member
+// variables to public access.
+struct TestFixture
+{
+    TestFixture() {
+        // Put test initialization here, the constructor will be called
+        // prior to the execution of each test case
+        //printf("Initialize test\n");
+    }
+    ~TestFixture() {
+        // Put test cleanup here, the destructor will automatically be
+        // invoked at the end of each test case.
+        //printf("Cleanup test\n");
+    }
+    // Public test fixture variables are automatically available to all test
+    // cases. Don’t forget to initialize these variables in the constructors
+    // to avoid initialized variable errors.
+    
+    std::ostringstream os;
+
+};
+
+// Define a test case. The first argument specifies the name of the test.
+// Take some care in naming your tests. Do not reuse names or accidentally use
+// the same name for a test as specified for the module test suite name.
+//
+// The second argument provides a test build-up/tear-down object that is
+// responsible for creating and destroying any resources needed by the
+// unit test
+BOOST_FIXTURE_TEST_CASE(ModelFile_RoundTrip, TestFixture)
+{
+    Lexicon lex( "lex-test", std::string("lex-test.txt") );
+    Grammar G( std::string("good.grammar") );
+
+    std::ostringstream image;
+    ModelFile::write( image, lex, G );
+    std::string bytes = image.str();
+
+    ModelFile model( bytes.data(), bytes.size() );
+    Lexicon &mlex = model.lexicon();
+
+    // the lexicon reads back exactly as it was written
+    BOOST_CHECK( mlex.isReadOnly() );
+    BOOST_CHECK_EQUAL( mlex.size(), lex.size() );
+    BOOST_CHECK_EQUAL( std::string( mlex.getMd5() ), std::string( lex.getMd5() ) );
+    BOOST_CHECK_EQUAL( mlex.locale(), lex.locale() );
+    BOOST_CHECK( mlex.lang() == lex.lang() );
+    BOOST_CHECK_EQUAL( mlex.regex(), lex.regex() );
+    BOOST_CHECK_EQUAL( mlex.regexPrefixAtt(), lex.regexPrefixAtt() );
+    BOOST_CHECK_EQUAL( mlex.regexSuffixAtt(), lex.regexSuffixAtt() );
+
+    std::ostringstream expect;
+    expect << lex;
+    os << mlex;
+    BOOST_CHECK_EQUAL( os.str(), expect.str() );
+
+    BOOST_CHECK( mlex.find( "ALLEE" ) == lex.find( "ALLEE" ) );
+    BOOST_CHECK( mlex.find( "MISSING" ).empty() );
+
+    // and so does the grammar
+    BOOST_CHECK_EQUAL( std::string( model.getGrammarMd5() ), std::string( G.getMd5() ) );
+    BOOST_CHECK_EQUAL( model.program()->maxScore(), G.program()->maxScore() );
+    std::ostringstream gexpect, gout;
+    gexpect << *G.program();
+    gout << *model.program();
+    BOOST_CHECK_EQUAL( gout.str(), gexpect.str() );
+}
+
+BOOST_FIXTURE_TEST_CASE(ModelFile_Mapped, TestFixture)
+{
+    Lexicon lex( "lex-test", std::string("lex-test.txt") );
+    Grammar G( std::string("good.grammar") );
+    const std::string file = "modelfile-test.model";
+
+    ModelFile::write( file, lex, G );
+    {
+        std::shared_ptr<const CompiledGrammar> program;
+        Lexicon copy;
+        {
+            ModelFile model( file );
+            BOOST_CHECK( model.size() > 0 );
+            program = model.program();
+            copy = model.lexicon();
+        }
+        // both outlive the ModelFile they came from
+        BOOST_CHECK( program->find( "ADDRESS" ) != CompiledGrammar::NONE );
+        BOOST_CHECK( copy.find( "ALLEE" ) == lex.find( "ALLEE" ) );
+    }
+    std::remove( file.c_str() );
+}
+
+BOOST_FIXTURE_TEST_CASE(ModelFile_CopyOnWrite, TestFixture)
+{
+    Lexicon lex( "lex-test", std::string("lex-test.txt") );
+    Grammar G( std::string("good.grammar") );
+
+    std::ostringstream image;
+    ModelFile::write( image, lex, G );
+    std::string bytes = image.str();
+    ModelFile model( bytes.data(), bytes.size() );
+
+    // changing a mapped lexicon copies it, the image is never touched
+    Lexicon mlex = model.lexicon();
+    mlex.insert( LexEntry( "NEW", "NEW", "WORD", "DETACH" ) );
+    BOOST_CHECK( not mlex.isReadOnly() );
+    BOOST_CHECK_EQUAL( mlex.size(), lex.size() + 1 );
+    BOOST_CHECK_EQUAL( mlex.find( "NEW" ).size(), 1u );
+    BOOST_CHECK( model.lexicon().find( "NEW" ).empty() );
+}
+
+BOOST_FIXTURE_TEST_CASE(ModelFile_LexiconOnly, TestFixture)
+{
+    Lexicon lex( "lex-test", std::string("lex-test.txt") );
+    Grammar G( std::string("good.grammar") );
+
+    std::ostringstream image;
+    ModelFile::write( image, lex );
+    std::string bytes = image.str();
+
+    ModelFile model( bytes.data(), bytes.size() );
+    BOOST_CHECK( not model.hasGrammar() );
+    BOOST_CHECK( not model.program() );
+    BOOST_CHECK_EQUAL( std::string( model.getGrammarMd5() ), std::string() );
+    BOOST_CHECK_EQUAL( model.lexicon().size(), lex.size() );
+    BOOST_CHECK_EQUAL( std::string( model.lexicon().getMd5() ), std::string( lex.getMd5() ) );
+
+    // a full model can be built from the loaded lexicon
+    std::ostringstream full, expect;
+    ModelFile::write( full, model.lexicon(), G );
+    ModelFile::write( expect, lex, G );
+    BOOST_CHECK( full.str() == expect.str() );
+}
+
+BOOST_FIXTURE_TEST_CASE(ModelFile_Invalid, TestFixture)
+{
+    Lexicon lex( "lex-test", std::string("lex-test.txt") );
+    Grammar G( std::string("good.grammar") );
+
+    std::ostringstream image;
+    ModelFile::write( image, lex, G );
+    std::string bytes = image.str();
+
+    // truncated
+    BOOST_CHECK_THROW( ModelFile( bytes.data(), bytes.size() - 8 ), std::runtime_error );
+    BOOST_CHECK_THROW( ModelFile( bytes.data(), 4 ), std::runtime_error );
+
+    // not a model at all
+    std::string text = "LEXICON:\tlex-test\tENG\ten_US\t0\n";
+    BOOST_CHECK_THROW( ModelFile( text.data(), text.size() ), std::runtime_error );
+
+    // wrong version
+    std::string old = bytes;
+    old[8] = static_cast<char>( MODELFILE_VERSION + 1 );
+    BOOST_CHECK_THROW( ModelFile( old.data(), old.size() ), std::runtime_error );
+
+    BOOST_CHECK_THROW( ModelFile( std::string("no-such-file.model") ), std::runtime_error );
+}
+
+// This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
+// above and is used to bracket our test cases.
+
+BOOST_AUTO_TEST_SUITE_END()
+
@@ -0,0 +1,138 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+// The following two defines are required by the Boost unit test framework
+// to create the necessary testing support. These defines must be placed
+// before the inclusion of the boost headers.
+//
+// The first define provides a name for our Boost test module.
+//
+// The second of these defines is used to indicate that we are building a
+// unit test module that will link dynamically with Boost. If you are using
+// a static library version of Boost, this define must be deleted. (or
+// in this case commented out)
+//
+// and include the test headers
+
+#define BOOST_TEST_MODULE PerfCountersTestModule
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include "perfcounters.h"
+
+// The two relevant Boost namespaces for the unit test framework are:
+using namespace boost;
+using namespace boost::unit_test;
+
+// Provide a name for our suite of tests. This statement is used to bracket
+// our test cases.
+BOOST_AUTO_TEST_SUITE(PerfCountersTestSuite)
+
+// The structure below allows us to pass a test initialization object to
+// each test case. Note the use of struct to default all methods and member
+// variables to public access.
+struct TestFixture
+{
+    TestFixture() {
+        // Put test initialization here, the constructor will be called
+        // prior to the execution of each test case
+        //printf("Initialize test\n");
+    }
+    ~TestFixture() {
+        // Put test cleanup here, the destructor will automatically be
+        // invoked at the end of each test case.
+        //printf("Cleanup test\n");
+    }
+    // Public test fixture variables are automatically available to all test
+    // cases. Don’t forget to initialize these variables in the constructors
+    // to avoid initialized variable errors.
+    
+};
+
+// Define a test case. The first argument specifies the name of the test.
+// Take some care in naming your tests. Do not reuse names or accidentally use
+// the same name for a test as specified for the module test suite name.
+//
+// The second argument provides a test build-up/tear-down object that is
+// responsible for creating and destroying any resources needed by the
+// unit test
+BOOST_FIXTURE_TEST_CASE(PerfCounters_Names, TestFixture)
+{
+    BOOST_CHECK_EQUAL( PerfCounters::asString( PerfCounters::CYCLES ), "cycles" );
+    BOOST_CHECK_EQUAL( PerfCounters::asString( PerfCounters::INSTRUCTIONS ), "instructions" );
+    BOOST_CHECK_EQUAL( PerfCounters::asString( PerfCounters::L1D_MISSES ), "l1d_misses" );
+    BOOST_CHECK_EQUAL( PerfCounters::asString( PerfCounters::LLC_MISSES ), "llc_misses" );
+    BOOST_CHECK_EQUAL( PerfCounters::asString( PerfCounters::BRANCH_MISSES ), "branch_misses" );
+    BOOST_CHECK_EQUAL( PerfCounters::asString( static_cast<PerfCounters::Event>( 9 ) ), "unknown" );
+}
+
+BOOST_FIXTURE_TEST_CASE(PerfCounters_Read, TestFixture)
+{
+    // hosts without a PMU, and most containers, have none of the events
+    // so only what holds either way is checked
+    PerfCounters &pc = PerfCounters::thread();
+    BOOST_CHECK( &pc == &PerfCounters::thread() );
+
+    PerfCounters::Sample before, after;
+    pc.read( before );
+    volatile long unsigned int sum = 0;
+    for ( long unsigned int i = 0; i < 1000000; ++i )
+        sum = sum + i;
+    pc.read( after );
+
+    bool any = false;
+    for ( int e = 0; e < PerfCounters::EVENTS; ++e ) {
+        auto ev = static_cast<PerfCounters::Event>( e );
+        if ( pc.available( ev ) ) {
+            any = true;
+            BOOST_CHECK( after.value[e] >= before.value[e] );
+        }
+        else {
+            BOOST_CHECK_EQUAL( before.value[e], 0u );
+            BOOST_CHECK_EQUAL( after.value[e], 0u );
+            BOOST_CHECK( not before.valid[e] and not after.valid[e] );
+        }
+    }
+    BOOST_CHECK_EQUAL( any, pc.any() );
+    if ( pc.available( PerfCounters::INSTRUCTIONS ) )
+        BOOST_CHECK( after.value[PerfCounters::INSTRUCTIONS] - before.value[PerfCounters::INSTRUCTIONS] > 1000000u );
+}
+
+BOOST_FIXTURE_TEST_CASE(PerfCounters_Delta, TestFixture)
+{
+    PerfCounters::Sample start, end;
+    for ( int e = 0; e < PerfCounters::EVENTS; ++e ) {
+        start.value[e] = 100;
+        start.valid[e] = true;
+        end.value[e] = 250;
+        end.valid[e] = true;
+    }
+    uint64_t d = 0;
+    BOOST_CHECK( PerfCounters::delta( start, end, PerfCounters::CYCLES, d ) );
+    BOOST_CHECK_EQUAL( d, 150u );
+
+    // a failed read or a scaled estimate that went down is no delta
+    end.valid[PerfCounters::INSTRUCTIONS] = false;
+    BOOST_CHECK( not PerfCounters::delta( start, end, PerfCounters::INSTRUCTIONS, d ) );
+    start.valid[PerfCounters::L1D_MISSES] = false;
+    BOOST_CHECK( not PerfCounters::delta( start, end, PerfCounters::L1D_MISSES, d ) );
+    end.value[PerfCounters::LLC_MISSES] = 99;
+    BOOST_CHECK( not PerfCounters::delta( start, end, PerfCounters::LLC_MISSES, d ) );
+    BOOST_CHECK_EQUAL( d, 150u );
+}
+
+// This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
+// above and is used to bracket our test cases.
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -240,6 +240,91 @@ BOOST_FIXTURE_TEST_CASE(SearchTest_4, TestFixture)
 
 }
 
+BOOST_AUTO_TEST_CASE(SearchTest_Profile)
+{
+    Grammar G( std::string("good.grammar") );
+    const CompiledGrammar &cg = *G.program();
+
+    std::vector<Token> pat1;
+    pat1.push_back( Token("11\t11\tNUMBER\tBADTOKEN\tDETACH") );
+    pat1.push_back( Token("OAK\tOAK\tWORD\tBADTOKEN\tDETACH") );
+    pat1.push_back( Token("ST\tSTREET\tTYPE\tBADTOKEN\tDETACH") );
+    pat1.push_back( Token("EXT\tEXT\tQUALIF\tBADTOKEN\tDETACH") );
+    pat1.push_back( Token("HWY\tHWY\tROAD\tBADTOKEN\tDETACH") );
+
+    Search s( G );
+    SearchProfile profile;
+    s.profile( &profile );
+    BOOST_CHECK( s.profile() == &profile );
+    BOOST_CHECK_EQUAL( s.search( pat1 ).size(), 1u );
+    BOOST_CHECK_EQUAL( profile.paths.size(), cg.sectionCount() );
+
+    // one pattern so ADDRESS is expanded once, CD is reached as the
+    // first section of one alternative and after AB matched in another
+    BOOST_CHECK_EQUAL( profile.paths[cg.find( "ADDRESS" )], 1u );
+    BOOST_CHECK_EQUAL( profile.paths[cg.find( "AB" )], 1u );
+    BOOST_CHECK_EQUAL( profile.paths[cg.find( "A" )], 1u );
+    BOOST_CHECK_EQUAL( profile.paths[cg.find( "CD" )], 2u );
+
+    // it adds up across searches and stops when it is unset
+    s.search( pat1 );
+    BOOST_CHECK_EQUAL( profile.paths[cg.find( "ADDRESS" )], 2u );
+    s.profile( NULL );
+    s.search( pat1 );
+    BOOST_CHECK_EQUAL( profile.paths[cg.find( "ADDRESS" )], 2u );
+}
+
+BOOST_AUTO_TEST_CASE(SearchTest_ProfileRules)
+{
+    Grammar G( std::string("good.grammar") );
+    const CompiledGrammar &cg = *G.program();
+
+    std::vector<Token> pat1;
+    pat1.push_back( Token("11\t11\tNUMBER\tBADTOKEN\tDETACH") );
+    pat1.push_back( Token("OAK\tOAK\tWORD\tBADTOKEN\tDETACH") );
+    pat1.push_back( Token("ST\tSTREET\tTYPE\tBADTOKEN\tDETACH") );
+    pat1.push_back( Token("EXT\tEXT\tQUALIF\tBADTOKEN\tDETACH") );
+    pat1.push_back( Token("HWY\tHWY\tROAD\tBADTOKEN\tDETACH") );
+
+    Search s( G );
+    SearchProfile profile;
+    s.profile( &profile );
+    float score = -1.0;
+    float nrules = -1.0;
+    std::string matched;
+    s.searchAndReclassBest( pat1, score, matched, nrules );
+    BOOST_CHECK_EQUAL( score, 0.5 );
+    BOOST_CHECK_EQUAL( profile.alts.tried.size(), cg.image().nalts );
+    BOOST_CHECK_EQUAL( profile.rules.tried.size(), cg.ruleCount() );
+
+    // every alternative of ADDRESS is tried, only @A @BC @DE matches
+    const CompiledGrammar::Index address = cg.section( cg.find( "ADDRESS" ) ).first;
+    for ( CompiledGrammar::Index i = address; i < address + 3; ++i ) {
+        BOOST_CHECK_EQUAL( profile.alts.tried[i], 1u );
+        BOOST_CHECK_EQUAL( profile.alts.matched[i], i == address + 1 ? 1u : 0u );
+        BOOST_CHECK_EQUAL( profile.alts.wins[i], i == address + 1 ? 1u : 0u );
+    }
+
+    // CD is compared twice, EF once with too few tokens left
+    const CompiledGrammar::Index ab = cg.section( cg.find( "AB" ) ).first;
+    const CompiledGrammar::Index a  = cg.section( cg.find( "A" ) ).first;
+    const CompiledGrammar::Index cd = cg.section( cg.find( "CD" ) ).first;
+    const CompiledGrammar::Index ef = cg.section( cg.find( "EF" ) ).first;
+    BOOST_CHECK_EQUAL( profile.rules.tried[ab], 1u );
+    BOOST_CHECK_EQUAL( profile.rules.matched[ab], 0u );
+    BOOST_CHECK_EQUAL( profile.rules.tried[cd], 2u );
+    BOOST_CHECK_EQUAL( profile.rules.matched[cd], 0u );
+    BOOST_CHECK_EQUAL( profile.rules.tried[ef], 1u );
+    BOOST_CHECK_EQUAL( profile.rules.tried[a], 1u );
+    BOOST_CHECK_EQUAL( profile.rules.matched[a], 1u );
+    BOOST_CHECK_EQUAL( profile.rules.wins[a], 1u );
+
+    // searching alone matches but does not pick a winner
+    s.search( pat1 );
+    BOOST_CHECK_EQUAL( profile.rules.matched[a], 2u );
+    BOOST_CHECK_EQUAL( profile.rules.wins[a], 1u );
+}
+
 // This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
 // above and is used to bracket our test cases.
 
@@ -0,0 +1,289 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+// The following two defines are required by the Boost unit test framework
+// to create the necessary testing support. These defines must be placed
+// before the inclusion of the boost headers.
+//
+// The first define provides a name for our Boost test module.
+//
+// The second of these defines is used to indicate that we are building a
+// unit test module that will link dynamically with Boost. If you are using
+// a static library version of Boost, this define must be deleted. (or
+// in this case commented out)
+//
+// and include the test headers
+
+#define BOOST_TEST_MODULE SearchBudgetTestModule
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <climits>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include "grammar.h"
+#include "search.h"
+#include "searchbudget.h"
+#include "threadpool.h"
+
+// The two relevant Boost namespaces for the unit test framework are:
+using namespace boost;
+using namespace boost::unit_test;
+
+// Provide a name for our suite of tests. This statement is used to bracket
+// our test cases.
+BOOST_AUTO_TEST_SUITE(SearchBudgetTestSuite)
+
+// The structure below allows us to pass a test initialization object to
+// each test case. Note the use of struct to default all methods and member
+// variables to public access.
+struct TestFixture
+{
+    TestFixture() {
+        // Put test initialization here, the constructor will be called
+        // prior to the execution of each test case
+        //printf("Initialize test\n");
+    }
+    ~TestFixture() {
+        // Put test cleanup here, the destructor will automatically be
+        // invoked at the end of each test case.
+        //printf("Cleanup test\n");
+    }
+    // Public test fixture variables are automatically available to all test
+    // cases. Don’t forget to initialize these variables in the constructors
+    // to avoid initialized variable errors.
+    
+    std::ostringstream os;
+
+    // 11 OAK ST EXT HWY, the first token has two classes
+    std::vector<Token> phrase() {
+        std::vector<Token> pat;
+        pat.push_back( Token("11\t11\tNUMBER,WORD\tBADTOKEN\tDETACH") );
+        pat.push_back( Token("OAK\tOAK\tWORD\tBADTOKEN\tDETACH") );
+        pat.push_back( Token("ST\tSTREET\tTYPE\tBADTOKEN\tDETACH") );
+        pat.push_back( Token("EXT\tEXT\tQUALIF\tBADTOKEN\tDETACH") );
+        pat.push_back( Token("HWY\tHWY\tROAD\tBADTOKEN\tDETACH") );
+        return pat;
+    }
+
+};
+
+// Define a test case. The first argument specifies the name of the test.
+// Take some care in naming your tests. Do not reuse names or accidentally use
+// the same name for a test as specified for the module test suite name.
+//
+// The second argument provides a test build-up/tear-down object that is
+// responsible for creating and destroying any resources needed by the
+// unit test
+BOOST_FIXTURE_TEST_CASE(SearchBudget_Defaults, TestFixture)
+{
+    SearchBudget b;
+    BOOST_CHECK_EQUAL( b.maxPatterns(), 0u );
+    BOOST_CHECK_EQUAL( b.maxPaths(), 0u );
+    BOOST_CHECK_EQUAL( b.maxExpansions(), 0u );
+    BOOST_CHECK_EQUAL( b.deadline(), 0u );
+
+    // nothing is limited by default
+    BOOST_CHECK( b.chargePatterns( 1000000 ) );
+    BOOST_CHECK( b.checkPaths( 1000000 ) );
+    for ( int i = 0; i < 1000; ++i )
+        BOOST_CHECK( b.chargeExpansion() );
+    BOOST_CHECK( b.checkDeadline() );
+    BOOST_CHECK( not b.exceeded() );
+    BOOST_CHECK( b.limit() == SearchBudget::NONE );
+}
+
+BOOST_FIXTURE_TEST_CASE(SearchBudget_Limits, TestFixture)
+{
+    SearchBudget b;
+    b.maxPatterns( 10 );
+    b.maxPaths( 5 );
+    b.maxExpansions( 3 );
+
+    BOOST_CHECK( b.chargePatterns( 4 ) );
+    BOOST_CHECK_EQUAL( b.patternsLeft(), 6u );
+    BOOST_CHECK( b.checkPaths( 5 ) );
+    BOOST_CHECK( b.chargeExpansion() );
+    BOOST_CHECK( not b.exceeded() );
+
+    BOOST_CHECK( not b.checkPaths( 6 ) );
+    BOOST_CHECK( b.exceeded() );
+    BOOST_CHECK( b.limit() == SearchBudget::PATHS );
+
+    // the first limit hit is kept
+    BOOST_CHECK( not b.chargePatterns( 7 ) );
+    BOOST_CHECK( b.limit() == SearchBudget::PATHS );
+    BOOST_CHECK_EQUAL( SearchBudget::asString( b.limit() ), "PATHS" );
+
+    // start() resets the counters but not the limits
+    b.start();
+    BOOST_CHECK( not b.exceeded() );
+    BOOST_CHECK_EQUAL( b.patterns(), 0u );
+    BOOST_CHECK_EQUAL( b.maxPatterns(), 10u );
+}
+
+BOOST_FIXTURE_TEST_CASE(SearchBudget_Unlimited_Search, TestFixture)
+{
+    Grammar G( std::string("good.grammar") );
+
+    Search s1( G );
+    SearchPaths expect = s1.search( phrase() );
+    BOOST_CHECK_EQUAL( expect.size(), 1u );
+
+    SearchBudget b;
+    b.start();
+    Search s2( G );
+    s2.budget( &b );
+    SearchPaths got = s2.search( phrase() );
+    BOOST_CHECK_EQUAL( got.size(), expect.size() );
+    BOOST_CHECK( not b.exceeded() );
+    BOOST_CHECK_EQUAL( b.patterns(), 2u );
+    BOOST_CHECK( b.expansions() > 0 );
+}
+
+BOOST_FIXTURE_TEST_CASE(SearchBudget_Patterns, TestFixture)
+{
+    Grammar G( std::string("good.grammar") );
+
+    // NUMBER is the second pattern enumerated, so one is not enough
+    SearchBudget b;
+    b.maxPatterns( 1 );
+    b.start();
+    Search s( G );
+    s.budget( &b );
+    SearchPaths got = s.search( phrase() );
+    BOOST_CHECK( b.exceeded() );
+    BOOST_CHECK( b.limit() == SearchBudget::PATTERNS );
+    BOOST_CHECK_EQUAL( b.patterns(), 1u );
+
+    // and a second phrase is not searched at all
+    b.start();
+    b.chargePatterns( 1 );
+    got = s.search( phrase() );
+    BOOST_CHECK( got.empty() );
+    BOOST_CHECK( b.limit() == SearchBudget::PATTERNS );
+}
+
+BOOST_FIXTURE_TEST_CASE(SearchBudget_Expansions, TestFixture)
+{
+    Grammar G( std::string("good.grammar") );
+
+    SearchBudget b;
+    b.maxExpansions( 2 );
+    b.start();
+    Search s( G );
+    s.budget( &b );
+
+    std::vector<std::vector<Token> > phrases;
+    phrases.push_back( phrase() );
+    phrases.push_back( phrase() );
+
+    float score = 0.0;
+    float nrules = 0.0;
+    std::string matched;
+    s.searchAndReclassBest( phrases, score, matched, nrules );
+    BOOST_CHECK( b.limit() == SearchBudget::EXPANSIONS );
+    BOOST_CHECK_EQUAL( b.expansions(), 3u );
+    BOOST_CHECK_CLOSE( score, -1.0, 0.001 );
+}
+
+BOOST_FIXTURE_TEST_CASE(SearchBudget_Deadline, TestFixture)
+{
+    Grammar G( std::string("good.grammar") );
+
+    // a deadline that has already passed stops the search
+    SearchBudget b;
+    b.deadline( 1 );
+    b.start();
+    while ( b.elapsed() < 2 )
+        ;
+    Search s( G );
+    s.budget( &b );
+    SearchPaths got = s.search( phrase() );
+    BOOST_CHECK( got.empty() );
+    BOOST_CHECK( b.limit() == SearchBudget::DEADLINE );
+
+    // the patterns the deadline kept from being searched are not charged
+    BOOST_CHECK_EQUAL( b.patterns(), 0u );
+}
+
+BOOST_FIXTURE_TEST_CASE(SearchBudget_Deadline_Only, TestFixture)
+{
+    Grammar G( std::string("good.grammar") );
+
+    // far more patterns than could ever be enumerated, only the
+    // deadline stops them being made
+    std::vector<Token> city;
+    for ( int i = 0; i < 40; ++i )
+        city.push_back( Token("CITY\tCITY\tWORD,TYPE,ROAD,PROV\tBADTOKEN\tDETACH") );
+    BOOST_CHECK_EQUAL( Token::countPatterns( city ), ULONG_MAX );
+
+    SearchBudget b;
+    b.deadline( 50 );
+    b.start();
+    Search s( G );
+    s.budget( &b );
+    SearchPaths got = s.search( city );
+    BOOST_CHECK( got.empty() );
+    BOOST_CHECK( b.limit() == SearchBudget::DEADLINE );
+    BOOST_CHECK( b.elapsed() < 1000 );
+    BOOST_CHECK( b.patterns() > 0 );
+    BOOST_CHECK( b.patterns() < ULONG_MAX );
+}
+
+BOOST_FIXTURE_TEST_CASE(SearchBudget_Parallel_Shared, TestFixture)
+{
+    Grammar G( std::string("good.grammar") );
+
+    // eight phrases of two patterns each, but only five may be searched
+    std::vector<std::vector<Token> > phrases( 8, phrase() );
+
+    SearchBudget seq;
+    seq.maxPatterns( 5 );
+    seq.start();
+    Search s( G );
+    s.budget( &seq );
+    s.searchAndReclassAll( phrases );
+    BOOST_CHECK( seq.limit() == SearchBudget::PATTERNS );
+    BOOST_CHECK_EQUAL( seq.patterns(), 5u );
+
+    // on the pool the phrases share the one budget
+    SearchBudget par;
+    par.maxPatterns( 5 );
+    par.start();
+    s.budget( &par );
+    s.pool( &ThreadPool::instance() );
+    s.searchAndReclassAll( phrases );
+    BOOST_CHECK( par.limit() == SearchBudget::PATTERNS );
+    BOOST_CHECK_EQUAL( par.patterns(), 5u );
+
+    // and the same for the best phrase, each thread can go at most
+    // one expansion over before it sees the limit
+    par.maxPatterns( 0 );
+    par.maxExpansions( 2 );
+    par.start();
+    float score = 0.0;
+    float nrules = 0.0;
+    std::string matched;
+    s.searchAndReclassBest( phrases, score, matched, nrules );
+    BOOST_CHECK( par.limit() == SearchBudget::EXPANSIONS );
+    BOOST_CHECK( par.expansions() <= 2u + ThreadPool::instance().size() + 1 );
+}
+
+// This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
+// above and is used to bracket our test cases.
+
+BOOST_AUTO_TEST_SUITE_END()
+
@@ -0,0 +1,168 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+// The following two defines are required by the Boost unit test framework
+// to create the necessary testing support. These defines must be placed
+// before the inclusion of the boost headers.
+//
+// The first define provides a name for our Boost test module.
+//
+// The second of these defines is used to indicate that we are building a
+// unit test module that will link dynamically with Boost. If you are using
+// a static library version of Boost, this define must be deleted. (or
+// in this case commented out)
+//
+// and include the test headers
+
+#define BOOST_TEST_MODULE ThreadPoolTestModule
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include "grammar.h"
+#include "search.h"
+#include "threadpool.h"
+
+// The two relevant Boost namespaces for the unit test framework are:
+using namespace boost;
+using namespace boost::unit_test;
+
+// Provide a name for our suite of tests. This statement is used to bracket
+// our test cases.
+BOOST_AUTO_TEST_SUITE(ThreadPoolTestSuite)
+
+// The structure below allows us to pass a test initialization object to
+// each test case. Note the use of struct to default all methods and member
+// variables to public access.
+struct TestFixture
+{
+    TestFixture() {
+        // Put test initialization here, the constructor will be called
+        // prior to the execution of each test case
+        //printf("Initialize test\n");
+    }
+    ~TestFixture() {
+        // Put test cleanup here, the destructor will automatically be
+        // invoked at the end of each test case.
+        //printf("Cleanup test\n");
+    }
+    // Public test fixture variables are automatically available to all test
+    // cases. Don’t forget to initialize these variables in the constructors
+    // to avoid initialized variable errors.
+    
+    std::ostringstream os;
+
+};
+
+// Define a test case. The first argument specifies the name of the test.
+// Take some care in naming your tests. Do not reuse names or accidentally use
+// the same name for a test as specified for the module test suite name.
+//
+// The second argument provides a test build-up/tear-down object that is
+// responsible for creating and destroying any resources needed by the
+// unit test
+BOOST_FIXTURE_TEST_CASE(ThreadPool_ParallelFor, TestFixture)
+{
+    ThreadPool pool( 3 );
+    BOOST_CHECK_EQUAL( pool.size(), 3u );
+
+    // every index is run exactly once
+    std::vector<std::atomic<int> > hits( 1000 );
+    for ( auto &h : hits )
+        h = 0;
+    pool.parallelFor( hits.size(), [&hits]( long unsigned int i ) { ++hits[i]; } );
+    for ( const auto &h : hits )
+        BOOST_CHECK_EQUAL( h.load(), 1 );
+
+    // nothing to do
+    pool.parallelFor( 0, []( long unsigned int ) { throw std::runtime_error( "not called" ); } );
+}
+
+BOOST_FIXTURE_TEST_CASE(ThreadPool_NoThreads, TestFixture)
+{
+    // the calling thread does all the work
+    ThreadPool pool( 0 );
+    long unsigned int sum = 0;
+    pool.parallelFor( 10, [&sum]( long unsigned int i ) { sum += i; } );
+    BOOST_CHECK_EQUAL( sum, 45u );
+}
+
+BOOST_FIXTURE_TEST_CASE(ThreadPool_Exception, TestFixture)
+{
+    ThreadPool pool( 2 );
+    std::atomic<int> ran( 0 );
+    BOOST_CHECK_THROW( pool.parallelFor( 20, [&ran]( long unsigned int i ) {
+            ++ran;
+            if ( i == 7 )
+                throw std::runtime_error( "task failed" );
+        } ), std::runtime_error );
+    // the other tasks still ran
+    BOOST_CHECK_EQUAL( ran.load(), 20 );
+}
+
+BOOST_FIXTURE_TEST_CASE(ThreadPool_Search, TestFixture)
+{
+    Grammar G( std::string("good.grammar") );
+
+    std::vector<Token> pat;
+    pat.push_back( Token("11\t11\tNUMBER\tBADTOKEN\tDETACH") );
+    pat.push_back( Token("OAK\tOAK\tWORD\tBADTOKEN\tDETACH") );
+    pat.push_back( Token("ST\tSTREET\tTYPE\tBADTOKEN\tDETACH") );
+    pat.push_back( Token("EXT\tEXT\tQUALIF\tBADTOKEN\tDETACH") );
+    pat.push_back( Token("HWY\tHWY\tROAD\tBADTOKEN\tDETACH") );
+
+    std::vector<Token> nomatch;
+    nomatch.push_back( Token("OAK\tOAK\tWORD\tBADTOKEN\tDETACH") );
+
+    std::vector<std::vector<Token> > phrases;
+    phrases.push_back( nomatch );
+    phrases.push_back( pat );
+    phrases.push_back( nomatch );
+    phrases.push_back( pat );
+
+    Search s1( G );
+    float score1 = 0.0, nrules1 = 0.0;
+    std::string matched1;
+    auto best1 = s1.searchAndReclassBest( phrases, score1, matched1, nrules1 );
+    auto all1 = s1.searchAndReclassAll( phrases );
+
+    ThreadPool pool( 3 );
+    Search s2( G );
+    s2.pool( &pool );
+    float score2 = 0.0, nrules2 = 0.0;
+    std::string matched2;
+    auto best2 = s2.searchAndReclassBest( phrases, score2, matched2, nrules2 );
+    auto all2 = s2.searchAndReclassAll( phrases );
+
+    BOOST_CHECK_CLOSE( score1, 0.5, 0.001 );
+    BOOST_CHECK_EQUAL( score1, score2 );
+    BOOST_CHECK_EQUAL( nrules1, nrules2 );
+    BOOST_CHECK_EQUAL( matched1, matched2 );
+    BOOST_CHECK_EQUAL( best1.size(), best2.size() );
+
+    BOOST_REQUIRE_EQUAL( all1.size(), all2.size() );
+    for ( long unsigned int i = 0; i < all1.size(); ++i ) {
+        BOOST_CHECK_EQUAL( all1[i].matched, all2[i].matched );
+        BOOST_CHECK_EQUAL( all1[i].score, all2[i].score );
+    }
+}
+
+// This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
+// above and is used to bracket our test cases.
+
+BOOST_AUTO_TEST_SUITE_END()
+
@@ -246,6 +246,14 @@ BOOST_FIXTURE_TEST_CASE(Token_enumerate, TestFixture)
     //printf("result:\n%s\n", sresult.c_str());
 
     BOOST_CHECK(sresult == expected);
+
+    // the patterns one at a time are the same as all of them
+    std::vector<InClass::Type> one;
+    BOOST_CHECK_EQUAL( Token::countPatterns( tokens ), result.size() );
+    for ( long unsigned int i = 0; i < result.size(); ++i ) {
+        Token::pattern( tokens, i, one );
+        BOOST_CHECK( one == result[i] );
+    }
 }
 
 // This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
@@ -343,6 +343,58 @@ BOOST_FIXTURE_TEST_CASE(Tokenizer_Testing2, TestFixture)
 
 }
 
+BOOST_AUTO_TEST_CASE(Tokenizer_AltTokens)
+{
+    std::ostringstream os;
+
+    // the words of both multi-word tokens classify as WORD
+    // so splitting either one gives the same classes
+    Lexicon emptylexicon;
+    Tokenizer tz(emptylexicon);
+    std::vector<Token> phrase;
+    phrase.push_back( Token("ALPHA BETA\tALPHA BETA\tWORD\tBADTOKEN\tDETACH") );
+    phrase.push_back( Token("GAMMA DELTA\tGAMMA DELTA\tWORD\tBADTOKEN\tDETACH") );
+    phrase.push_back( Token("123\t123\tNUMBER\tBADTOKEN\tDETACH") );
+
+    auto list = tz.getAltTokens( phrase );
+    BOOST_CHECK_EQUAL( list.size(), 3u );
+
+    // the lazy alternates come out in the same order
+    AltTokens all = tz.altTokens( phrase, false );
+    BOOST_CHECK_EQUAL( all.size(), 3u );
+    std::vector<Token> one;
+    long unsigned int n = 0;
+    while ( all.next( one ) ) {
+        BOOST_REQUIRE( n < list.size() );
+        BOOST_CHECK_EQUAL( one.size(), list[n].size() );
+        for ( long unsigned int i = 0; i < one.size() and i < list[n].size(); ++i )
+            BOOST_CHECK_EQUAL( one[i].text(), list[n][i].text() );
+        ++n;
+    }
+    BOOST_CHECK_EQUAL( n, list.size() );
+
+    // only split one or split both
+    AltTokens unique = tz.altTokens( phrase, true );
+    n = 0;
+    while ( unique.next( one ) ) {
+        for ( const auto &t : one )
+            os << t.text() << "|";
+        os << "\n";
+        ++n;
+    }
+    BOOST_CHECK_EQUAL( n, 2u );
+    BOOST_CHECK_EQUAL( os.str(),
+        "ALPHA|BETA|GAMMA DELTA|123|\n"
+        "ALPHA|BETA|GAMMA|DELTA|123|\n" );
+
+    // nothing to split
+    std::vector<Token> single;
+    single.push_back( Token("123\t123\tNUMBER\tBADTOKEN\tDETACH") );
+    AltTokens none = tz.altTokens( single, true );
+    BOOST_CHECK_EQUAL( none.size(), 0u );
+    BOOST_CHECK( not none.next( one ) );
+}
+
 // This must match the BOOST_AUTO_TEST_SUITE(ExampleTestSuite) statement
 // above and is used to bracket our test cases.
 
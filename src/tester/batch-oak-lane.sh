@@ -1,6 +1,7 @@
 #!/bin/bash
+# set T2FLAGS=-p to add the hardware perf counters of each stage
 
 for x in '123 oak ln e n mycity ny usa' '123 oak lane east n mycity ny usa' '123 oak ln e north mycity ny usa' '123 oak ln e n st marie ny usa' '123 oak lane east n st marie ny usa' '123 oak ln e north st marie ny usa' '123 oak ln e n saint marie ny usa' '123 oak lane east n saint marie ny usa' '123 oak ln e north saint marie ny usa' '123 oak ln e st marie ny usa' '123 oak lane east st marie ny usa' '123 oak ln e st marie ny usa' '123 oak ln e saint marie ny usa' '123 oak lane east saint marie ny usa' '123 oak ln e saint marie ny usa' '123 oak ln st marie ny usa' '123 oak lane st marie ny usa' '123 oak ln st marie ny usa' '123 oak ln saint marie ny usa' '123 oak lane saint marie ny usa' '123 oak ln saint marie ny usa' '123 oak ln marie ny usa' '123 oak ln new marie ny usa' '123 oak ln e, n mycity ny usa' '123 oak lane east, n mycity ny usa' '123 oak ln e, north mycity ny usa' '123 oak ln e n, mycity ny usa' '123 oak lane east n, mycity ny usa' '123 oak ln e north, mycity ny usa' '123 oak ln e, n st marie ny usa' '123 oak lane east, n st marie ny usa' '123 oak ln e, north st marie ny usa' '123 oak ln e, n saint marie ny usa' '123 oak lane east, n saint marie ny usa' '123 oak ln e, north saint marie ny usa' '123 oak ln e, st marie ny usa' '123 oak lane east, st marie ny usa' '123 oak ln e, st marie ny usa' '123 oak ln e, saint marie ny usa' '123 oak lane east, saint marie ny usa' '123 oak ln e, saint marie ny usa' '123 oak ln, st marie ny usa' '123 oak lane, st marie ny usa' '123 oak ln, st marie ny usa' '123 oak ln, saint marie ny usa' '123 oak lane, saint marie ny usa' '123 oak ln, saint marie ny usa' '123 oak ln, marie ny usa' '123 oak ln, new marie ny usa' '123 b & o railroad ln e n st marie ny usa' '123 b & o railroad depot ln e n st marie ny usa' '123 b & o railroad crossing ln e n st marie ny usa' '123 b & o rail road ln e n st marie ny usa' ; do
 echo -n "'$x'			"
-./t2 ../../data/sample/usa.lex ../../data/sample/usa.gmr "$x" 2>/dev/null 
+./t2 $T2FLAGS ../../data/sample/usa.lex ../../data/sample/usa.gmr "$x" 2>/dev/null 
 done
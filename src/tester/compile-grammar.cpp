@@ -11,20 +11,21 @@
  *
  ***************************************************ADDRESS_STANDARDIZER**/
 // compile-grammar.cpp
-// read a grammar file, build a trie, serialize trie to file.
+// read and check a grammar file, serialize it to file.
 
 #include <fstream>
 #include <iostream>
 #include <string>
 
+#include <boost/archive/text_oarchive.hpp>
+
 #include "grammar.h"
-#include "utils.h"
 
 
 int main(int ac, char* av[])
 {
     if (ac < 3) {
-        std::cerr << "Usage: compile-grammar test.gmr test.tri\n";
+        std::cerr << "Usage: compile-grammar test.gmr test.cgmr\n";
         return EXIT_FAILURE;
     }
 
@@ -35,7 +36,8 @@ int main(int ac, char* av[])
     std::ofstream ofs( av[2], std::ofstream::out | std::ofstream::trunc
         | std::ofstream::binary );
     if ( ofs.good() ) {
-        g.serialize( ofs );
+        boost::archive::text_oarchive oa(ofs);
+        oa << g;
         ofs.close();
     }
     else {
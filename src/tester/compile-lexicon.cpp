@@ -22,6 +22,7 @@
 #include <boost/archive/archive_exception.hpp>
 
 #include "lexicon.h"
+#include "threadpool.h"
 
 
 int main(int ac, char* av[])
@@ -31,13 +32,14 @@ int main(int ac, char* av[])
         return EXIT_FAILURE;
     }
 
+    // parse the entries and build the regex strings on all cores
+    ThreadPool &pool = ThreadPool::instance();
+
     std::string file = av[1];
-    Lexicon lex( "lexicon", file );
+    Lexicon lex( "lexicon", file, &pool );
 
     // populate the regex strings in the Lexicon
-    lex.regex();
-    lex.regexPrefixAtt();
-    lex.regexSuffixAtt();
+    lex.compile( &pool );
 
     std::ofstream ofs( av[2], std::ofstream::out | std::ofstream::trunc
         | std::ofstream::binary );
@@ -0,0 +1,59 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+// compile-model.cpp
+// read a lexicon file and a grammar file, write a binary model file.
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "lexicon.h"
+#include "grammar.h"
+#include "modelfile.h"
+#include "threadpool.h"
+
+
+int main(int ac, char* av[])
+{
+    if (ac < 4) {
+        std::cerr << "Usage: compile-model test.lex test.gmr test.model\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        // parse the entries and build the regex strings on all cores
+        ThreadPool &pool = ThreadPool::instance();
+        Lexicon lex( "lexicon", std::string( av[1] ), &pool );
+        lex.compile( &pool );
+
+        Grammar G( ( std::string( av[2] ) ) );
+        if ( G.status() == Grammar::CHECK_FATAL ) {
+            std::cerr << "ERROR: grammar '" << av[2] << "' is not valid!\n";
+            return EXIT_FAILURE;
+        }
+
+        ModelFile::write( std::string( av[3] ), lex, G );
+
+        // read it back to make sure it is usable
+        ModelFile model( ( std::string( av[3] ) ) );
+        std::cout << "Wrote '" << av[3] << "': " << model.size() << " bytes, "
+                  << model.lexicon().size() << " lexicon keys, "
+                  << model.program()->sectionCount() << " grammar sections\n";
+    }
+    catch ( std::runtime_error &e ) {
+        std::cerr << "ERROR: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
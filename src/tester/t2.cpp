@@ -19,6 +19,8 @@
 #include "utils.h"
 #include "grammar.h"
 #include "search.h"
+#include "counter.h"
+#include "instrument.h"
 
 #include <algorithm>
 #include <iostream>
@@ -39,8 +41,16 @@ bool sortByScoresDesc( const MatchResult &lhs, const MatchResult &rhs) {
 
 int main(int ac, char* av[]) {
 
+    // -p adds the hardware perf counters of each stage to the report
+    bool perf = false;
+    if (ac > 1 and std::string(av[1]) == "-p") {
+        perf = true;
+        --ac;
+        ++av;
+    }
+
     if (ac < 4 or ac > 5) {
-        std::cerr << "Usage: t2 lex.txt grammar.txt 'address to parse' ['filter']\n";
+        std::cerr << "Usage: t2 [-p] lex.txt grammar.txt 'address to parse' ['filter']\n";
         return EXIT_FAILURE;
     }
 
@@ -131,6 +141,11 @@ int main(int ac, char* av[]) {
     dt = std::chrono::duration_cast<std::chrono::milliseconds>(diff);
     std::cout << "Timer: init tokenizer: " << dt.count() << " ms\n";
 
+    // record the stages and counters for this address
+    Instrument::enable( true );
+    Instrument::perf( perf );
+    Instrument::Address address;
+
     std::vector<std::vector<Token> > phrases;
     t0 = std::chrono::system_clock::now();
     phrases.push_back( tokenizer.getTokens( Ustr ) );
@@ -208,6 +223,8 @@ int main(int ac, char* av[]) {
         //std::cout << "--Gramar-------------------\n" << G << "---------------------------\n";
 
         Search S( G );
+        SearchProfile profile;
+        S.profile( &profile );
 
         float bestCost = -1.0;
         float bestNrules = -1.0;
@@ -219,8 +236,19 @@ int main(int ac, char* av[]) {
         dt = std::chrono::duration_cast<std::chrono::milliseconds>(diff);
         std::cout << "Timer: Search::searchAndReclassBest: " << dt.count() << " ms\n";
 
-        std::cout << "Stats: findMetas: " << Utils::getCount("findMetas") << "\n";
-        std::cout << "Stats: findRules: " << Utils::getCount("findRules") << "\n";
+        std::cout << "Stats: findMetas: " << Counter::get( "findMetas" ) << "\n";
+        std::cout << "Stats: findRules: " << Counter::get( "findRules" ) << "\n";
+        for ( int c = 0; c < Instrument::COUNTERS; ++c ) {
+            auto counter = static_cast<Instrument::Counter>( c );
+            std::cout << "Stats: " << Instrument::asString( counter ) << ": "
+                << address.counter( counter ) << "\n";
+        }
+        // the partial paths expanded at each grammar section
+        const CompiledGrammar &cg = *G.program();
+        for ( CompiledGrammar::Index id = 0; id < profile.paths.size(); ++id )
+            if ( profile.paths[id] )
+                std::cout << "Stats: section " << cg.name( id ) << ": " << profile.paths[id] << "\n";
+        Instrument::report( std::cout );
 
 
         if ( bestCost < 0.0 ) {
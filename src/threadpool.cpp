@@ -0,0 +1,145 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#include "threadpool.h"
+
+
+ThreadPool::ThreadPool( unsigned int nthreads ) : queued_( 0 ), stop_( false ) {
+    // one queue per worker plus one for the threads calling parallelFor()
+    for ( unsigned int i = 0; i <= nthreads; ++i )
+        queues_.push_back( std::unique_ptr<Queue>( new Queue ) );
+
+    for ( unsigned int i = 0; i < nthreads; ++i )
+        threads_.push_back( std::thread( &ThreadPool::worker, this, i + 1 ) );
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard( wakeLock_ );
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for ( auto &t : threads_ )
+        t.join();
+}
+
+
+ThreadPool &ThreadPool::instance() {
+    static ThreadPool pool( std::thread::hardware_concurrency() > 1
+                            ? std::thread::hardware_concurrency() - 1 : 0 );
+    return pool;
+}
+
+
+void ThreadPool::parallelFor( long unsigned int n, const std::function<void(long unsigned int)> &fn ) {
+    if ( n == 0 )
+        return;
+
+    struct Group {
+        std::mutex lock;
+        std::condition_variable done;
+        long unsigned int remaining;
+        std::exception_ptr error;
+    };
+    auto group = std::make_shared<Group>();
+    group->remaining = n;
+
+    // deal the tasks out round robin so every worker starts with some
+    const unsigned int nq = static_cast<unsigned int>( queues_.size() );
+    for ( long unsigned int i = 0; i < n; ++i ) {
+        push( static_cast<unsigned int>( i % nq ), [group, &fn, i]() {
+            try {
+                fn( i );
+            }
+            catch ( ... ) {
+                std::lock_guard<std::mutex> guard( group->lock );
+                if ( not group->error )
+                    group->error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> guard( group->lock );
+            if ( --group->remaining == 0 )
+                group->done.notify_all();
+        } );
+    }
+    {
+        // make sure no worker is between checking queued_ and sleeping
+        std::lock_guard<std::mutex> guard( wakeLock_ );
+    }
+    wake_.notify_all();
+
+    // help out until the queues are empty then wait for the stragglers
+    Task task;
+    while ( pop( 0, task ) )
+        task();
+
+    std::unique_lock<std::mutex> guard( group->lock );
+    group->done.wait( guard, [&group]() { return group->remaining == 0; } );
+
+    if ( group->error )
+        std::rethrow_exception( group->error );
+}
+
+
+void ThreadPool::push( unsigned int q, Task task ) {
+    // count it first so queued_ never drops below the real number
+    ++queued_;
+    std::lock_guard<std::mutex> guard( queues_[q]->lock );
+    queues_[q]->tasks.push_back( std::move( task ) );
+}
+
+
+bool ThreadPool::pop( unsigned int q, Task &task ) {
+    // take the newest task from our own queue
+    {
+        std::lock_guard<std::mutex> guard( queues_[q]->lock );
+        if ( not queues_[q]->tasks.empty() ) {
+            task = std::move( queues_[q]->tasks.back() );
+            queues_[q]->tasks.pop_back();
+            --queued_;
+            return true;
+        }
+    }
+
+    // or steal the oldest task from someone else
+    const unsigned int nq = static_cast<unsigned int>( queues_.size() );
+    for ( unsigned int i = 1; i < nq; ++i ) {
+        Queue &victim = *queues_[( q + i ) % nq];
+        std::lock_guard<std::mutex> guard( victim.lock );
+        if ( not victim.tasks.empty() ) {
+            task = std::move( victim.tasks.front() );
+            victim.tasks.pop_front();
+            --queued_;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void ThreadPool::worker( unsigned int id ) {
+    Task task;
+    while ( true ) {
+        if ( pop( id, task ) ) {
+            task();
+            task = Task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard( wakeLock_ );
+        wake_.wait( guard, [this]() { return stop_ or queued_ > 0; } );
+        if ( stop_ )
+            return;
+    }
+}
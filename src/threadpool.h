@@ -0,0 +1,76 @@
+/**ADDRESS_STANDARDIZER***************************************************
+ *
+ * Address Standardizer
+ *      A collection of C++ classes for parsing street addresses
+ *      and standardizing them for the purpose of Geocoding.
+ *
+ * Copyright 2016 Stephen Woodbridge <woodbri@imaptools.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the MIT License. Please file LICENSE for details.
+ *
+ ***************************************************ADDRESS_STANDARDIZER**/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * ThreadPool is a small work stealing pool. Each worker has its own
+ * queue of tasks, it takes work from the back of its own queue and
+ * when that is empty it steals from the front of the other queues.
+ *
+ * parallelFor() spreads n tasks over the queues and the calling thread
+ * also runs tasks until all of them are done, so a pool of size zero
+ * simply runs everything on the caller.
+ */
+class ThreadPool {
+
+public:
+    explicit ThreadPool( unsigned int nthreads );
+    ~ThreadPool();
+
+    ThreadPool( const ThreadPool& ) = delete;
+    ThreadPool &operator=( const ThreadPool& ) = delete;
+
+    unsigned int size() const { return static_cast<unsigned int>( threads_.size() ); };
+
+    // run fn(i) for i in [0, n) and return when all of them are done
+    // the first exception thrown by a task is rethrown here
+    void parallelFor( long unsigned int n, const std::function<void(long unsigned int)> &fn );
+
+    // a pool shared by the process, sized to the hardware
+    static ThreadPool &instance();
+
+private:
+    typedef std::function<void()> Task;
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    void push( unsigned int q, Task task );
+    bool pop( unsigned int q, Task &task );
+    void worker( unsigned int id );
+
+    std::vector<std::unique_ptr<Queue> > queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex wakeLock_;
+    std::condition_variable wake_;
+    std::atomic<long unsigned int> queued_;
+    bool stop_;
+
+};
+
+#endif
@@ -11,6 +11,8 @@
  *
  ***************************************************ADDRESS_STANDARDIZER**/
 
+#include <algorithm>
+#include <climits>
 #include <iostream>
 #include <sstream>
 
@@ -93,33 +95,55 @@ InClass::Type Token::in(long unsigned int pos) const {
 
 
 std::vector< std::vector<InClass::Type> > Token::enumerate( std::vector<Token> tokens ) {
+    return enumerate( tokens, 0 );
+}
+
+
+std::vector< std::vector<InClass::Type> > Token::enumerate( const std::vector<Token> &tokens, long unsigned int limit ) {
 
     // count the number of possible combinations
-    long unsigned int cnt = 1;
-    for (const auto &t : tokens)
-        cnt *= t.inSize();
+    long unsigned int cnt = countPatterns( tokens );
+    long unsigned int want = cnt;
+    if ( limit > 0 and limit < cnt )
+        want = limit;
 
-    // reserve space for all the combinations
+    // a pathological phrase can have more than fit in memory, so only
+    // reserve a bounded amount up front
     std::vector< std::vector<InClass::Type> > list;
-    list.clear();
-    list.reserve( list.size() );
+    list.reserve( std::min( want, 4096UL ) );
 
     // enumerate all the combinations and save them in list
-    for (long unsigned int i=0; i<cnt; ++i) {
-        long unsigned int num = 1;
-        std::vector<InClass::Type> one;
-        for ( const auto &t : tokens ) {
-            num *= t.inSize();
-            one.push_back( t.in( i*num/cnt % t.inSize() ) );
-            //std::cout << InClass::asString(one.back()) << " ";
-        }
+    std::vector<InClass::Type> one;
+    for (long unsigned int i=0; i<want; ++i) {
+        pattern( tokens, i, one );
         list.push_back( one );
-        //std::cout << "\n";
     }
 
     return list;
 }
 
+
+long unsigned int Token::countPatterns( const std::vector<Token> &tokens ) {
+    long unsigned int cnt = 1;
+    for (const auto &t : tokens) {
+        if ( t.inSize() > 0 and cnt > ULONG_MAX / t.inSize() )
+            return ULONG_MAX;
+        cnt *= t.inSize();
+    }
+    return cnt;
+}
+
+
+// i in mixed radix, the last token has the lowest digit
+void Token::pattern( const std::vector<Token> &tokens, long unsigned int i, std::vector<InClass::Type> &one ) {
+    one.resize( tokens.size() );
+    for ( long unsigned int k = tokens.size(); k-- > 0; ) {
+        const long unsigned int n = tokens[k].inSize();
+        one[k] = tokens[k].in( i % n );
+        i /= n;
+    }
+}
+
 // Token::trim(int which)
 // which = 1 -- trim left
 //         2 -- trim right
@@ -46,6 +46,13 @@ public:
     long unsigned int inSize() const { return inclass_.size(); };
 
     static std::vector< std::vector<InClass::Type> > enumerate( std::vector<Token> tokens );
+    // only the first limit patterns, limit of zero means all of them
+    static std::vector< std::vector<InClass::Type> > enumerate( const std::vector<Token> &tokens, long unsigned int limit );
+    // the number of patterns, it stops growing at ULONG_MAX
+    static long unsigned int countPatterns( const std::vector<Token> &tokens );
+    // the i'th pattern in the order enumerate() returns them, so they
+    // can be made one at a time without holding all of them
+    static void pattern( const std::vector<Token> &tokens, long unsigned int i, std::vector<InClass::Type> &one );
 
     // mutators
     void text(std::string text) { text_ = text; };
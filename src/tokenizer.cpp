@@ -18,6 +18,7 @@
 
 #include "tokenizer.h"
 #include "utils.h"
+#include "instrument.h"
 
 void Tokenizer::removeFilter(InClass::Type filter) {
     auto it = filter_.find(filter);
@@ -37,6 +38,7 @@ void Tokenizer::removeFilter(InClass::Type filter) {
 // For case 3, we will return prefix, middle, suffix.
 
 std::vector<Token> Tokenizer::splitToken( const Token &tok ) {
+    Instrument::Timer timer( Instrument::SPLIT );
     std::vector<Token> outtokens;
     boost::smatch what;
     std::string str = tok.text();
@@ -162,12 +164,15 @@ std::vector<Token> Tokenizer::splitToken( const Token &tok ) {
 
 
 std::vector<Token> Tokenizer::getTokens( std::string str ) {
+    Instrument::Timer timer( Instrument::TOKENIZE );
 
     // make sure the text is normalized and UPPERCASE
+    Instrument::Timer normalize( Instrument::NORMALIZE );
     std::string locale = lex_.locale();
     UErrorCode errorCode;
     std::string nstr = Utils::normalizeUTF8( str, errorCode );
     str = Utils::upperCaseUTF8( nstr, locale );
+    normalize.stop();
 
     // As a reminder POSIX regex classes are:
     //                ASCII           UNICODE
@@ -268,58 +273,118 @@ std::vector<Token> Tokenizer::applyFilter( const std::vector<Token> &in ) {
 }
 
 
-std::vector<std::vector<Token> > Tokenizer::getAltTokens( const std::vector<Token> &in ) {
-    std::vector<std::vector<std::string> > alt;
+std::vector<std::vector<Token> > Tokenizer::getAltTokens( const std::vector<Token> &in, SearchBudget *budget ) {
+    std::vector<std::vector<Token> > list;
+    list.clear();
+
+    AltTokens alts( lex_, in, false, budget );
+
+    // if there are no alternates then no tokens
+    // could be split so return an empty list
+    if ( alts.size() == 0 )
+        return list;
+
+    //reserve space for all the combinations
+    list.reserve( alts.size() );
+
+    std::vector<Token> one;
+    while ( alts.next( one ) )
+        list.push_back( one );
+
+    return list;
+}
+
+
+AltTokens::AltTokens( Lexicon& lex, const std::vector<Token> &in, bool unique, SearchBudget *budget )
+    : lex_( lex ), in_( in ), cnt_( 1 ), i_( 1 ), unique_( unique ),
+      budget_( budget ), patterns_( 0 )
+{
+    Instrument::Timer timer( Instrument::ALTS );
 
     // split each token into words
     for (const auto &t : in ) {
-        // split each token into words
         std::vector<std::string> words;
         std::string str( t.text() );
         boost::split(words, str, boost::is_any_of(" "), boost::token_compress_on);
-        alt.push_back( words );
-    }
 
-    // enumerate the words into a list of alternate tokens
+        std::vector<Token> toks;
+        if ( words.size() > 1 ) {
+            cnt_ *= 2;
+            for ( const auto &w : words )
+                toks.push_back( Token( w ) );
+        }
+        words_.push_back( toks );
+        classified_.push_back( false );
+    }
 
-    long unsigned int cnt = 1;
-    for ( const auto &a : alt )
-        if (a.size() > 1) cnt *= 2;
+    // the original phrase gets searched too so count its patterns
+    // against the budget before adding any alternates
+    if ( budget_ and budget_->maxPatterns() )
+        patterns_ = Token::countPatterns( in_ );
 
-    std::vector<std::vector<Token> > list;
-    list.clear();
+    if ( unique_ )
+        seen_.insert( signature( in_ ) );
+}
 
-    // if cnt==1 then no tokens could be split
-    // so return an empty list
-    if ( cnt == 1 )
-        return list;
 
-    //reserve space for all the combinations
-    list.reserve( cnt-1 );
+bool AltTokens::next( std::vector<Token> &one ) {
+    Instrument::Timer timer( Instrument::ALTS );
 
     // enumerate the combination
-    for ( long unsigned int i=1; i<cnt; ++i ) {
+    while ( i_ < cnt_ ) {
+        // Search flags the budget as exceeded when it
+        // runs out of patterns, so keep the last one we add
+        if ( budget_ and budget_->maxPatterns()
+             and patterns_ > budget_->maxPatterns() )
+            return false;
+        if ( budget_ and not budget_->checkDeadline() )
+            return false;
+
+        long unsigned int i = i_++;
         long unsigned int n = 0;
-        std::vector<Token> one;
-        for ( long unsigned int j=0; j<alt.size(); ++j ) {
-            if ( alt[j].size() == 1 ) 
-                one.push_back( in[j] );
+        one.clear();
+        for ( long unsigned int j=0; j<in_.size(); ++j ) {
+            if ( words_[j].empty() )
+                one.push_back( in_[j] );
             else {
-                if ( i / (1<<n) % 2 == 0 ) 
-                    one.push_back( in[j] );
+                if ( i / (1UL<<n) % 2 == 0 )
+                    one.push_back( in_[j] );
                 else
-                    for ( const auto &w : alt[j] ) {
-                        Token tok( w );
-                        lex_.classify( tok, InClass::WORD );
-                        one.push_back( tok );
-                    }
+                    for ( const auto &w : words( j ) )
+                        one.push_back( w );
                 ++n;
             }
         }
-        list.push_back( one );
+
+        if ( unique_ and not seen_.insert( signature( one ) ).second )
+            continue;
+
+        if ( budget_ and budget_->maxPatterns() )
+            patterns_ += Token::countPatterns( one );
+
+        Instrument::count( Instrument::ALTERNATIVES, 1 );
+        return true;
     }
 
-    return list;
+    return false;
+}
+
+
+const std::vector<Token> &AltTokens::words( long unsigned int j ) {
+    if ( not classified_[j] ) {
+        for ( auto &tok : words_[j] )
+            lex_.classify( tok, InClass::WORD );
+        classified_[j] = true;
+    }
+    return words_[j];
 }
 
 
+std::string AltTokens::signature( const std::vector<Token> &phrase ) {
+    std::string sig;
+    for ( const auto &t : phrase ) {
+        sig += t.inclassAsString();
+        sig += '|';
+    }
+    return sig;
+}
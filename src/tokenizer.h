@@ -22,6 +22,47 @@
 
 #include "token.h"
 #include "lexicon.h"
+#include "searchbudget.h"
+
+/*
+ * AltTokens lazily generates the alternate phrases for a phrase by
+ * splitting its multi-word tokens into separate words. There are
+ * 2^k - 1 alternates for k multi-word tokens and they are produced
+ * in the same order getAltTokens() returns them. The words of each
+ * multi-word token are only classified once.
+ *
+ * When unique is set, alternates whose input classes are the same
+ * as the phrase or an earlier alternate are skipped because they
+ * can not produce a different search result.
+ */
+class AltTokens {
+
+public:
+    AltTokens( Lexicon& lex, const std::vector<Token> &in, bool unique, SearchBudget *budget = NULL );
+
+    // get the next alternate, returns false when there are no more
+    bool next( std::vector<Token> &phrase );
+
+    // the number of alternates, before removing any duplicates
+    long unsigned int size() const { return cnt_ - 1; };
+
+private:
+    const std::vector<Token> &words( long unsigned int j );
+    static std::string signature( const std::vector<Token> &phrase );
+
+    Lexicon& lex_;
+    std::vector<Token> in_;
+    std::vector<std::vector<Token> > words_;
+    std::vector<bool> classified_;
+    long unsigned int cnt_;
+    long unsigned int i_;
+    bool unique_;
+    std::set<std::string> seen_;
+    SearchBudget *budget_;
+    long unsigned int patterns_;
+
+};
+
 
 class Tokenizer {
 
@@ -40,7 +81,12 @@ public:
     void removeFilter(InClass::Type filter);
     void clearFilter() { filter_.clear(); };
 
-    std::vector<std::vector<Token> > getAltTokens( const std::vector<Token> &in );
+    // if a budget is given stop generating alternates once the phrases
+    // have more patterns than it allows or the deadline has passed
+    std::vector<std::vector<Token> > getAltTokens( const std::vector<Token> &in, SearchBudget *budget = NULL );
+
+    // lazy version of getAltTokens(), see AltTokens for unique
+    AltTokens altTokens( const std::vector<Token> &in, bool unique, SearchBudget *budget = NULL ) { return AltTokens( lex_, in, unique, budget ); };
 
 private:
     Lexicon& lex_;